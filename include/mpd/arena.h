@@ -0,0 +1,91 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Bulk allocation of received objects
+ *
+ * An arena is a region of memory which grows in large chunks.
+ * Functions such as mpd_recv_song_arena() allocate objects in it
+ * instead of calling malloc() for each one, and all of them are
+ * released at once by mpd_arena_reset() or mpd_arena_free().
+ *
+ * An arena is not thread-safe.
+ */
+
+#ifndef MPD_ARENA_H
+#define MPD_ARENA_H
+
+#include "compiler.h"
+
+/**
+ * \struct mpd_arena
+ *
+ * This opaque object owns the memory of objects allocated in it.
+ * Call mpd_arena_new() to create a new instance.
+ */
+struct mpd_arena;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new, empty arena.  No memory is allocated for objects
+ * until the first one is stored in it.
+ *
+ * @return a #mpd_arena object, or NULL if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_arena *
+mpd_arena_new(void);
+
+/**
+ * Frees the arena and all objects allocated in it.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_arena_free(struct mpd_arena *arena);
+
+/**
+ * Frees all objects allocated in the arena, but keeps its largest
+ * chunk of memory for reuse.  This is cheaper than creating a new arena, e.g.
+ * for each request handled by a server.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_arena_reset(struct mpd_arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
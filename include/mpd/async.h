@@ -157,6 +157,44 @@ bool
 mpd_async_set_keepalive(struct mpd_async *async,
 			bool keepalive);
 
+/**
+ * Sets the maximum size of the input buffer.  The input buffer starts
+ * small and grows as needed when MPD sends a response line which does
+ * not fit; this limits the length of a single response line.  Longer
+ * lines abort the connection with #MPD_ERROR_MALFORMED.
+ *
+ * The default value is 1 MiB.  Values smaller than 4 kB are rounded
+ * up to 4 kB.
+ *
+ * @param async the #mpd_async object
+ * @param max_size the maximum input buffer size in bytes
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_async_set_input_buffer_limit(struct mpd_async *async, size_t max_size);
+
+/**
+ * Switches the input buffer to a ring buffer: its memory is mapped
+ * twice, back to back, so partial lines never need to be moved.
+ * This pays off for connections which receive large responses (e.g.
+ * with #mpd_reactor), but creating the mapping is more expensive
+ * than allocating the default buffer.
+ *
+ * This must be called before anything is received.  The ring buffer
+ * is not inherited by child processes: after fork(), the child may
+ * only free this object.
+ *
+ * @param async the #mpd_async object
+ * @return true on success, false if this is not supported on this
+ * platform, if the mapping failed or if data has already been
+ * received; the default buffer is used then
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_async_set_ring_buffer(struct mpd_async *async);
+
 /**
  * Returns a bit mask of events which should be polled for.
  */
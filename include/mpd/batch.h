@@ -0,0 +1,187 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Deferred execution of many commands in few round trips
+ *
+ * A batch records commands together with the location of their
+ * results, like the mpd_run_*() functions would return them, and
+ * executes all of them with mpd_batch_commit().  The commands are
+ * packed into "command_list_ok_begin" blocks which fit into the
+ * output buffer, so a typical batch takes a single round trip.
+ *
+ * Unlike a plain command list, a failed command does not abort the
+ * following ones: they are sent again in the next block.
+ *
+ * Do not include this header directly.  Use mpd/client.h instead.
+ */
+
+#ifndef MPD_BATCH_H
+#define MPD_BATCH_H
+
+#include "compiler.h"
+
+#include <stdbool.h>
+
+struct mpd_connection;
+struct mpd_song;
+struct mpd_status;
+
+/**
+ * \struct mpd_batch
+ *
+ * This opaque object holds the commands which were recorded for
+ * later execution.  Call mpd_batch_new() to create a new instance.
+ */
+struct mpd_batch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new, empty batch.
+ *
+ * @return a #mpd_batch object, or NULL if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_batch *
+mpd_batch_new(void);
+
+/**
+ * Frees the batch, including commands which were not committed.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_batch_free(struct mpd_batch *batch);
+
+/**
+ * Returns the number of commands which were recorded, but not
+ * committed yet.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+unsigned
+mpd_batch_get_length(const struct mpd_batch *batch);
+
+/**
+ * Records an arbitrary command whose response is discarded.
+ *
+ * @param success_r if not NULL, this variable is set to false now,
+ * and to true when the command succeeds
+ * @param command the command name, followed by its arguments and a
+ * NULL sentinel
+ * @return true on success, false if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_sentinel
+bool
+mpd_batch_command(struct mpd_batch *batch, bool *success_r,
+		  const char *command, ...);
+
+/**
+ * Records the "addid" command (see mpd_run_add_id()).
+ *
+ * @param id_r this variable is set to -1 now, and to the id of the
+ * new song when the command succeeds
+ * @return true on success, false if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_batch_add_id(struct mpd_batch *batch, const char *uri, int *id_r);
+
+/**
+ * Records the "status" command (see mpd_run_status()).
+ *
+ * @param status_r this variable is set to NULL now, and to a new
+ * #mpd_status object (to be freed by the caller) when the command
+ * succeeds
+ * @return true on success, false if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_batch_status(struct mpd_batch *batch, struct mpd_status **status_r);
+
+/**
+ * Records the "currentsong" command (see mpd_run_current_song()).
+ *
+ * @param song_r this variable is set to NULL now, and to a new
+ * #mpd_song object (to be freed by the caller) when the command
+ * succeeds and a song is playing
+ * @return true on success, false if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_batch_current_song(struct mpd_batch *batch, struct mpd_song **song_r);
+
+/**
+ * Records the "playlistid" command (see
+ * mpd_run_get_queue_song_id()).
+ *
+ * @param song_r this variable is set to NULL now, and to a new
+ * #mpd_song object (to be freed by the caller) when the command
+ * succeeds
+ * @return true on success, false if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_batch_get_queue_song_id(struct mpd_batch *batch, unsigned id,
+			    struct mpd_song **song_r);
+
+/**
+ * Executes all recorded commands, fills their results, and empties
+ * the batch.
+ *
+ * If some commands fail with a server error, the others are still
+ * executed.  The first server error is then set on the connection,
+ * with mpd_connection_get_server_error_location() returning the
+ * index of the failed command within the batch; clear it with
+ * mpd_connection_clear_error() as usual.  After another error (e.g.
+ * a lost connection), the remaining commands are not executed.
+ *
+ * @return true if all commands have succeeded
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_batch_commit(struct mpd_batch *batch, struct mpd_connection *connection);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
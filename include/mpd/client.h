@@ -39,6 +39,25 @@
  * - struct mpd_connection: a basic synchronous API which knows all
  *   MPD commands and parses all responses
  *
+ * - struct mpd_reactor: an event loop which drives many mpd_async
+ *   connections from one thread, and dispatches responses to
+ *   callbacks
+ *
+ * - struct mpd_connector: establishes a struct mpd_connection
+ *   without blocking, driven by the caller's event loop
+ *
+ * - struct mpd_pool: a thread-safe pool of struct mpd_connection
+ *   objects with the same settings
+ *
+ * - struct mpd_pipeline: keeps many independent commands in flight on
+ *   one struct mpd_connection
+ *
+ * - struct mpd_batch: records commands and executes them in few
+ *   command lists
+ *
+ * - struct mpd_idle_hub: shares one idle connection among many
+ *   subscribers in the same process (not available on Windows)
+ *
  * \author Max Kellermann (max.kellermann@gmail.com)
  */
 
@@ -47,14 +66,20 @@
 
 // IWYU pragma: begin_exports
 
+#include "arena.h"
 #include "audio_format.h"
+#include "batch.h"
 #include "capabilities.h"
 #include "connection.h"
+#include "connector.h"
 #include "database.h"
 #include "directory.h"
 #include "entity.h"
 #include "fingerprint.h"
 #include "idle.h"
+#ifndef _WIN32
+#include "idle_hub.h"
+#endif
 #include "list.h"
 #include "message.h"
 #include "mixer.h"
@@ -64,9 +89,12 @@
 #include "pair.h"
 #include "partition.h"
 #include "password.h"
+#include "pipeline.h"
 #include "player.h"
 #include "playlist.h"
+#include "pool.h"
 #include "queue.h"
+#include "reactor.h"
 #include "recv.h"
 #include "replay_gain.h"
 #include "response.h"
@@ -158,7 +158,9 @@ mpd_connection_set_keepalive(struct mpd_connection *connection,
 /**
  * Sets the timeout for synchronous operations.  If the MPD server
  * does not send a response during this time span, the operation is
- * aborted by libmpdclient.
+ * aborted by libmpdclient.  Each operation (e.g. sending a command or
+ * receiving one line of the response) is limited to this time span
+ * as a whole, no matter how many I/O steps it needs.
  *
  * The initial value is the one passed to mpd_connection_new().  If
  * you have used mpd_connection_new_async(), then the default value is
@@ -170,6 +172,65 @@ mpd_connection_set_keepalive(struct mpd_connection *connection,
 void mpd_connection_set_timeout(struct mpd_connection *connection,
 				unsigned timeout_ms);
 
+/**
+ * Sets a deadline for the next command: sending it and receiving its
+ * complete response must be finished within the specified time span
+ * from now, or else the pending operation fails with
+ * #MPD_ERROR_TIMEOUT.  This bounds the total time of a command,
+ * unlike mpd_connection_set_timeout(), which applies to each
+ * operation separately (and which still applies).
+ *
+ * The deadline is cleared when the response is over (i.e. when
+ * mpd_recv_pair() returns NULL or mpd_response_finish() succeeds),
+ * and by mpd_connection_clear_error().
+ *
+ * @param connection the connection to MPD
+ * @param timeout_ms the time span in milliseconds
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_connection_set_deadline(struct mpd_connection *connection,
+			    unsigned timeout_ms);
+
+/**
+ * "Corks" the connection: commands sent from now on are collected in
+ * the output buffer (which is flushed only when it becomes full),
+ * until mpd_connection_uncork() is called.  This way, many small
+ * commands are sent with one system call and few TCP segments.
+ *
+ * While the connection is corked, a new command may be sent even if
+ * the responses of previous commands have not been read yet.  Their
+ * responses are received in the same order with the usual functions
+ * (e.g. mpd_recv_pair() and mpd_response_finish()), one after
+ * another.  Waiting for a response flushes the output buffer
+ * implicitly.  If a command fails, clear the error with
+ * mpd_connection_clear_error() before reading the next response.
+ *
+ * Command lists and the mpd_run_*() functions cannot be used while
+ * the connection is corked or responses are still queued.
+ *
+ * @param connection the connection to MPD
+ * @return true on success, false on error
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_connection_cork(struct mpd_connection *connection);
+
+/**
+ * Flushes all commands collected since mpd_connection_cork(), and
+ * returns to flushing after each command.  The responses of all
+ * commands must still be read.
+ *
+ * @param connection the connection to MPD
+ * @return true on success, false on error
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_connection_uncork(struct mpd_connection *connection);
+
 /**
  * Returns the file descriptor which should be polled by the caller.
  * Do not use the file descriptor for anything except polling!  The
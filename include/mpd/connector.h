@@ -0,0 +1,212 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Non-blocking connection establishment
+ *
+ * The connector performs all the steps of mpd_connection_new()
+ * without blocking: host name resolution (in a separate thread),
+ * connecting, receiving the welcome line and sending the password.
+ * The caller drives it from its own event loop, and gets a ready
+ * #mpd_connection when it is done.
+ *
+ * A simple loop looks like this:
+ *
+ * \code
+ * while (mpd_connector_step(connector, events) == MPD_CONNECTOR_RUNNING) {
+ *     struct pollfd pfd = {
+ *         .fd = mpd_connector_get_fd(connector),
+ *         .events = ...mpd_connector_get_events(connector)...,
+ *     };
+ *     poll(&pfd, 1, mpd_connector_get_timeout(connector));
+ *     events = ...pfd.revents...;
+ * }
+ * \endcode
+ */
+
+#ifndef MPD_CONNECTOR_H
+#define MPD_CONNECTOR_H
+
+#include "async.h"
+#include "error.h"
+#include "protocol.h"
+#include "compiler.h"
+
+struct mpd_connection;
+struct mpd_settings;
+
+/**
+ * \struct mpd_connector
+ *
+ * This opaque object establishes one connection.  Call
+ * mpd_connector_new() to create a new instance.
+ */
+struct mpd_connector;
+
+enum mpd_connector_state {
+	/**
+	 * The connector is still busy.  Wait for the events returned
+	 * by mpd_connector_get_events() (or for the timeout), and
+	 * call mpd_connector_step() again.
+	 */
+	MPD_CONNECTOR_RUNNING,
+
+	/**
+	 * The connection is ready; obtain it with
+	 * mpd_connector_get_connection().
+	 */
+	MPD_CONNECTOR_READY,
+
+	/**
+	 * The connector has failed; see mpd_connector_get_error().
+	 */
+	MPD_CONNECTOR_FAILED,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new connector.  This function does not block; call
+ * mpd_connector_step() to start.
+ *
+ * @param settings the host, port, timeout and password; the
+ * connector makes a copy
+ * @return a #mpd_connector object, or NULL if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_connector *
+mpd_connector_new(const struct mpd_settings *settings);
+
+/**
+ * Frees the connector, including the connection unless it has been
+ * obtained with mpd_connector_get_connection().
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_connector_free(struct mpd_connector *connector);
+
+/**
+ * Performs as much work as possible without blocking.
+ *
+ * @param events the events which occurred on the file descriptor
+ * returned by mpd_connector_get_fd(); 0 after a timeout or on the
+ * first call
+ * @return the new state
+ *
+ * @since libmpdclient 2.19
+ */
+enum mpd_connector_state
+mpd_connector_step(struct mpd_connector *connector,
+		   enum mpd_async_event events);
+
+/**
+ * Returns the file descriptor the caller should wait on.  It may
+ * change after each mpd_connector_step() call.
+ *
+ * @return the file descriptor, or -1 if there is none (wait for the
+ * timeout only)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+int
+mpd_connector_get_fd(const struct mpd_connector *connector);
+
+/**
+ * Returns the events the caller should wait for.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+enum mpd_async_event
+mpd_connector_get_events(const struct mpd_connector *connector);
+
+/**
+ * Returns the maximum time the caller may wait before calling
+ * mpd_connector_step() again, even if no event has occurred.  It is
+ * used for the overall timeout and for starting parallel connection
+ * attempts.
+ *
+ * @return the timeout in milliseconds, or -1 for no timeout
+ *
+ * @since libmpdclient 2.19
+ */
+int
+mpd_connector_get_timeout(const struct mpd_connector *connector);
+
+/**
+ * Returns the connection after mpd_connector_step() has returned
+ * #MPD_CONNECTOR_READY.  The caller becomes the owner and must free
+ * it with mpd_connection_free().  This may be called only once.
+ *
+ * @since libmpdclient 2.19
+ */
+struct mpd_connection *
+mpd_connector_get_connection(struct mpd_connector *connector);
+
+/**
+ * Returns the error code after mpd_connector_step() has returned
+ * #MPD_CONNECTOR_FAILED.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+enum mpd_error
+mpd_connector_get_error(const struct mpd_connector *connector);
+
+/**
+ * Returns the human-readable (English) error message.  Only valid
+ * if mpd_connector_get_error() does not return #MPD_ERROR_SUCCESS.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+const char *
+mpd_connector_get_error_message(const struct mpd_connector *connector);
+
+/**
+ * Returns the error code sent by the server, e.g. for a wrong
+ * password.  Only valid if mpd_connector_get_error() returns
+ * #MPD_ERROR_SERVER.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+enum mpd_server_error
+mpd_connector_get_server_error(const struct mpd_connector *connector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,199 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Sharing one idle connection among many subscribers
+ *
+ * Instead of opening one connection per component which wants to be
+ * notified about changes, a process can use one idle hub: it keeps a
+ * single connection in "idle" mode, and distributes the received
+ * events to all subscribers whose mask matches.
+ *
+ * One thread runs mpd_idle_hub_run().  All other functions except
+ * mpd_idle_hub_new(), mpd_idle_hub_free() and
+ * mpd_idle_hub_set_coalesce() may be called from any thread; they
+ * do not take a lock.
+ */
+
+#ifndef MPD_IDLE_HUB_H
+#define MPD_IDLE_HUB_H
+
+#include "idle.h"
+#include "compiler.h"
+
+#include <stdbool.h>
+
+struct mpd_connection;
+
+/**
+ * \struct mpd_idle_hub
+ *
+ * This opaque object owns the idle connection and a fixed number of
+ * subscriber slots.  Call mpd_idle_hub_new() to create a new
+ * instance.
+ */
+struct mpd_idle_hub;
+
+/**
+ * \struct mpd_idle_hub_subscriber
+ *
+ * A handle returned by mpd_idle_hub_subscribe().
+ */
+struct mpd_idle_hub_subscriber;
+
+/**
+ * Callback which is invoked by the thread running mpd_idle_hub_run()
+ * when a subscriber has new events, i.e. when its pending events
+ * were empty before.  It should only wake up the subscriber, which
+ * then calls mpd_idle_hub_subscriber_take().
+ *
+ * @param ctx the pointer passed to mpd_idle_hub_subscribe()
+ */
+typedef void
+(*mpd_idle_hub_notify_cb)(void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new idle hub.
+ *
+ * @param connection a connection which is not in use; the hub takes
+ * ownership and frees it in mpd_idle_hub_free()
+ * @param max_subscribers the number of subscriber slots
+ * @return a #mpd_idle_hub object, or NULL on error (the connection
+ * is not freed then)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_idle_hub *
+mpd_idle_hub_new(struct mpd_connection *connection,
+		 unsigned max_subscribers);
+
+/**
+ * Frees the hub and its connection.  mpd_idle_hub_run() must not be
+ * running.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_idle_hub_free(struct mpd_idle_hub *hub);
+
+/**
+ * Returns the connection of this hub, e.g. to check its error after
+ * mpd_idle_hub_run() has failed.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+struct mpd_connection *
+mpd_idle_hub_get_connection(const struct mpd_idle_hub *hub);
+
+/**
+ * Sets a time span for coalescing bursts of events: after an event
+ * has been received, the hub collects more events for this long
+ * before notifying the subscribers.  The default is 0, which
+ * notifies immediately.
+ *
+ * This function is not thread-safe; call it before
+ * mpd_idle_hub_run().
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_idle_hub_set_coalesce(struct mpd_idle_hub *hub, unsigned coalesce_ms);
+
+/**
+ * Adds a subscriber.  It may be called while mpd_idle_hub_run() is
+ * running; the subscriber receives only events which arrive after
+ * this call.
+ *
+ * @param mask the events this subscriber is interested in
+ * @param notify_cb a callback which is invoked when there are new
+ * events (may be NULL if the subscriber polls)
+ * @param ctx an arbitrary pointer passed to #notify_cb
+ * @return a subscriber handle, or NULL if all slots are in use
+ *
+ * @since libmpdclient 2.19
+ */
+struct mpd_idle_hub_subscriber *
+mpd_idle_hub_subscribe(struct mpd_idle_hub *hub, enum mpd_idle mask,
+		       mpd_idle_hub_notify_cb notify_cb, void *ctx);
+
+/**
+ * Removes a subscriber.  After this function returns, its notify
+ * callback is not invoked anymore.  It must not be called from within
+ * the notify callback.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_idle_hub_unsubscribe(struct mpd_idle_hub_subscriber *subscriber);
+
+/**
+ * Returns the events which have occurred since the last call, and
+ * clears them.  Several occurrences of the same event are reported
+ * only once.
+ *
+ * @return the events, or 0 if there are none
+ *
+ * @since libmpdclient 2.19
+ */
+enum mpd_idle
+mpd_idle_hub_subscriber_take(struct mpd_idle_hub_subscriber *subscriber);
+
+/**
+ * Keeps the connection in "idle" mode and distributes all events to
+ * the subscribers, re-entering "idle" after each response.  This
+ * blocks until mpd_idle_hub_stop() is called or until the connection
+ * fails.
+ *
+ * @return true if stopped by mpd_idle_hub_stop(), false on error
+ * (see mpd_idle_hub_get_connection())
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_idle_hub_run(struct mpd_idle_hub *hub);
+
+/**
+ * Asks mpd_idle_hub_run() to return.  If it is not running, the next
+ * call returns immediately.  This function is async-signal-safe.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_idle_hub_stop(struct mpd_idle_hub *hub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,172 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Pipelining independent commands on one connection
+ *
+ * A pipeline keeps several commands in flight on one synchronous
+ * #mpd_connection, instead of waiting for each response before
+ * sending the next command.  Unlike a command list, the commands are
+ * independent: each one gets its own "OK" or "ACK", and a failed
+ * command does not abort the following ones.
+ *
+ * Do not include this header directly.  Use mpd/client.h instead.
+ */
+
+#ifndef MPD_PIPELINE_H
+#define MPD_PIPELINE_H
+
+#include "compiler.h"
+
+#include <stdbool.h>
+
+struct mpd_connection;
+
+/**
+ * \struct mpd_pipeline
+ *
+ * This opaque object tracks the commands sent through a pipeline
+ * whose responses have not been received yet.  Call
+ * mpd_pipeline_new() to create a new instance.
+ */
+struct mpd_pipeline;
+
+/**
+ * Receives the response of one pipelined command.  It is called when
+ * this response is the next one to be received; the connection is
+ * then in the same state as after mpd_send_command().
+ *
+ * The callback may read the response with mpd_recv_pair() and the
+ * other receive functions.  To find out whether the command has
+ * succeeded, it calls mpd_response_finish(); on failure,
+ * mpd_connection_get_error() and mpd_connection_get_server_error()
+ * describe this command's error.  If the callback does not finish the
+ * response, the pipeline does it.  A server error is cleared by the
+ * pipeline after the callback returns.
+ *
+ * The callback must not send commands on the connection.
+ *
+ * @param connection the connection which received the response
+ * @param ctx the pointer passed to mpd_pipeline_send()
+ */
+typedef void (*mpd_pipeline_callback)(struct mpd_connection *connection,
+				      void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Starts pipelining on a connection.  The connection is corked (see
+ * mpd_connection_cork()) until the pipeline is freed.  It must not
+ * be receiving a response.
+ *
+ * @param connection the connection to MPD
+ * @param window the maximum number of commands in flight; when it is
+ * reached, mpd_pipeline_send() receives the oldest response first
+ * @return a #mpd_pipeline object, or NULL on error (out of memory,
+ * or the connection error is set)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_pipeline *
+mpd_pipeline_new(struct mpd_connection *connection, unsigned window);
+
+/**
+ * Frees the pipeline and uncorks the connection.  The responses of
+ * commands which are still in flight are received and discarded,
+ * without invoking their callbacks.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_pipeline_free(struct mpd_pipeline *pipeline);
+
+/**
+ * Sends a command through the pipeline.  If the window is full, the
+ * oldest response is received first (invoking its callback).
+ *
+ * @param pipeline the pipeline
+ * @param callback receives the response of this command; NULL
+ * discards it, including a server error
+ * @param ctx an arbitrary pointer passed to the callback
+ * @param command the command name, followed by its arguments and a
+ * NULL sentinel
+ * @return true on success, false if the connection has failed (see
+ * mpd_connection_get_error())
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_sentinel
+bool
+mpd_pipeline_send(struct mpd_pipeline *pipeline,
+		  mpd_pipeline_callback callback, void *ctx,
+		  const char *command, ...);
+
+/**
+ * Like mpd_pipeline_send(), but the arguments are passed as an
+ * array.
+ *
+ * @param argv a NULL-terminated array of arguments
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_pipeline_send_argv(struct mpd_pipeline *pipeline,
+		       mpd_pipeline_callback callback, void *ctx,
+		       const char *command, const char *const *argv);
+
+/**
+ * Flushes all pending commands and receives all responses which are
+ * still in flight, invoking their callbacks.  The pipeline may be
+ * used for more commands afterwards.
+ *
+ * @return true on success, false if the connection has failed (see
+ * mpd_connection_get_error())
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_pipeline_finish(struct mpd_pipeline *pipeline);
+
+/**
+ * Returns the number of commands whose responses have not been
+ * received yet.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+unsigned
+mpd_pipeline_get_pending(const struct mpd_pipeline *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,133 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief A pool of synchronous MPD connections
+ *
+ * The pool opens a number of connections with the same settings and
+ * lends them to threads.  This avoids the connect, welcome and
+ * password round trips for each unit of work.
+ *
+ * Borrowing and returning connections does not take a lock; all
+ * functions except mpd_pool_new() and mpd_pool_free() may be called
+ * from any thread.  A borrowed connection must only be used by the
+ * thread which has borrowed it, until it is returned.
+ */
+
+#ifndef MPD_POOL_H
+#define MPD_POOL_H
+
+#include "compiler.h"
+
+struct mpd_connection;
+struct mpd_settings;
+
+/**
+ * \struct mpd_pool
+ *
+ * This opaque object manages a fixed number of #mpd_connection
+ * objects.  Call mpd_pool_new() to create a new instance.
+ */
+struct mpd_pool;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new pool and opens all of its connections.  Connections
+ * which fail to open are retried by mpd_pool_get().
+ *
+ * @param settings the host, port, timeout and password for all
+ * connections; the pool makes a copy
+ * @param size the maximum number of connections
+ * @return a #mpd_pool object, or NULL if out of memory
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_pool *
+mpd_pool_new(const struct mpd_settings *settings, unsigned size);
+
+/**
+ * Closes all connections and frees the pool.  All connections must
+ * have been returned with mpd_pool_put().
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_pool_free(struct mpd_pool *pool);
+
+/**
+ * Enables validation of idle connections: mpd_pool_get() sends a
+ * "ping" on a connection which has not been used for the specified
+ * duration, and replaces it if the server does not respond.  This is
+ * disabled by default.
+ *
+ * This function is not thread-safe; call it before sharing the pool.
+ *
+ * @param idle_ms the idle time in milliseconds; 0 disables the check
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_pool_set_idle_check(struct mpd_pool *pool, unsigned idle_ms);
+
+/**
+ * Borrows a connection from the pool.  If the slot has no usable
+ * connection (e.g. after a failure), a new one is opened.
+ *
+ * Always check mpd_connection_get_error() on the result: if a new
+ * connection could not be opened, the returned object carries the
+ * error.  It must be returned with mpd_pool_put() either way.
+ *
+ * @return a connection, or NULL if all connections are in use (or
+ * out of memory)
+ *
+ * @since libmpdclient 2.19
+ */
+struct mpd_connection *
+mpd_pool_get(struct mpd_pool *pool);
+
+/**
+ * Returns a connection which was borrowed with mpd_pool_get().  All
+ * responses must have been received.  If the connection has failed
+ * with an error which cannot be cleared (e.g. #MPD_ERROR_CLOSED or
+ * #MPD_ERROR_TIMEOUT), it is closed, and the next mpd_pool_get()
+ * call opens a new one.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_pool_put(struct mpd_pool *pool, struct mpd_connection *connection);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,327 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief Event loop for many asynchronous MPD connections
+ *
+ * The reactor drives any number of #mpd_async objects from a single
+ * thread.  Commands are queued with mpd_reactor_send(), and the
+ * response of each command is delivered to callbacks: one for each
+ * name-value pair, and one when the response is complete.
+ *
+ * On Linux, the reactor uses io_uring if the kernel supports it:
+ * receive and send operations of all connections are submitted with
+ * one system call per mpd_reactor_dispatch() call.  Otherwise, it is
+ * based on an edge-triggered epoll instance; other platforms use
+ * poll().
+ */
+
+#ifndef MPD_REACTOR_H
+#define MPD_REACTOR_H
+
+#include "error.h"
+#include "protocol.h"
+#include "compiler.h"
+
+#include <stdbool.h>
+
+struct mpd_async;
+struct mpd_pair;
+struct mpd_song;
+struct mpd_entity;
+struct mpd_status;
+
+/**
+ * \struct mpd_reactor
+ *
+ * This opaque object owns a set of asynchronous connections and
+ * dispatches their events.  Call mpd_reactor_new() to create a new
+ * instance.
+ */
+struct mpd_reactor;
+
+/**
+ * \struct mpd_reactor_connection
+ *
+ * A connection which has been added to a #mpd_reactor with
+ * mpd_reactor_add().
+ */
+struct mpd_reactor_connection;
+
+/**
+ * Callback which is invoked for each name-value pair of a response.
+ * The pair is only valid during the call.
+ *
+ * @param pair the name-value pair
+ * @param ctx the pointer passed to mpd_reactor_send()
+ */
+typedef void
+(*mpd_reactor_pair_cb)(const struct mpd_pair *pair, void *ctx);
+
+/**
+ * Callback which is invoked when a response is complete, or when
+ * the command has failed.  It is invoked exactly once for each
+ * command which was accepted by mpd_reactor_send().
+ *
+ * @param error #MPD_ERROR_SUCCESS if the server has responded with
+ * "OK", #MPD_ERROR_SERVER if it has responded with "ACK", or another
+ * error code if the connection has failed
+ * @param server_error the error code sent by the server; only valid
+ * if #error is #MPD_ERROR_SERVER
+ * @param message a human readable error message; NULL on success
+ * @param ctx the pointer passed to mpd_reactor_send()
+ */
+typedef void
+(*mpd_reactor_done_cb)(enum mpd_error error,
+		       enum mpd_server_error server_error,
+		       const char *message, void *ctx);
+
+/**
+ * Callback which is invoked for each song parsed from a response.
+ * The callee takes ownership of the object and must free it with
+ * mpd_song_free().
+ *
+ * @param ctx the pointer passed to mpd_reactor_send_songs()
+ */
+typedef void
+(*mpd_reactor_song_cb)(struct mpd_song *song, void *ctx);
+
+/**
+ * Callback which is invoked for each entity parsed from a response.
+ * The callee takes ownership of the object and must free it with
+ * mpd_entity_free().
+ *
+ * @param ctx the pointer passed to mpd_reactor_send_entities()
+ */
+typedef void
+(*mpd_reactor_entity_cb)(struct mpd_entity *entity, void *ctx);
+
+/**
+ * Callback which is invoked with the parsed response of the "status"
+ * command.  The callee takes ownership of the object and must free
+ * it with mpd_status_free().
+ *
+ * @param ctx the pointer passed to mpd_reactor_send_status()
+ */
+typedef void
+(*mpd_reactor_status_cb)(struct mpd_status *status, void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Creates a new reactor without connections.
+ *
+ * @return a #mpd_reactor object, or NULL on error (errno is set)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_reactor *
+mpd_reactor_new(void);
+
+/**
+ * Removes all connections (see mpd_reactor_remove()) and frees the
+ * reactor.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_reactor_free(struct mpd_reactor *reactor);
+
+/**
+ * Returns a file descriptor which becomes readable when
+ * mpd_reactor_dispatch() has work to do.  This allows embedding the
+ * reactor into another event loop.
+ *
+ * @return the file descriptor, or -1 if this platform does not
+ * provide one
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+int
+mpd_reactor_get_fd(const struct mpd_reactor *reactor);
+
+/**
+ * Adds a connection to the reactor.  The reactor takes ownership of
+ * the #mpd_async object; it is freed by mpd_reactor_remove().
+ *
+ * @param async a new connection on which nothing has been sent yet
+ * @param welcome true if the server's welcome line ("OK MPD 0.21.0")
+ * has not been received yet; the reactor will check and consume it
+ * @return a handle for the new connection, or NULL on error (the
+ * #mpd_async object is not freed then)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_malloc
+struct mpd_reactor_connection *
+mpd_reactor_add(struct mpd_reactor *reactor, struct mpd_async *async,
+		bool welcome);
+
+/**
+ * Removes a connection from the reactor, and frees it.  The done
+ * callbacks of all pending commands are invoked with
+ * #MPD_ERROR_CLOSED.  This may be called from within a callback.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_reactor_remove(struct mpd_reactor_connection *connection);
+
+/**
+ * Returns the #mpd_async object of this connection.
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+struct mpd_async *
+mpd_reactor_connection_get_async(const struct mpd_reactor_connection *connection);
+
+/**
+ * Returns the error code of this connection.  Once a connection has
+ * failed, it is not used anymore, and should be removed.
+ *
+ * @return #MPD_ERROR_SUCCESS if the connection is alive
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+enum mpd_error
+mpd_reactor_connection_get_error(const struct mpd_reactor_connection *connection);
+
+/**
+ * Returns the error message of this connection (may be NULL).
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_pure
+const char *
+mpd_reactor_connection_get_error_message(const struct mpd_reactor_connection *connection);
+
+/**
+ * Queues a command.  It is sent by the next mpd_reactor_dispatch()
+ * call, together with all other commands queued on this connection
+ * until then.  The argument list must be terminated with a NULL.
+ *
+ * @param pair_cb a callback for each name-value pair of the response
+ * (may be NULL)
+ * @param done_cb a callback which is invoked when the response is
+ * complete (may be NULL)
+ * @param ctx an arbitrary pointer passed to the callbacks
+ * @param command the command to be sent
+ * @return true on success, false if the connection has failed or if
+ * the output buffer is full (callbacks are not invoked then)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_sentinel
+bool
+mpd_reactor_send(struct mpd_reactor_connection *connection,
+		 mpd_reactor_pair_cb pair_cb, mpd_reactor_done_cb done_cb,
+		 void *ctx, const char *command, ...);
+
+/**
+ * Like mpd_reactor_send(), but parses the response into #mpd_song
+ * objects while it is being received, e.g. for "playlistinfo" or
+ * "find".  Name-value pairs before the first "file" are ignored.
+ *
+ * The done callback is invoked after the last song has been passed
+ * to #song_cb.  If a song cannot be allocated, it reports
+ * #MPD_ERROR_OOM.
+ *
+ * @param song_cb a callback for each song
+ * @param done_cb a callback which is invoked when the response is
+ * complete (may be NULL)
+ * @param ctx an arbitrary pointer passed to the callbacks
+ * @param command the command to be sent
+ * @return true on success, false on error (callbacks are not invoked
+ * then)
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_sentinel
+bool
+mpd_reactor_send_songs(struct mpd_reactor_connection *connection,
+		       mpd_reactor_song_cb song_cb,
+		       mpd_reactor_done_cb done_cb,
+		       void *ctx, const char *command, ...);
+
+/**
+ * Like mpd_reactor_send_songs(), but parses the response into
+ * #mpd_entity objects, e.g. for "lsinfo".
+ *
+ * @since libmpdclient 2.19
+ */
+mpd_sentinel
+bool
+mpd_reactor_send_entities(struct mpd_reactor_connection *connection,
+			  mpd_reactor_entity_cb entity_cb,
+			  mpd_reactor_done_cb done_cb,
+			  void *ctx, const char *command, ...);
+
+/**
+ * Queues the "status" command, and parses its response into a
+ * #mpd_status object.  #status_cb is invoked only if the server has
+ * responded with "OK", right before #done_cb.
+ *
+ * @param status_cb a callback for the parsed status
+ * @param done_cb a callback which is invoked when the response is
+ * complete (may be NULL)
+ * @param ctx an arbitrary pointer passed to the callbacks
+ * @return true on success, false on error (callbacks are not invoked
+ * then)
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_reactor_send_status(struct mpd_reactor_connection *connection,
+			mpd_reactor_status_cb status_cb,
+			mpd_reactor_done_cb done_cb, void *ctx);
+
+/**
+ * Sends all queued commands, waits for events and dispatches them,
+ * invoking the callbacks of all received responses.
+ *
+ * @param timeout_ms the maximum time to wait in milliseconds; 0
+ * means don't wait, and -1 means wait forever
+ * @return the number of connections which had events, or -1 on
+ * error (errno is set)
+ *
+ * @since libmpdclient 2.19
+ */
+int
+mpd_reactor_dispatch(struct mpd_reactor *reactor, int timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
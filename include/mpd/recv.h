@@ -62,6 +62,26 @@ extern "C" {
 bool
 mpd_recv_binary(struct mpd_connection *connection, void *data, size_t length);
 
+/**
+ * Like mpd_recv_binary(), but writes the binary data to a file
+ * descriptor instead of a buffer, e.g. to store album art in a cache
+ * file.  On Linux, the data is moved with splice() and never copied
+ * to userspace.
+ *
+ * If an error occurs, an unknown part of the data may have been
+ * written already.
+ *
+ * @param fd a blocking file descriptor opened for writing; with a
+ * non-blocking one, this fails with EAGAIN when it is not writable
+ * @param length the number of bytes to be received
+ * @return true on success
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_recv_binary_to_fd(struct mpd_connection *connection, int fd,
+		      size_t length);
+
 /**
  * Reads the next #mpd_pair from the server.  Returns NULL if there
  * are no more pairs.
@@ -73,6 +93,28 @@ mpd_malloc
 struct mpd_pair *
 mpd_recv_pair(struct mpd_connection *connection);
 
+/**
+ * Receives multiple pairs at once: waits until at least one response
+ * line is available, and then parses all complete lines from the
+ * input buffer (but not more than #max).  This saves a lot of
+ * overhead when receiving large responses.
+ *
+ * The returned pairs point into the connection's input buffer; they
+ * are valid until the next call to any other function on this
+ * connection.  They do not need to be returned with
+ * mpd_return_pair().
+ *
+ * @param pairs an array where the pairs will be stored
+ * @param max the capacity of the array (must not be 0)
+ * @return the number of pairs stored in the array; 0 if the response
+ * is finished or an error has occurred
+ *
+ * @since libmpdclient 2.19
+ */
+unsigned
+mpd_recv_pairs(struct mpd_connection *connection,
+	       struct mpd_pair *pairs, unsigned max);
+
 /**
  * Same as mpd_recv_pair(), but discards all pairs not matching the
  * specified name.
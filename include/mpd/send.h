@@ -57,6 +57,26 @@ mpd_sentinel
 bool
 mpd_send_command(struct mpd_connection *connection, const char *command, ...);
 
+/**
+ * Sends a command with arguments to the MPD server.  Unlike
+ * mpd_send_command(), the arguments are passed as an array, which
+ * is useful if the number of arguments is only known at runtime.
+ *
+ * The arguments are quoted and copied straight into the output
+ * buffer, which is flushed as often as necessary; there is no limit
+ * on the length of the command.
+ *
+ * @param connection the connection to the MPD server
+ * @param command the command to be sent
+ * @param argv a NULL-terminated array of arguments
+ * @return true on success
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_send_command_argv(struct mpd_connection *connection, const char *command,
+		      const char *const *argv);
+
 #ifdef __cplusplus
 }
 #endif
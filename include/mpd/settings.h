@@ -116,6 +116,29 @@ mpd_settings_get_timeout_ms(const struct mpd_settings *settings);
 const char *
 mpd_settings_get_password(const struct mpd_settings *settings);
 
+/**
+ * Enables or disables the low-latency socket profile (disabled by
+ * default).  It is applied to TCP connections established by
+ * #mpd_connector and #mpd_pool: Nagle's algorithm is disabled
+ * (TCP_NODELAY), and where available, delayed ACKs are suppressed
+ * (TCP_QUICKACK) and the socket busy-polls the network device
+ * (SO_BUSY_POLL) instead of sleeping.  This trades some CPU time
+ * and network efficiency for lower round-trip times.
+ *
+ * @since libmpdclient 2.19
+ */
+void
+mpd_settings_set_low_latency(struct mpd_settings *settings, bool low_latency);
+
+/**
+ * Is the low-latency socket profile enabled?  See
+ * mpd_settings_set_low_latency().
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_settings_get_low_latency(const struct mpd_settings *settings);
+
 #ifdef __cplusplus
 }
 #endif
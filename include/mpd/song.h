@@ -47,6 +47,7 @@
 
 struct mpd_pair;
 struct mpd_connection;
+struct mpd_arena;
 
 /**
  * \struct mpd_song
@@ -62,7 +63,8 @@ extern "C" {
 #endif
 
 /**
- * Free memory allocated by the #mpd_song object.
+ * Free memory allocated by the #mpd_song object.  This does nothing
+ * for songs which were allocated in a #mpd_arena.
  */
 void mpd_song_free(struct mpd_song *song);
 
@@ -224,6 +226,58 @@ mpd_malloc
 struct mpd_song *
 mpd_recv_song(struct mpd_connection *connection);
 
+/**
+ * Like mpd_recv_song(), but allocates the song in the specified
+ * #mpd_arena.  The song is owned by the arena: it is freed by
+ * mpd_arena_reset() or mpd_arena_free(), and must not be used after
+ * that.  Receiving a long song list this way needs only a few large
+ * allocations, and releasing it is one call.
+ *
+ * @param arena the arena which will own the song
+ * @return a #mpd_song object, or NULL on error or if the song list is
+ * finished
+ *
+ * @since libmpdclient 2.19
+ */
+struct mpd_song *
+mpd_recv_song_arena(struct mpd_connection *connection,
+		    struct mpd_arena *arena);
+
+/**
+ * Callback for mpd_recv_songs_cb().
+ *
+ * @param song a read-only song which is only valid until the
+ * callback returns; it must not be freed, but it may be copied with
+ * mpd_song_dup()
+ * @param ctx the pointer passed to mpd_recv_songs_cb()
+ * @return true to receive the next song, false to stop
+ *
+ * @since libmpdclient 2.19
+ */
+typedef bool (*mpd_song_cb)(const struct mpd_song *song, void *ctx);
+
+/**
+ * Receives all songs of the current response, and passes each one to
+ * a callback.  Unlike mpd_recv_song(), this does not allocate an
+ * object for each song: the song passed to the callback is built in
+ * a buffer which is reused for all songs.
+ *
+ * The callback must not call any function on this connection.  If it
+ * returns false, the songs which have already been received but not
+ * passed to the callback are lost; call mpd_response_finish() to
+ * discard the rest of the response.
+ *
+ * @param callback a function which gets called for each song
+ * @param ctx an opaque pointer passed to the callback
+ * @return true on success (the end of the response was reached or the
+ * callback has stopped), false on error
+ *
+ * @since libmpdclient 2.19
+ */
+bool
+mpd_recv_songs_cb(struct mpd_connection *connection,
+		  mpd_song_cb callback, void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
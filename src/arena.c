@@ -0,0 +1,153 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "iarena.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+/**
+ * The size of the first chunk.  Each following chunk is twice as
+ * large as its predecessor, up to #MPD_ARENA_MAX_CHUNK_SIZE, so
+ * small arenas stay small, and large ones consist of few chunks,
+ * which makes freeing them cheap.
+ */
+static const size_t MPD_ARENA_MIN_CHUNK_SIZE = 16384;
+static const size_t MPD_ARENA_MAX_CHUNK_SIZE = 1024 * 1024;
+
+struct mpd_arena_chunk {
+	struct mpd_arena_chunk *next;
+
+	/** the number of bytes in #data */
+	size_t size;
+
+	/** the number of bytes of #data which are allocated */
+	size_t used;
+
+	/* force maximum alignment of the data */
+	union {
+		long long l;
+		long double d;
+		void *p;
+	} data[];
+};
+
+static void
+mpd_arena_free_chunks(struct mpd_arena_chunk *chunk)
+{
+	while (chunk != NULL) {
+		struct mpd_arena_chunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+}
+
+struct mpd_arena *
+mpd_arena_new(void)
+{
+	struct mpd_arena *arena = malloc(sizeof(*arena));
+	if (arena == NULL)
+		/* out of memory */
+		return NULL;
+
+	arena->head = NULL;
+	return arena;
+}
+
+void
+mpd_arena_free(struct mpd_arena *arena)
+{
+	assert(arena != NULL);
+
+	mpd_arena_free_chunks(arena->head);
+	free(arena);
+}
+
+void
+mpd_arena_reset(struct mpd_arena *arena)
+{
+	assert(arena != NULL);
+
+	/* keep the largest chunk; this is usually the head, unless
+	   an oversized allocation got a chunk of its own */
+	struct mpd_arena_chunk *largest = arena->head;
+	if (largest == NULL)
+		return;
+
+	for (struct mpd_arena_chunk *chunk = largest->next;
+	     chunk != NULL; chunk = chunk->next)
+		if (chunk->size > largest->size)
+			largest = chunk;
+
+	for (struct mpd_arena_chunk *chunk = arena->head, *next;
+	     chunk != NULL; chunk = next) {
+		next = chunk->next;
+		if (chunk != largest)
+			free(chunk);
+	}
+
+	largest->next = NULL;
+	largest->used = 0;
+	arena->head = largest;
+}
+
+void *
+mpd_arena_alloc(struct mpd_arena *arena, size_t size)
+{
+	assert(arena != NULL);
+
+	const size_t align = sizeof(((struct mpd_arena_chunk *)NULL)->data[0]);
+	size = (size + align - 1) & ~(align - 1);
+
+	struct mpd_arena_chunk *chunk = arena->head;
+	if (chunk == NULL || chunk->size - chunk->used < size) {
+		size_t chunk_size = MPD_ARENA_MIN_CHUNK_SIZE;
+		if (chunk != NULL) {
+			chunk_size = 2 * (sizeof(*chunk) + chunk->size);
+			if (chunk_size > MPD_ARENA_MAX_CHUNK_SIZE)
+				chunk_size = MPD_ARENA_MAX_CHUNK_SIZE;
+		}
+
+		chunk_size -= sizeof(*chunk);
+		if (chunk_size < size)
+			chunk_size = size;
+
+		chunk = malloc(sizeof(*chunk) + chunk_size);
+		if (chunk == NULL)
+			return NULL;
+
+		chunk->next = arena->head;
+		chunk->size = chunk_size;
+		chunk->used = 0;
+		arena->head = chunk;
+	}
+
+	void *p = (char *)chunk->data + chunk->used;
+	chunk->used += size;
+	return p;
+}
@@ -26,6 +26,7 @@
    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#include "config.h"
 #include "iasync.h"
 #include "buffer.h"
 #include "ierror.h"
@@ -46,14 +47,29 @@
 #ifndef __MINGW32__
 typedef SSIZE_T ssize_t;
 #endif
+#  include <io.h>
 #else
 #  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+
+#ifdef HAVE_SPLICE
+#  include <fcntl.h>
+#  include <errno.h>
 #endif
 
 #ifndef MSG_DONTWAIT
 #define MSG_DONTWAIT 0
 #endif
 
+/**
+ * The default limit for the input buffer size (and thus for the
+ * length of a response line).
+ */
+enum {
+	MPD_ASYNC_DEFAULT_INPUT_LIMIT = 1024 * 1024,
+};
+
 struct mpd_async {
 	mpd_socket_t fd;
 
@@ -62,6 +78,22 @@ struct mpd_async {
 	struct mpd_buffer input;
 
 	struct mpd_buffer output;
+
+#ifdef HAVE_SPLICE
+	/**
+	 * A pipe used by mpd_async_recv_to_fd() to splice() data
+	 * from the socket to a file descriptor.  It is created on
+	 * demand; -1 if it has not been created yet.
+	 */
+	int pipe_fds[2];
+
+	/**
+	 * Has splice() failed with EINVAL, i.e. is it not supported
+	 * for this socket, this kernel or a destination file
+	 * descriptor?
+	 */
+	bool no_splice;
+#endif
 };
 
 struct mpd_async *
@@ -79,8 +111,15 @@ mpd_async_new(int fd)
 	mpd_error_init(&async->error);
 
 	mpd_buffer_init(&async->input);
+	mpd_buffer_set_max_size(&async->input, MPD_ASYNC_DEFAULT_INPUT_LIMIT);
+
 	mpd_buffer_init(&async->output);
 
+#ifdef HAVE_SPLICE
+	async->pipe_fds[0] = async->pipe_fds[1] = -1;
+	async->no_splice = false;
+#endif
+
 	return async;
 }
 
@@ -91,6 +130,15 @@ mpd_async_free(struct mpd_async *async)
 
 	mpd_socket_close(async->fd);
 	mpd_error_deinit(&async->error);
+	mpd_buffer_deinit(&async->input);
+	mpd_buffer_deinit(&async->output);
+
+#ifdef HAVE_SPLICE
+	if (async->pipe_fds[0] >= 0) {
+		close(async->pipe_fds[0]);
+		close(async->pipe_fds[1]);
+	}
+#endif
 	free(async);
 }
 
@@ -147,6 +195,29 @@ mpd_async_set_keepalive(struct mpd_async *async,
 	return mpd_socket_keepalive(async->fd, keepalive) == 0;
 }
 
+void
+mpd_async_set_input_buffer_limit(struct mpd_async *async, size_t max_size)
+{
+	assert(async != NULL);
+
+	mpd_buffer_set_max_size(&async->input, max_size);
+}
+
+bool
+mpd_async_set_ring_buffer(struct mpd_async *async)
+{
+	assert(async != NULL);
+
+	if (async->input.mirrored)
+		return true;
+
+	/* the mirror can only replace an empty buffer; without it,
+	   mpd_buffer_write_tail() moves partial lines only when
+	   necessary */
+	return mpd_buffer_size(&async->input) == 0 &&
+		mpd_buffer_enable_mirror(&async->input);
+}
+
 enum mpd_async_event
 mpd_async_events(const struct mpd_async *async)
 {
@@ -176,6 +247,7 @@ mpd_async_events(const struct mpd_async *async)
 static bool
 mpd_async_read(struct mpd_async *async)
 {
+	void *dest;
 	size_t room;
 	ssize_t nbytes;
 
@@ -183,12 +255,11 @@ mpd_async_read(struct mpd_async *async)
 	assert(async->fd != MPD_INVALID_SOCKET);
 	assert(!mpd_error_is_defined(&async->error));
 
-	room = mpd_buffer_room(&async->input);
-	if (room == 0)
+	if (mpd_buffer_full(&async->input))
 		return true;
 
-	nbytes = recv(async->fd, mpd_buffer_write(&async->input), room,
-		      MSG_DONTWAIT);
+	dest = mpd_buffer_write_tail(&async->input, &room);
+	nbytes = recv(async->fd, dest, room, MSG_DONTWAIT);
 	if (nbytes < 0) {
 		/* I/O error */
 
@@ -346,6 +417,335 @@ mpd_async_send_command(struct mpd_async *async, const char *command, ...)
 	return success;
 }
 
+void *
+mpd_async_input_tail(struct mpd_async *async, size_t *room_r)
+{
+	assert(async != NULL);
+	assert(room_r != NULL);
+
+	if (mpd_buffer_full(&async->input)) {
+		*room_r = 0;
+		return NULL;
+	}
+
+	return mpd_buffer_write_tail(&async->input, room_r);
+}
+
+void
+mpd_async_input_commit(struct mpd_async *async, size_t nbytes)
+{
+	assert(async != NULL);
+
+	mpd_buffer_expand(&async->input, nbytes);
+}
+
+size_t
+mpd_async_take_output(struct mpd_async *async, void *dest, size_t max_length)
+{
+	size_t size;
+
+	assert(async != NULL);
+	assert(dest != NULL);
+
+	size = mpd_buffer_size(&async->output);
+	if (size == 0)
+		return 0;
+
+	if (size > max_length)
+		size = max_length;
+
+	memcpy(dest, mpd_buffer_read(&async->output), size);
+	mpd_buffer_consume(&async->output, size);
+	return size;
+}
+
+size_t
+mpd_async_fill(struct mpd_async *async)
+{
+	size_t old_size;
+
+	assert(async != NULL);
+
+	if (mpd_error_is_defined(&async->error))
+		return 0;
+
+	old_size = mpd_buffer_size(&async->input);
+	if (!mpd_async_read(async))
+		return 0;
+
+	return mpd_buffer_size(&async->input) - old_size;
+}
+
+size_t
+mpd_async_recv_direct(struct mpd_async *async, void *dest, size_t length)
+{
+	ssize_t nbytes;
+
+	assert(async != NULL);
+	assert(dest != NULL);
+	assert(length > 0);
+
+	if (mpd_error_is_defined(&async->error))
+		return 0;
+
+	if (mpd_buffer_size(&async->input) > 0)
+		/* drain the input buffer first */
+		return mpd_async_recv_raw(async, dest, length);
+
+	nbytes = recv(async->fd, dest, length, MSG_DONTWAIT);
+	if (nbytes < 0) {
+		if (!mpd_socket_ignore_errno(mpd_socket_errno()))
+			mpd_error_errno(&async->error);
+		return 0;
+	}
+
+	if (nbytes == 0) {
+		mpd_error_code(&async->error, MPD_ERROR_CLOSED);
+		mpd_error_message(&async->error,
+				  "Connection closed by the server");
+		return 0;
+	}
+
+	return (size_t)nbytes;
+}
+
+/**
+ * Stores an error after writing to the destination file descriptor of
+ * mpd_async_recv_to_fd() has failed.
+ */
+static void
+mpd_async_write_fd_error(struct mpd_async *async, ssize_t nbytes)
+{
+	if (nbytes < 0)
+		mpd_error_errno(&async->error);
+	else {
+		mpd_error_system(&async->error, 0);
+		mpd_error_message(&async->error,
+				  "Failed to write to the file descriptor");
+	}
+}
+
+#ifdef HAVE_SPLICE
+
+/**
+ * Copies data which is left in the pipe to the file descriptor with
+ * read() and write(), after splice() has failed to move it.
+ *
+ * @return true on success, false on error (which is then stored in
+ * #async)
+ */
+static bool
+mpd_async_drain_pipe(struct mpd_async *async, int fd, size_t remaining)
+{
+	char buffer[4096];
+
+	while (remaining > 0) {
+		ssize_t nbytes = read(async->pipe_fds[0], buffer,
+				      remaining < sizeof(buffer)
+				      ? remaining : sizeof(buffer));
+		if (nbytes <= 0) {
+			/* cannot happen: the pipe contains enough
+			   data */
+			mpd_error_errno(&async->error);
+			return false;
+		}
+
+		remaining -= (size_t)nbytes;
+
+		for (const char *p = buffer; nbytes > 0;) {
+			ssize_t n = write(fd, p, nbytes);
+			if (n <= 0) {
+				mpd_async_write_fd_error(async, n);
+				return false;
+			}
+
+			p += n;
+			nbytes -= n;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Moves data from the socket to the file descriptor through a pipe,
+ * without copying it to userspace.
+ *
+ * @return the number of bytes moved, 0 if no data is available (or
+ * on error, which is then stored in #async), or -1 if splice() is not
+ * supported
+ */
+static ssize_t
+mpd_async_splice(struct mpd_async *async, int fd, size_t length)
+{
+	ssize_t nbytes, remaining;
+
+	if (async->pipe_fds[0] < 0 &&
+	    pipe2(async->pipe_fds, O_CLOEXEC|O_NONBLOCK) < 0) {
+		async->pipe_fds[0] = -1;
+		mpd_error_errno(&async->error);
+		return 0;
+	}
+
+	nbytes = splice(async->fd, NULL, async->pipe_fds[1], NULL, length,
+			SPLICE_F_MOVE|SPLICE_F_NONBLOCK);
+	if (nbytes < 0) {
+		if (errno == EINVAL) {
+			async->no_splice = true;
+			return -1;
+		}
+
+		if (!mpd_socket_ignore_errno(errno))
+			mpd_error_errno(&async->error);
+		return 0;
+	}
+
+	if (nbytes == 0) {
+		mpd_error_code(&async->error, MPD_ERROR_CLOSED);
+		mpd_error_message(&async->error,
+				  "Connection closed by the server");
+		return 0;
+	}
+
+	/* the data is in the pipe now; it must be moved to the
+	   destination completely, or else the pipe would contain
+	   stale data */
+	for (remaining = nbytes; remaining > 0;) {
+		ssize_t n = splice(async->pipe_fds[0], NULL, fd, NULL,
+				   remaining, SPLICE_F_MOVE);
+		if (n < 0 && errno == EINVAL) {
+			/* the destination does not support splice()
+			   (e.g. O_APPEND); the data has already left
+			   the socket, so copy it from the pipe, and
+			   don't splice again */
+			async->no_splice = true;
+			if (!mpd_async_drain_pipe(async, fd,
+						  (size_t)remaining))
+				return 0;
+
+			break;
+		}
+
+		if (n <= 0) {
+			mpd_async_write_fd_error(async, n);
+			return 0;
+		}
+
+		remaining -= n;
+	}
+
+	return nbytes;
+}
+
+#endif
+
+size_t
+mpd_async_recv_to_fd(struct mpd_async *async, int fd, size_t length)
+{
+	size_t size;
+	ssize_t nbytes;
+
+	assert(async != NULL);
+	assert(fd >= 0);
+	assert(length > 0);
+
+	if (mpd_error_is_defined(&async->error))
+		return 0;
+
+#ifdef HAVE_SPLICE
+	if (mpd_buffer_size(&async->input) == 0 && !async->no_splice) {
+		nbytes = mpd_async_splice(async, fd, length);
+		if (nbytes >= 0)
+			return (size_t)nbytes;
+	}
+#endif
+
+	if (mpd_buffer_size(&async->input) == 0 &&
+	    !mpd_async_read(async))
+		return 0;
+
+	/* write the buffered data */
+
+	size = mpd_buffer_size(&async->input);
+	if (size == 0)
+		return 0;
+
+	if (length > size)
+		length = size;
+
+	nbytes = write(fd, mpd_buffer_read(&async->input), length);
+	if (nbytes <= 0) {
+		mpd_async_write_fd_error(async, nbytes);
+		return 0;
+	}
+
+	mpd_buffer_consume(&async->input, (size_t)nbytes);
+	return (size_t)nbytes;
+}
+
+size_t
+mpd_async_append_raw(struct mpd_async *async,
+		     const char *data, size_t length)
+{
+	size_t room;
+
+	assert(async != NULL);
+	assert(data != NULL || length == 0);
+
+	if (mpd_error_is_defined(&async->error))
+		return 0;
+
+	room = mpd_buffer_room(&async->output);
+	if (room == 0)
+		return 0;
+
+	if (length > room)
+		length = room;
+
+	memcpy(mpd_buffer_write(&async->output), data, length);
+	mpd_buffer_expand(&async->output, length);
+	return length;
+}
+
+size_t
+mpd_async_append_escaped(struct mpd_async *async, const char *value)
+{
+	size_t room;
+	char *dest, *p, *end;
+	const char *src = value;
+
+	assert(async != NULL);
+	assert(value != NULL);
+
+	if (mpd_error_is_defined(&async->error))
+		return 0;
+
+	room = mpd_buffer_room(&async->output);
+	if (room == 0)
+		return 0;
+
+	dest = p = mpd_buffer_write(&async->output);
+	end = dest + room;
+
+	while (*src != 0) {
+		char ch = *src;
+
+		if (ch == '"' || ch == '\\') {
+			if (end - p < 2)
+				break;
+
+			*p++ = '\\';
+		} else if (p >= end)
+			break;
+
+		*p++ = ch;
+		++src;
+	}
+
+	mpd_buffer_expand(&async->output, p - dest);
+	return src - value;
+}
+
 char *
 mpd_async_recv_line(struct mpd_async *async)
 {
@@ -364,11 +764,17 @@ mpd_async_recv_line(struct mpd_async *async)
 	if (newline == NULL) {
 		/* line is not finished yet */
 		if (mpd_buffer_full(&async->input)) {
-			/* .. but the buffer is full - line is too
-			   long, abort connection and bail out */
-			mpd_error_code(&async->error, MPD_ERROR_MALFORMED);
-			mpd_error_message(&async->error,
-					  "Response line too large");
+			/* .. but the buffer is full - grow it to make
+			   room for the rest of the line */
+			if (!mpd_buffer_can_grow(&async->input)) {
+				/* the line is too long, abort the
+				   connection and bail out */
+				mpd_error_code(&async->error,
+					       MPD_ERROR_MALFORMED);
+				mpd_error_message(&async->error,
+						  "Response line too large");
+			} else if (!mpd_buffer_grow(&async->input))
+				mpd_error_code(&async->error, MPD_ERROR_OOM);
 		}
 
 		return NULL;
@@ -380,6 +786,218 @@ mpd_async_recv_line(struct mpd_async *async)
 	return src;
 }
 
+#ifndef HAVE_MEMMEM
+
+static void *
+memmem(const void *haystack, size_t haystack_length,
+       const void *needle, size_t needle_length)
+{
+	const char *p = haystack, *const end = p + haystack_length;
+	const char first = *(const char *)needle;
+
+	while ((size_t)(end - p) >= needle_length) {
+		p = memchr(p, first, end - p - needle_length + 1);
+		if (p == NULL)
+			return NULL;
+
+		if (memcmp(p, needle, needle_length) == 0)
+			return (void *)p;
+
+		++p;
+	}
+
+	return NULL;
+}
+
+#endif
+
+enum skip_line_type {
+	/** an ordinary line which can be discarded */
+	SKIP_LINE_OTHER,
+
+	/** a line which finishes the response */
+	SKIP_LINE_END,
+
+	/** a "binary" line which announces a binary chunk */
+	SKIP_LINE_BINARY,
+
+	/** not enough data to decide */
+	SKIP_LINE_UNKNOWN,
+};
+
+/**
+ * Checks whether the data begins with the given prefix.
+ *
+ * @return 1 on match, 0 on mismatch, -1 if there is not enough data
+ * to decide
+ */
+static int
+skip_prefix(const char *p, size_t available,
+	    const char *prefix, size_t length)
+{
+	if (available < length)
+		return memcmp(p, prefix, available) == 0 ? -1 : 0;
+
+	return memcmp(p, prefix, length) == 0;
+}
+
+static enum skip_line_type
+skip_classify_line(const char *p, size_t available)
+{
+	int match;
+
+	switch (*p) {
+	case 'O':
+		match = skip_prefix(p, available, "OK\n", 3);
+		break;
+
+	case 'l':
+		match = skip_prefix(p, available, "list_OK\n", 8);
+		break;
+
+	case 'A':
+		match = skip_prefix(p, available, "ACK ", 4);
+		break;
+
+	case 'b':
+		match = skip_prefix(p, available, "binary: ", 8);
+		if (match > 0)
+			return SKIP_LINE_BINARY;
+		break;
+
+	default:
+		return SKIP_LINE_OTHER;
+	}
+
+	if (match < 0)
+		return SKIP_LINE_UNKNOWN;
+
+	return match > 0 ? SKIP_LINE_END : SKIP_LINE_OTHER;
+}
+
+/**
+ * Finds the first line (after the first one) which must not be
+ * skipped blindly.
+ *
+ * @return a pointer to the newline preceding that line, or NULL
+ */
+static const char *
+skip_find_line(const char *src, size_t size)
+{
+	static const struct {
+		const char *value;
+		size_t length;
+	} needles[] = {
+		{ "\nOK\n", 4 },
+		{ "\nlist_OK\n", 9 },
+		{ "\nACK ", 5 },
+		{ "\nbinary: ", 9 },
+	};
+
+	const char *found = NULL;
+	for (unsigned i = 0; i < sizeof(needles) / sizeof(needles[0]); ++i) {
+		/* only look for matches which begin before the
+		   best one so far */
+		size_t length = size;
+		if (found != NULL) {
+			length = found - src + needles[i].length - 1;
+			if (length > size)
+				length = size;
+		}
+
+		const char *p = memmem(src, length, needles[i].value,
+				       needles[i].length);
+		if (p != NULL)
+			found = p;
+	}
+
+	return found;
+}
+
+bool
+mpd_async_skip_response(struct mpd_async *async, struct mpd_async_skip *skip)
+{
+	assert(async != NULL);
+	assert(skip != NULL);
+
+	while (true) {
+		const size_t size = mpd_buffer_size(&async->input);
+		if (size == 0)
+			return false;
+
+		const char *src = mpd_buffer_read(&async->input);
+
+		if (skip->binary > 0) {
+			size_t nbytes = size < skip->binary
+				? size
+				: skip->binary;
+			mpd_buffer_consume(&async->input, nbytes);
+			skip->binary -= nbytes;
+
+			/* the newline after the chunk remains */
+			skip->mid_line = skip->binary == 0;
+			continue;
+		}
+
+		if (skip->mid_line) {
+			const char *newline = memchr(src, '\n', size);
+			if (newline == NULL) {
+				mpd_buffer_consume(&async->input, size);
+				return false;
+			}
+
+			mpd_buffer_consume(&async->input, newline + 1 - src);
+			skip->mid_line = false;
+			continue;
+		}
+
+		/* the input buffer begins with a new line */
+
+		switch (skip_classify_line(src, size)) {
+		case SKIP_LINE_OTHER:
+			break;
+
+		case SKIP_LINE_END:
+			return true;
+
+		case SKIP_LINE_BINARY: {
+			const char *newline = memchr(src, '\n', size);
+			if (newline == NULL)
+				return false;
+
+			skip->binary = strtoul(src + 8, NULL, 10);
+			skip->mid_line = skip->binary == 0;
+			mpd_buffer_consume(&async->input, newline + 1 - src);
+			continue;
+		}
+
+		case SKIP_LINE_UNKNOWN:
+			return false;
+		}
+
+		const char *found = skip_find_line(src, size);
+		if (found != NULL) {
+			mpd_buffer_consume(&async->input, found + 1 - src);
+			continue;
+		}
+
+		/* discard all complete lines; the rest of the last
+		   one may still be one of the lines we look for */
+		const char *last = src + size;
+		while (last > src && last[-1] != '\n')
+			--last;
+
+		if (last == src) {
+			/* one incomplete ordinary line */
+			mpd_buffer_consume(&async->input, size);
+			skip->mid_line = true;
+		} else
+			mpd_buffer_consume(&async->input, last - src);
+
+		return false;
+	}
+}
+
 size_t
 mpd_async_recv_raw(struct mpd_async *async, void *dest, size_t length)
 {
@@ -31,33 +31,34 @@
 */
 
 #include "iaf.h"
+#include "decimal.h"
 #include <mpd/audio_format.h>
 
-#include <stdlib.h>
 #include <string.h>
 
 void
 mpd_parse_audio_format(struct mpd_audio_format *audio_format, const char *p)
 {
-	char *endptr;
+	const char *endptr;
 
 	if (strncmp(p, "dsd", 3) == 0) {
 		/* allow format specifications such as "dsd64" which
 		   implies the sample rate */
 
-		unsigned long dsd = strtoul(p + 3, &endptr, 10);
+		unsigned dsd = mpd_decimal_parse_unsigned(p + 3, &endptr);
 		if (endptr > p + 3 && *endptr == ':' &&
 		    dsd >= 32 && dsd <= 4096 && dsd % 2 == 0) {
 			audio_format->sample_rate = dsd * 44100 / 8;
 			audio_format->bits = MPD_SAMPLE_FORMAT_DSD;
 
 			p = endptr + 1;
-			audio_format->channels = strtoul(p, NULL, 10);
+			audio_format->channels =
+				mpd_decimal_parse_unsigned(p, NULL);
 			return;
 		}
 	}
 
-	audio_format->sample_rate = strtoul(p, &endptr, 10);
+	audio_format->sample_rate = mpd_decimal_parse_unsigned(p, &endptr);
 	if (*endptr == ':') {
 		p = endptr + 1;
 
@@ -69,12 +70,13 @@ mpd_parse_audio_format(struct mpd_audio_format *audio_format, const char *p)
 			audio_format->bits = MPD_SAMPLE_FORMAT_DSD;
 			p += 4;
 		} else {
-			audio_format->bits = strtoul(p, &endptr, 10);
+			audio_format->bits =
+				mpd_decimal_parse_unsigned(p, &endptr);
 			p = *endptr == ':' ? endptr + 1 : NULL;
 		}
 
 		audio_format->channels = p != NULL
-			? strtoul(p, NULL, 10)
+			? mpd_decimal_parse_unsigned(p, NULL)
 			: 0;
 	} else {
 		audio_format->bits = 0;
@@ -0,0 +1,453 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <mpd/batch.h>
+#include <mpd/connection.h>
+#include <mpd/list.h>
+#include <mpd/queue.h>
+#include <mpd/recv.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include <mpd/song.h>
+#include <mpd/status.h>
+#include "internal.h"
+#include "buffer.h"
+#include "run.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * How the response of a command is parsed, and the type of
+ * #mpd_batch_command::result.
+ */
+enum mpd_batch_result {
+	/** the response is discarded; no result */
+	MPD_BATCH_NONE,
+
+	/** an "Id" pair; int */
+	MPD_BATCH_ID,
+
+	/** struct mpd_status * */
+	MPD_BATCH_STATUS,
+
+	/** struct mpd_song * */
+	MPD_BATCH_SONG,
+};
+
+struct mpd_batch_command {
+	/**
+	 * The command name and its arguments, NULL-terminated.  The
+	 * strings are allocated together with the array.
+	 */
+	char **argv;
+
+	/** the length of the command line sent to MPD */
+	size_t length;
+
+	enum mpd_batch_result type;
+
+	/** where the result is stored; see #mpd_batch_result */
+	void *result;
+
+	/** if not NULL, set to true when the command succeeds */
+	bool *success_r;
+};
+
+struct mpd_batch {
+	struct mpd_batch_command *commands;
+
+	unsigned n_commands, capacity;
+};
+
+static const char command_list_begin[] = "command_list_ok_begin\n";
+static const char command_list_end[] = "command_list_end\n";
+
+struct mpd_batch *
+mpd_batch_new(void)
+{
+	struct mpd_batch *batch = malloc(sizeof(*batch));
+	if (batch == NULL)
+		return NULL;
+
+	batch->commands = NULL;
+	batch->n_commands = batch->capacity = 0;
+	return batch;
+}
+
+static void
+mpd_batch_clear(struct mpd_batch *batch)
+{
+	for (unsigned i = 0; i < batch->n_commands; ++i)
+		free(batch->commands[i].argv);
+
+	batch->n_commands = 0;
+}
+
+void
+mpd_batch_free(struct mpd_batch *batch)
+{
+	mpd_batch_clear(batch);
+	free(batch->commands);
+	free(batch);
+}
+
+unsigned
+mpd_batch_get_length(const struct mpd_batch *batch)
+{
+	return batch->n_commands;
+}
+
+/**
+ * Returns the length of a quoted argument, including the leading
+ * space.
+ */
+static size_t
+quoted_length(const char *value)
+{
+	size_t length = 3 + strlen(value);
+
+	for (const char *p = value; *p != 0; ++p)
+		if (*p == '"' || *p == '\\')
+			++length;
+
+	return length;
+}
+
+/**
+ * Resets the result of a command to the "not executed" value.
+ */
+static void
+mpd_batch_reset_result(const struct mpd_batch_command *command)
+{
+	if (command->success_r != NULL)
+		*command->success_r = false;
+
+	switch (command->type) {
+	case MPD_BATCH_NONE:
+		break;
+
+	case MPD_BATCH_ID:
+		*(int *)command->result = -1;
+		break;
+
+	case MPD_BATCH_STATUS:
+		*(struct mpd_status **)command->result = NULL;
+		break;
+
+	case MPD_BATCH_SONG:
+		*(struct mpd_song **)command->result = NULL;
+		break;
+	}
+}
+
+/**
+ * Appends a command to the batch.
+ *
+ * @param argv the command name and its arguments, NULL-terminated
+ */
+static bool
+mpd_batch_push(struct mpd_batch *batch, enum mpd_batch_result type,
+	       void *result, bool *success_r, const char *const *argv)
+{
+	if (batch->n_commands == batch->capacity) {
+		unsigned capacity = batch->capacity > 0
+			? batch->capacity * 2
+			: 16;
+		struct mpd_batch_command *commands =
+			realloc(batch->commands,
+				capacity * sizeof(commands[0]));
+		if (commands == NULL)
+			return false;
+
+		batch->commands = commands;
+		batch->capacity = capacity;
+	}
+
+	unsigned argc = 0;
+	size_t size = 0;
+	size_t length = strlen(argv[0]) + 1;
+	for (; argv[argc] != NULL; ++argc) {
+		size += strlen(argv[argc]) + 1;
+		if (argc > 0)
+			length += quoted_length(argv[argc]);
+	}
+
+	char **copy = malloc((argc + 1) * sizeof(copy[0]) + size);
+	if (copy == NULL)
+		return false;
+
+	char *p = (char *)(copy + argc + 1);
+	for (unsigned i = 0; i < argc; ++i) {
+		const size_t n = strlen(argv[i]) + 1;
+		memcpy(p, argv[i], n);
+		copy[i] = p;
+		p += n;
+	}
+
+	copy[argc] = NULL;
+
+	struct mpd_batch_command *command =
+		&batch->commands[batch->n_commands++];
+	command->argv = copy;
+	command->length = length;
+	command->type = type;
+	command->result = result;
+	command->success_r = success_r;
+
+	mpd_batch_reset_result(command);
+	return true;
+}
+
+bool
+mpd_batch_command(struct mpd_batch *batch, bool *success_r,
+		  const char *command, ...)
+{
+	va_list ap;
+	unsigned n = 1;
+
+	va_start(ap, command);
+	while (va_arg(ap, const char *) != NULL)
+		++n;
+	va_end(ap);
+
+	const char **argv = malloc((n + 1) * sizeof(argv[0]));
+	if (argv == NULL)
+		return false;
+
+	argv[0] = command;
+	va_start(ap, command);
+	for (unsigned i = 1; i <= n; ++i)
+		argv[i] = va_arg(ap, const char *);
+	va_end(ap);
+
+	bool success = mpd_batch_push(batch, MPD_BATCH_NONE, NULL,
+				      success_r, argv);
+	free(argv);
+	return success;
+}
+
+bool
+mpd_batch_add_id(struct mpd_batch *batch, const char *uri, int *id_r)
+{
+	const char *const argv[] = { "addid", uri, NULL };
+	return mpd_batch_push(batch, MPD_BATCH_ID, id_r, NULL, argv);
+}
+
+bool
+mpd_batch_status(struct mpd_batch *batch, struct mpd_status **status_r)
+{
+	const char *const argv[] = { "status", NULL };
+	return mpd_batch_push(batch, MPD_BATCH_STATUS, status_r, NULL, argv);
+}
+
+bool
+mpd_batch_current_song(struct mpd_batch *batch, struct mpd_song **song_r)
+{
+	const char *const argv[] = { "currentsong", NULL };
+	return mpd_batch_push(batch, MPD_BATCH_SONG, song_r, NULL, argv);
+}
+
+bool
+mpd_batch_get_queue_song_id(struct mpd_batch *batch, unsigned id,
+			    struct mpd_song **song_r)
+{
+	char id_string[16];
+	snprintf(id_string, sizeof(id_string), "%u", id);
+
+	const char *const argv[] = { "playlistid", id_string, NULL };
+	return mpd_batch_push(batch, MPD_BATCH_SONG, song_r, NULL, argv);
+}
+
+/**
+ * Determines how many commands starting at #start fit into one
+ * command list which fits into the output buffer.  It contains at
+ * least one command.
+ *
+ * @return the index after the last command of the block
+ */
+static unsigned
+mpd_batch_block_end(const struct mpd_batch *batch, unsigned start)
+{
+	size_t size = sizeof(command_list_begin) - 1 +
+		sizeof(command_list_end) - 1 +
+		batch->commands[start].length;
+	unsigned end = start + 1;
+
+	while (end < batch->n_commands &&
+	       size + batch->commands[end].length <= MPD_BUFFER_INITIAL_SIZE)
+		size += batch->commands[end++].length;
+
+	return end;
+}
+
+static bool
+mpd_batch_send_block(const struct mpd_batch *batch,
+		     struct mpd_connection *connection,
+		     unsigned start, unsigned end)
+{
+	if (!mpd_command_list_begin(connection, true))
+		return false;
+
+	for (unsigned i = start; i < end; ++i) {
+		char *const *argv = batch->commands[i].argv;
+		if (!mpd_send_command_argv(connection, argv[0],
+					   (const char *const *)argv + 1))
+			return false;
+	}
+
+	return mpd_command_list_end(connection);
+}
+
+/**
+ * Receives the response of one command inside the command list, and
+ * stores its result.
+ */
+static void
+mpd_batch_receive_result(const struct mpd_batch_command *command,
+			 struct mpd_connection *connection)
+{
+	switch (command->type) {
+	case MPD_BATCH_NONE:
+		break;
+
+	case MPD_BATCH_ID:
+		*(int *)command->result = mpd_recv_song_id(connection);
+		break;
+
+	case MPD_BATCH_STATUS:
+		*(struct mpd_status **)command->result =
+			mpd_recv_status(connection);
+		break;
+
+	case MPD_BATCH_SONG:
+		*(struct mpd_song **)command->result =
+			mpd_recv_song(connection);
+		break;
+	}
+}
+
+/**
+ * Frees a result which was received before the command failed.
+ */
+static void
+mpd_batch_discard_result(const struct mpd_batch_command *command)
+{
+	switch (command->type) {
+	case MPD_BATCH_NONE:
+	case MPD_BATCH_ID:
+		break;
+
+	case MPD_BATCH_STATUS:
+		if (*(struct mpd_status **)command->result != NULL)
+			mpd_status_free(*(struct mpd_status **)command->result);
+		break;
+
+	case MPD_BATCH_SONG:
+		if (*(struct mpd_song **)command->result != NULL)
+			mpd_song_free(*(struct mpd_song **)command->result);
+		break;
+	}
+
+	mpd_batch_reset_result(command);
+}
+
+/**
+ * Receives the responses of a block.  A server error ends the block
+ * early: the failed command is recorded in #first_error, and the
+ * commands after it have not been executed.
+ *
+ * @param start_r the first command of the block; on return, the
+ * first command which has not been executed
+ * @return false if the connection has failed
+ */
+static bool
+mpd_batch_receive_block(const struct mpd_batch *batch,
+			struct mpd_connection *connection,
+			unsigned *start_r, unsigned end,
+			struct mpd_error_info *first_error)
+{
+	for (unsigned i = *start_r; i < end; ++i) {
+		const struct mpd_batch_command *command =
+			&batch->commands[i];
+
+		mpd_batch_receive_result(command, connection);
+
+		if (!mpd_error_is_defined(&connection->error) &&
+		    mpd_response_next(connection)) {
+			if (command->success_r != NULL)
+				*command->success_r = true;
+			continue;
+		}
+
+		mpd_batch_discard_result(command);
+		*start_r = i + 1;
+
+		if (connection->error.code != MPD_ERROR_SERVER)
+			return false;
+
+		if (!mpd_error_is_defined(first_error)) {
+			mpd_error_copy(first_error, &connection->error);
+			first_error->at = i;
+		}
+
+		return mpd_connection_clear_error(connection);
+	}
+
+	*start_r = end;
+	return mpd_response_finish(connection);
+}
+
+bool
+mpd_batch_commit(struct mpd_batch *batch, struct mpd_connection *connection)
+{
+	struct mpd_error_info first_error;
+	mpd_error_init(&first_error);
+
+	bool success = mpd_run_check(connection);
+	for (unsigned start = 0; success && start < batch->n_commands;) {
+		const unsigned end = mpd_batch_block_end(batch, start);
+		success = mpd_batch_send_block(batch, connection,
+					       start, end) &&
+			mpd_batch_receive_block(batch, connection,
+						&start, end, &first_error);
+	}
+
+	mpd_batch_clear(batch);
+
+	if (success && mpd_error_is_defined(&first_error)) {
+		mpd_error_copy(&connection->error, &first_error);
+		success = false;
+	}
+
+	mpd_error_deinit(&first_error);
+	return success;
+}
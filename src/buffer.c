@@ -0,0 +1,180 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "buffer.h"
+
+#include <mpd/compiler.h>
+
+#ifdef HAVE_MEMFD_CREATE
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/**
+ * Round up to the page size, because mmap() can only map whole pages.
+ */
+static size_t
+page_align(size_t size)
+{
+	const long page_size = sysconf(_SC_PAGESIZE);
+	const size_t mask = page_size > 0 ? (size_t)page_size - 1 : 4095;
+
+	return (size + mask) & ~mask;
+}
+
+/**
+ * Creates an anonymous shared memory object and maps it twice, back
+ * to back.
+ *
+ * @return the address of the first mapping or NULL on error
+ */
+static unsigned char *
+mirror_map(size_t size)
+{
+	int fd = memfd_create("mpd_buffer", MFD_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+
+	if (ftruncate(fd, (off_t)size) < 0) {
+		close(fd);
+		return NULL;
+	}
+
+	/* reserve the address range for both mappings */
+	unsigned char *p = mmap(NULL, size * 2, PROT_NONE,
+				MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		close(fd);
+		return NULL;
+	}
+
+	if (mmap(p, size, PROT_READ|PROT_WRITE,
+		 MAP_SHARED|MAP_FIXED, fd, 0) == MAP_FAILED ||
+	    mmap(p + size, size, PROT_READ|PROT_WRITE,
+		 MAP_SHARED|MAP_FIXED, fd, 0) == MAP_FAILED) {
+		munmap(p, size * 2);
+		close(fd);
+		return NULL;
+	}
+
+	/* the mappings keep the memory alive */
+	close(fd);
+
+#ifdef MADV_DONTFORK
+	/* unlike the heap, a MAP_SHARED mapping would not be copied
+	   on write after fork(), and parent and child would corrupt
+	   each other's input; don't let the child inherit it at all */
+	if (madvise(p, size * 2, MADV_DONTFORK) < 0) {
+		munmap(p, size * 2);
+		return NULL;
+	}
+#endif
+
+	return p;
+}
+
+bool
+mpd_buffer_enable_mirror(struct mpd_buffer *buffer)
+{
+	assert(!buffer->mirrored);
+	assert(buffer->data == buffer->initial);
+	assert(buffer->read == buffer->write);
+
+	const size_t size = page_align(buffer->size);
+	unsigned char *data = mirror_map(size);
+	if (data == NULL)
+		return false;
+
+	buffer->data = data;
+	buffer->size = size;
+	buffer->read = buffer->write = 0;
+	buffer->mirrored = true;
+	return true;
+}
+
+bool
+mpd_buffer_mirror_resize(struct mpd_buffer *buffer, size_t new_size)
+{
+	assert(buffer->mirrored);
+
+	new_size = page_align(new_size);
+	if (new_size == buffer->size)
+		return true;
+
+	const size_t length = mpd_buffer_size(buffer);
+	assert(length <= new_size);
+
+	unsigned char *data = mirror_map(new_size);
+	if (data == NULL)
+		return false;
+
+	/* thanks to the mirror, the old data is contiguous */
+	memcpy(data, buffer->data + buffer->read, length);
+	munmap(buffer->data, buffer->size * 2);
+
+	buffer->data = data;
+	buffer->size = new_size;
+	buffer->read = 0;
+	buffer->write = length;
+	return true;
+}
+
+void
+mpd_buffer_mirror_free(struct mpd_buffer *buffer)
+{
+	assert(buffer->mirrored);
+
+	munmap(buffer->data, buffer->size * 2);
+}
+
+#else
+
+bool
+mpd_buffer_enable_mirror(mpd_unused struct mpd_buffer *buffer)
+{
+	return false;
+}
+
+bool
+mpd_buffer_mirror_resize(mpd_unused struct mpd_buffer *buffer,
+			 mpd_unused size_t new_size)
+{
+	/* unreachable: the buffer is never mirrored */
+	assert(false);
+	return false;
+}
+
+void
+mpd_buffer_mirror_free(mpd_unused struct mpd_buffer *buffer)
+{
+	/* unreachable: the buffer is never mirrored */
+	assert(false);
+}
+
+#endif
@@ -32,22 +32,95 @@
 #include <assert.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
 
 /**
- * A fixed 4kB buffer which can be appended at the end, and consumed
- * at the beginning.
+ * The initial (and minimum) size of a #mpd_buffer.  This many bytes
+ * are embedded in the struct; only larger buffers are allocated on
+ * the heap.
+ */
+#define MPD_BUFFER_INITIAL_SIZE 4096
+
+/**
+ * Remapping a mirrored buffer is expensive, so after it has grown, it
+ * is shrunk only after it was found empty this many times in a row,
+ * without holding more than #MPD_BUFFER_INITIAL_SIZE bytes in
+ * between.
+ */
+#define MPD_BUFFER_MIRROR_SHRINK_DELAY 64
+
+/**
+ * A buffer which can be appended at the end, and consumed at the
+ * beginning.  It starts with 4kB, and may grow up to a configurable
+ * maximum size (see mpd_buffer_grow()).  The data is always
+ * contiguous, which allows zero-copy parsing.
+ *
+ * If mpd_buffer_enable_mirror() succeeds, the buffer is a ring: its
+ * memory is mapped twice, back to back, so data which wraps around
+ * the end is still contiguous, and it never needs to be moved.  The
+ * mapping is not inherited by child processes.
  */
 struct mpd_buffer {
 	/** the next buffer position to write to */
-	unsigned write;
+	size_t write;
 
 	/** the next buffer position to read from */
-	unsigned read;
+	size_t read;
+
+	/** the allocated size of #data */
+	size_t size;
 
-	/** the actual buffer */
-	unsigned char data[4096];
+	/** mpd_buffer_grow() will not go beyond this size */
+	size_t max_size;
+
+	/**
+	 * The actual buffer; points either to #initial, to a heap
+	 * allocation or to a mirrored mapping.
+	 */
+	unsigned char *data;
+
+	/**
+	 * Is #data followed by a second mapping of the same memory?
+	 * Then #write may exceed #size (but not #read + #size).
+	 */
+	bool mirrored;
+
+	/**
+	 * How many more times must the grown mirrored buffer be found
+	 * empty before it is shrunk?  See
+	 * #MPD_BUFFER_MIRROR_SHRINK_DELAY.
+	 */
+	unsigned shrink_countdown;
+
+	/** the embedded buffer which is used until we need to grow */
+	unsigned char initial[MPD_BUFFER_INITIAL_SIZE];
 };
 
+/**
+ * Replaces the (empty) buffer with a mirrored mapping of the same
+ * size, see #mpd_buffer.
+ *
+ * @return false if this is not supported on this platform (or
+ * failed); the buffer is unchanged then
+ */
+bool
+mpd_buffer_enable_mirror(struct mpd_buffer *buffer);
+
+/**
+ * Replaces the mirrored mapping with a new one of the specified size,
+ * preserving the buffer contents.
+ *
+ * @return false on error; the buffer is unchanged then
+ */
+bool
+mpd_buffer_mirror_resize(struct mpd_buffer *buffer, size_t new_size);
+
+/**
+ * Releases the mirrored mapping.
+ */
+void
+mpd_buffer_mirror_free(struct mpd_buffer *buffer);
+
 /**
  * Initialize an empty buffer.
  */
@@ -56,6 +129,36 @@ mpd_buffer_init(struct mpd_buffer *buffer)
 {
 	buffer->read = 0;
 	buffer->write = 0;
+	buffer->size = sizeof(buffer->initial);
+	buffer->max_size = sizeof(buffer->initial);
+	buffer->data = buffer->initial;
+	buffer->mirrored = false;
+	buffer->shrink_countdown = MPD_BUFFER_MIRROR_SHRINK_DELAY;
+}
+
+/**
+ * Free the heap allocation (if any).
+ */
+static inline void
+mpd_buffer_deinit(struct mpd_buffer *buffer)
+{
+	if (buffer->mirrored)
+		mpd_buffer_mirror_free(buffer);
+	else if (buffer->data != buffer->initial)
+		free(buffer->data);
+}
+
+/**
+ * Sets the maximum size mpd_buffer_grow() may allocate.  It cannot be
+ * smaller than #MPD_BUFFER_INITIAL_SIZE.  An existing allocation which
+ * is larger is kept until it is released by mpd_buffer_write().
+ */
+static inline void
+mpd_buffer_set_max_size(struct mpd_buffer *buffer, size_t max_size)
+{
+	buffer->max_size = max_size > sizeof(buffer->initial)
+		? max_size
+		: sizeof(buffer->initial);
 }
 
 /**
@@ -65,6 +168,10 @@ mpd_buffer_init(struct mpd_buffer *buffer)
 static inline void
 mpd_buffer_move(struct mpd_buffer *buffer)
 {
+	if (buffer->mirrored)
+		/* no need to move anything */
+		return;
+
 	memmove(buffer->data, buffer->data + buffer->read,
 		buffer->write - buffer->read);
 
@@ -72,6 +179,20 @@ mpd_buffer_move(struct mpd_buffer *buffer)
 	buffer->read = 0;
 }
 
+/**
+ * Determines how many bytes can be read from the pointer returned by
+ * mpd_buffer_read().
+ */
+static inline size_t
+mpd_buffer_size(const struct mpd_buffer *buffer)
+{
+	assert(buffer->read <= buffer->write);
+	assert(buffer->write - buffer->read <= buffer->size);
+	assert(buffer->mirrored || buffer->write <= buffer->size);
+
+	return buffer->write - buffer->read;
+}
+
 /**
  * Determines how many bytes can be written to the buffer returned by
  * mpd_buffer_write().
@@ -79,10 +200,7 @@ mpd_buffer_move(struct mpd_buffer *buffer)
 static inline size_t
 mpd_buffer_room(const struct mpd_buffer *buffer)
 {
-	assert(buffer->write <= sizeof(buffer->data));
-	assert(buffer->read <= buffer->write);
-
-	return sizeof(buffer->data) - (buffer->write - buffer->read);
+	return buffer->size - mpd_buffer_size(buffer);
 }
 
 /**
@@ -94,6 +212,101 @@ mpd_buffer_full(const struct mpd_buffer *buffer)
 	return mpd_buffer_room(buffer) == 0;
 }
 
+/**
+ * Checks if mpd_buffer_grow() may enlarge the buffer.
+ */
+static inline bool
+mpd_buffer_can_grow(const struct mpd_buffer *buffer)
+{
+	return buffer->size < buffer->max_size;
+}
+
+/**
+ * Doubles the size of the buffer (but not beyond the configured
+ * maximum size).  All pointers returned by mpd_buffer_read() are
+ * invalidated.
+ *
+ * Call mpd_buffer_can_grow() before calling this function.
+ *
+ * @return false if out of memory
+ */
+static inline bool
+mpd_buffer_grow(struct mpd_buffer *buffer)
+{
+	size_t new_size;
+	unsigned char *new_data;
+
+	assert(mpd_buffer_can_grow(buffer));
+
+	new_size = buffer->size * 2;
+	if (new_size > buffer->max_size)
+		new_size = buffer->max_size;
+
+	if (buffer->mirrored) {
+		buffer->shrink_countdown = MPD_BUFFER_MIRROR_SHRINK_DELAY;
+		return mpd_buffer_mirror_resize(buffer, new_size);
+	}
+
+	new_data = malloc(new_size);
+	if (new_data == NULL)
+		return false;
+
+	memcpy(new_data, buffer->data + buffer->read,
+	       buffer->write - buffer->read);
+
+	if (buffer->data != buffer->initial)
+		free(buffer->data);
+
+	buffer->data = new_data;
+	buffer->size = new_size;
+	buffer->write -= buffer->read;
+	buffer->read = 0;
+	return true;
+}
+
+/**
+ * The mirrored part of mpd_buffer_shrink(), with the delay described
+ * at #MPD_BUFFER_MIRROR_SHRINK_DELAY.
+ */
+static inline void
+mpd_buffer_mirror_shrink(struct mpd_buffer *buffer)
+{
+	if (buffer->size <= sizeof(buffer->initial) ||
+	    buffer->read != buffer->write ||
+	    --buffer->shrink_countdown > 0)
+		return;
+
+	/* if this fails, we just keep the large mapping */
+	mpd_buffer_mirror_resize(buffer, sizeof(buffer->initial));
+	buffer->shrink_countdown = MPD_BUFFER_MIRROR_SHRINK_DELAY;
+}
+
+/**
+ * Releases the large allocation if the buffer is empty, and goes back
+ * to the initial size.  A mirrored buffer is shrunk only after it has
+ * not been needed for a while.
+ */
+static inline void
+mpd_buffer_shrink(struct mpd_buffer *buffer)
+{
+	if (buffer->mirrored) {
+		mpd_buffer_mirror_shrink(buffer);
+		return;
+	}
+
+	if (buffer->read != buffer->write)
+		return;
+
+	if (buffer->data == buffer->initial)
+		return;
+
+	free(buffer->data);
+	buffer->data = buffer->initial;
+	buffer->size = sizeof(buffer->initial);
+	buffer->read = 0;
+	buffer->write = 0;
+}
+
 /**
  * Returns a pointer to write new data into.  After you have done
  * that, call mpd_buffer_expand().
@@ -103,32 +316,54 @@ mpd_buffer_write(struct mpd_buffer *buffer)
 {
 	assert(mpd_buffer_room(buffer) > 0);
 
+	mpd_buffer_shrink(buffer);
 	mpd_buffer_move(buffer);
 	return buffer->data + buffer->write;
 }
 
 /**
- * Moves the "write" pointer.
+ * Like mpd_buffer_write(), but avoids moving data if possible: the
+ * valid data is moved to the beginning of the buffer only if that
+ * gains more room than there is at the end of the buffer.  A
+ * mirrored buffer never moves data.
+ *
+ * @param length_r returns the number of bytes which may be written
+ * to the returned pointer (always at least 1)
  */
-static inline void
-mpd_buffer_expand(struct mpd_buffer *buffer, size_t nbytes)
+static inline void *
+mpd_buffer_write_tail(struct mpd_buffer *buffer, size_t *length_r)
 {
-	assert(mpd_buffer_room(buffer) >= nbytes);
+	assert(mpd_buffer_room(buffer) > 0);
 
-	buffer->write += nbytes;
+	mpd_buffer_shrink(buffer);
+
+	if (buffer->read == buffer->write) {
+		/* the buffer is empty: rewind without copying */
+		buffer->read = buffer->write = 0;
+	} else if (!buffer->mirrored &&
+		   buffer->size - buffer->write < buffer->read)
+		mpd_buffer_move(buffer);
+
+	*length_r = buffer->mirrored
+		? mpd_buffer_room(buffer)
+		: buffer->size - buffer->write;
+	return buffer->data + buffer->write;
 }
 
 /**
- * Determines how many bytes can be read from the pointer returned by
- * mpd_buffer_read().
+ * Moves the "write" pointer.
  */
-static inline size_t
-mpd_buffer_size(const struct mpd_buffer *buffer)
+static inline void
+mpd_buffer_expand(struct mpd_buffer *buffer, size_t nbytes)
 {
-	assert(buffer->write <= sizeof(buffer->data));
-	assert(buffer->read <= buffer->write);
+	assert(mpd_buffer_room(buffer) >= nbytes);
 
-	return buffer->write - buffer->read;
+	buffer->write += nbytes;
+
+	if (buffer->mirrored &&
+	    mpd_buffer_size(buffer) > sizeof(buffer->initial))
+		/* the grown mirrored buffer is still needed */
+		buffer->shrink_countdown = MPD_BUFFER_MIRROR_SHRINK_DELAY;
 }
 
 /**
@@ -152,6 +387,13 @@ mpd_buffer_consume(struct mpd_buffer *buffer, size_t nbytes)
 	assert(nbytes <= mpd_buffer_size(buffer));
 
 	buffer->read += nbytes;
+
+	if (buffer->read >= buffer->size) {
+		/* wrap around in the mirrored buffer (or rewind the
+		   empty linear buffer) */
+		buffer->read -= buffer->size;
+		buffer->write -= buffer->size;
+	}
 }
 
 #endif
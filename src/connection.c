@@ -38,6 +38,7 @@
 #include <mpd/socket.h>
 
 #include "resolver.h"
+#include "isend.h"
 #include "sync.h"
 #include "socket.h"
 #include "internal.h"
@@ -48,6 +49,12 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _WIN32
+#  include <winsock2.h>
+#else
+#  include <sys/time.h>
+#endif
+
 #define MPD_WELCOME_MESSAGE	"OK MPD "
 
 static bool
@@ -121,9 +128,12 @@ mpd_connection_new(const char *host, unsigned port, unsigned timeout_ms)
 	connection->async = NULL;
 	connection->parser = NULL;
 	connection->receiving = false;
+	connection->corked = false;
+	connection->queued_responses = 0;
 	connection->sending_command_list = false;
 	connection->pair_state = PAIR_STATE_NONE;
 	connection->request = NULL;
+	connection->deadline_ms = -1;
 
 	if (!mpd_socket_global_init(&connection->error))
 		return connection;
@@ -131,9 +141,14 @@ mpd_connection_new(const char *host, unsigned port, unsigned timeout_ms)
 	mpd_connection_set_timeout(connection,
 				   mpd_settings_get_timeout_ms(settings));
 
+	const struct timeval connect_timeout = {
+		.tv_sec = connection->timeout_ms / 1000,
+		.tv_usec = (connection->timeout_ms % 1000) * 1000,
+	};
+
 	host = mpd_settings_get_host(settings);
 	fd = mpd_socket_connect(host, mpd_settings_get_port(settings),
-				&connection->timeout, &connection->error);
+				&connect_timeout, &connection->error);
 	if (fd == MPD_INVALID_SOCKET) {
 #if defined(DEFAULT_SOCKET) && defined(ENABLE_TCP)
 		if (host == NULL || strcmp(host, DEFAULT_SOCKET) == 0) {
@@ -151,7 +166,7 @@ mpd_connection_new(const char *host, unsigned port, unsigned timeout_ms)
 
 			mpd_error_clear(&connection->error);
 			fd = mpd_socket_connect(DEFAULT_HOST, DEFAULT_PORT,
-						&connection->timeout,
+						&connect_timeout,
 						&connection->error);
 		}
 #endif
@@ -173,7 +188,8 @@ mpd_connection_new(const char *host, unsigned port, unsigned timeout_ms)
 		return connection;
 	}
 
-	line = mpd_sync_recv_line(connection->async, &connection->timeout);
+	line = mpd_sync_recv_line(connection->async,
+				  mpd_connection_deadline(connection));
 	if (line == NULL) {
 		mpd_connection_sync_error(connection);
 		return connection;
@@ -204,10 +220,12 @@ mpd_connection_new_async(struct mpd_async *async, const char *welcome)
 	mpd_error_init(&connection->error);
 	connection->settings = NULL;
 	connection->async = async;
-	connection->timeout.tv_sec = 30;
-	connection->timeout.tv_usec = 0;
+	connection->timeout_ms = 30000;
+	connection->deadline_ms = -1;
 	connection->parser = NULL;
 	connection->receiving = false;
+	connection->corked = false;
+	connection->queued_responses = 0;
 	connection->sending_command_list = false;
 	connection->pair_state = PAIR_STATE_NONE;
 	connection->request = NULL;
@@ -255,6 +273,39 @@ mpd_connection_set_keepalive(struct mpd_connection *connection,
 	return mpd_async_set_keepalive(connection->async, keepalive);
 }
 
+bool
+mpd_connection_cork(struct mpd_connection *connection)
+{
+	assert(connection != NULL);
+
+	if (mpd_error_is_defined(&connection->error))
+		return false;
+
+	if (connection->sending_command_list) {
+		mpd_error_code(&connection->error, MPD_ERROR_STATE);
+		mpd_error_message(&connection->error,
+				  "Not possible in command list mode");
+		return false;
+	}
+
+	connection->corked = true;
+	return true;
+}
+
+bool
+mpd_connection_uncork(struct mpd_connection *connection)
+{
+	assert(connection != NULL);
+
+	if (!connection->corked)
+		return true;
+
+	connection->corked = false;
+
+	return !mpd_error_is_defined(&connection->error) &&
+		mpd_flush(connection);
+}
+
 const struct mpd_settings *
 mpd_connection_get_settings(const struct mpd_connection *connection)
 {
@@ -269,8 +320,16 @@ mpd_connection_set_timeout(struct mpd_connection *connection,
 {
 	assert(timeout_ms > 0);
 
-	connection->timeout.tv_sec = timeout_ms / 1000;
-	connection->timeout.tv_usec = timeout_ms % 1000;
+	connection->timeout_ms = timeout_ms;
+}
+
+void
+mpd_connection_set_deadline(struct mpd_connection *connection,
+			    unsigned timeout_ms)
+{
+	assert(connection != NULL);
+
+	connection->deadline_ms = mpd_clock_now_ms() + timeout_ms;
 }
 
 int
@@ -0,0 +1,676 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "internal.h"
+#include "iasync.h"
+#include "resolver.h"
+#include "socket.h"
+#include "ierror.h"
+#include "clock.h"
+
+#include <mpd/connector.h>
+#include <mpd/async.h>
+#include <mpd/connection.h>
+#include <mpd/parser.h>
+#include <mpd/settings.h>
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#  include <winsock2.h>
+#else
+#  include <sys/time.h>
+#endif
+
+enum mpd_connector_phase {
+	/** waiting for the resolver thread */
+	PHASE_RESOLVE,
+
+	/** connection attempts are in progress */
+	PHASE_CONNECT,
+
+	/** waiting for the "OK MPD" line */
+	PHASE_WELCOME,
+
+	/** waiting for the response to the "password" command */
+	PHASE_PASSWORD,
+
+	PHASE_READY,
+	PHASE_FAILED,
+};
+
+struct mpd_connector {
+	struct mpd_settings *settings;
+
+	enum mpd_connector_phase phase;
+
+	/** the overall deadline [CLOCK_MONOTONIC milliseconds] */
+	long long deadline_ms;
+
+#ifndef _WIN32
+	/** the resolver thread; only valid in #PHASE_RESOLVE */
+	struct resolver_async *resolving;
+#endif
+
+	/**
+	 * The resolver which owns the memory of #addresses; only
+	 * valid in #PHASE_CONNECT.
+	 */
+	struct resolver *resolver;
+
+	struct resolver_address addresses[MPD_SOCKET_MAX_ADDRESSES];
+	unsigned n_addresses, next_address;
+
+	/**
+	 * The sockets with a connection attempt in progress; the
+	 * last one is the newest.
+	 */
+	mpd_socket_t fds[MPD_SOCKET_MAX_ADDRESSES];
+	unsigned n_fds;
+
+	/** when to start the next connection attempt */
+	long long next_attempt_ms;
+
+	/** valid in #PHASE_WELCOME and #PHASE_PASSWORD */
+	struct mpd_async *async;
+
+	/** a copy of the welcome line, valid in #PHASE_PASSWORD */
+	char *welcome;
+
+	/** the result, valid in #PHASE_READY */
+	struct mpd_connection *connection;
+
+	struct mpd_error_info error;
+};
+
+struct mpd_connector *
+mpd_connector_new(const struct mpd_settings *settings)
+{
+	assert(settings != NULL);
+
+	struct mpd_connector *connector = malloc(sizeof(*connector));
+	if (connector == NULL)
+		return NULL;
+
+	connector->settings =
+		mpd_settings_new(mpd_settings_get_host(settings),
+				 mpd_settings_get_port(settings),
+				 mpd_settings_get_timeout_ms(settings),
+				 NULL,
+				 mpd_settings_get_password(settings));
+	if (connector->settings == NULL) {
+		free(connector);
+		return NULL;
+	}
+
+	mpd_settings_set_low_latency(connector->settings,
+				     mpd_settings_get_low_latency(settings));
+
+	connector->phase = PHASE_RESOLVE;
+	connector->deadline_ms = mpd_clock_now_ms() +
+		mpd_settings_get_timeout_ms(connector->settings);
+#ifndef _WIN32
+	connector->resolving = NULL;
+#endif
+	connector->resolver = NULL;
+	connector->n_addresses = connector->next_address = 0;
+	connector->n_fds = 0;
+	connector->async = NULL;
+	connector->welcome = NULL;
+	connector->connection = NULL;
+	mpd_error_init(&connector->error);
+
+	return connector;
+}
+
+static void
+mpd_connector_close_attempts(struct mpd_connector *connector)
+{
+	while (connector->n_fds > 0)
+		mpd_socket_close(connector->fds[--connector->n_fds]);
+
+	if (connector->resolver != NULL) {
+		resolver_free(connector->resolver);
+		connector->resolver = NULL;
+	}
+}
+
+/**
+ * Frees all resources except for the result and the error.
+ */
+static void
+mpd_connector_cleanup(struct mpd_connector *connector)
+{
+#ifndef _WIN32
+	if (connector->resolving != NULL) {
+		resolver_async_free(connector->resolving);
+		connector->resolving = NULL;
+	}
+#endif
+
+	mpd_connector_close_attempts(connector);
+
+	if (connector->async != NULL) {
+		mpd_async_free(connector->async);
+		connector->async = NULL;
+	}
+
+	free(connector->welcome);
+	connector->welcome = NULL;
+}
+
+void
+mpd_connector_free(struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	mpd_connector_cleanup(connector);
+
+	if (connector->connection != NULL)
+		mpd_connection_free(connector->connection);
+
+	mpd_error_deinit(&connector->error);
+	mpd_settings_free(connector->settings);
+	free(connector);
+}
+
+/**
+ * Switches to #PHASE_FAILED; the error must have been set already.
+ */
+static void
+mpd_connector_fail(struct mpd_connector *connector)
+{
+	assert(mpd_error_is_defined(&connector->error));
+
+	mpd_connector_cleanup(connector);
+	connector->phase = PHASE_FAILED;
+}
+
+static void
+mpd_connector_fail_async(struct mpd_connector *connector)
+{
+	mpd_error_clear(&connector->error);
+	if (!mpd_async_copy_error(connector->async, &connector->error))
+		mpd_error_code(&connector->error, MPD_ERROR_OOM);
+
+	mpd_connector_fail(connector);
+}
+
+/**
+ * The host name has been resolved: prepare the connection attempts.
+ */
+static void
+mpd_connector_resolved(struct mpd_connector *connector,
+		       struct resolver *resolver)
+{
+	if (resolver == NULL) {
+		mpd_error_code(&connector->error, MPD_ERROR_RESOLVER);
+		mpd_error_message(&connector->error,
+				  "Failed to resolve host name");
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	connector->resolver = resolver;
+	connector->n_addresses =
+		mpd_socket_collect_addresses(resolver, connector->addresses);
+	connector->next_address = 0;
+	connector->next_attempt_ms = mpd_clock_now_ms();
+	connector->phase = PHASE_CONNECT;
+}
+
+static void
+mpd_connector_resolve(struct mpd_connector *connector)
+{
+	const char *host = mpd_settings_get_host(connector->settings);
+	const unsigned port = mpd_settings_get_port(connector->settings);
+
+#ifndef _WIN32
+	if (connector->resolving == NULL) {
+		struct resolver *resolver;
+		if (resolver_new_nonblocking(host, port, &resolver)) {
+			/* local socket, numeric address or cache hit:
+			   no thread needed */
+			mpd_connector_resolved(connector, resolver);
+			return;
+		}
+
+		connector->resolving = resolver_async_new(host, port);
+		if (connector->resolving == NULL) {
+			mpd_error_errno(&connector->error);
+			mpd_connector_fail(connector);
+		}
+
+		return;
+	}
+
+	if (!resolver_async_is_done(connector->resolving))
+		return;
+
+	struct resolver *resolver =
+		resolver_async_take(connector->resolving);
+	resolver_async_free(connector->resolving);
+	connector->resolving = NULL;
+
+	mpd_connector_resolved(connector, resolver);
+#else
+	/* there is no resolver thread on Windows */
+	mpd_connector_resolved(connector, resolver_new(host, port));
+#endif
+}
+
+/**
+ * The connection has been established: wait for the welcome line.
+ */
+static void
+mpd_connector_connected(struct mpd_connector *connector, mpd_socket_t fd)
+{
+	mpd_connector_close_attempts(connector);
+
+	if (mpd_settings_get_low_latency(connector->settings))
+		mpd_socket_low_latency(fd);
+
+	connector->async = mpd_async_new(fd);
+	if (connector->async == NULL) {
+		mpd_socket_close(fd);
+		mpd_error_code(&connector->error, MPD_ERROR_OOM);
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	connector->phase = PHASE_WELCOME;
+}
+
+static void
+mpd_connector_connect(struct mpd_connector *connector)
+{
+	/* check all pending attempts, not only the one whose file
+	   descriptor the caller is waiting on */
+	for (unsigned i = 0; i < connector->n_fds;) {
+		mpd_socket_t fd = connector->fds[i];
+		struct timeval zero = { 0, 0 };
+
+		if (mpd_socket_poll(fd, MPD_ASYNC_EVENT_WRITE|
+				    MPD_ASYNC_EVENT_HUP|MPD_ASYNC_EVENT_ERROR,
+				    &zero) == 0) {
+			++i;
+			continue;
+		}
+
+		/* remove it from the array, keeping the order */
+		--connector->n_fds;
+		memmove(connector->fds + i, connector->fds + i + 1,
+			(connector->n_fds - i) * sizeof(connector->fds[0]));
+
+		int s_err = mpd_socket_connect_result(fd);
+		if (s_err == 0) {
+			mpd_connector_connected(connector, fd);
+			return;
+		}
+
+		mpd_error_clear(&connector->error);
+		mpd_error_system_message(&connector->error, s_err);
+		mpd_socket_close(fd);
+	}
+
+	/* start the next attempt if it is due, or if there is no
+	   other attempt in progress */
+	const long long now = mpd_clock_now_ms();
+	while (connector->next_address < connector->n_addresses &&
+	       (connector->n_fds == 0 || now >= connector->next_attempt_ms)) {
+		const struct resolver_address *address =
+			&connector->addresses[connector->next_address++];
+		mpd_socket_t fd = mpd_socket_start_connect(address,
+							   &connector->error);
+		if (fd == MPD_INVALID_SOCKET)
+			/* failed immediately; try the next address */
+			continue;
+
+		connector->fds[connector->n_fds++] = fd;
+		connector->next_attempt_ms = now + MPD_SOCKET_ATTEMPT_DELAY_MS;
+		break;
+	}
+
+	if (connector->n_fds == 0) {
+		/* all attempts have failed */
+		if (!mpd_error_is_defined(&connector->error)) {
+			mpd_error_code(&connector->error, MPD_ERROR_RESOLVER);
+			mpd_error_message(&connector->error,
+					  "Failed to resolve host name");
+		}
+
+		mpd_connector_fail(connector);
+	} else
+		/* forget errors of earlier attempts */
+		mpd_error_clear(&connector->error);
+}
+
+/**
+ * All done: create the #mpd_connection object.
+ */
+static void
+mpd_connector_finish(struct mpd_connector *connector, const char *welcome)
+{
+	struct mpd_connection *connection =
+		mpd_connection_new_async(connector->async, welcome);
+	if (connection == NULL) {
+		mpd_error_code(&connector->error, MPD_ERROR_OOM);
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	/* the connection owns the mpd_async object now */
+	connector->async = NULL;
+
+	if (mpd_error_is_defined(&connection->error)) {
+		mpd_error_copy(&connector->error, &connection->error);
+		mpd_connection_free(connection);
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	mpd_connection_set_timeout(connection,
+				   mpd_settings_get_timeout_ms(connector->settings));
+
+	mpd_connector_cleanup(connector);
+	connector->connection = connection;
+	connector->phase = PHASE_READY;
+}
+
+static void
+mpd_connector_welcome(struct mpd_connector *connector, char *line)
+{
+	if (strncmp(line, "OK MPD ", 7) != 0) {
+		mpd_error_code(&connector->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connector->error,
+				  "Malformed connect message received");
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	const char *password =
+		mpd_settings_get_password(connector->settings);
+	if (password == NULL) {
+		mpd_connector_finish(connector, line);
+		return;
+	}
+
+	connector->welcome = strdup(line);
+	if (connector->welcome == NULL) {
+		mpd_error_code(&connector->error, MPD_ERROR_OOM);
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	if (!mpd_async_send_command(connector->async, "password",
+				    password, NULL)) {
+		mpd_connector_fail_async(connector);
+		return;
+	}
+
+	connector->phase = PHASE_PASSWORD;
+}
+
+static void
+mpd_connector_password(struct mpd_connector *connector, char *line)
+{
+	struct mpd_parser *parser = mpd_parser_new();
+	if (parser == NULL) {
+		mpd_error_code(&connector->error, MPD_ERROR_OOM);
+		mpd_connector_fail(connector);
+		return;
+	}
+
+	const char *message;
+
+	switch (mpd_parser_feed(parser, line)) {
+	case MPD_PARSER_SUCCESS:
+		mpd_parser_free(parser);
+		mpd_connector_finish(connector, connector->welcome);
+		return;
+
+	case MPD_PARSER_ERROR:
+		mpd_error_server(&connector->error,
+				 mpd_parser_get_server_error(parser),
+				 mpd_parser_get_at(parser));
+		message = mpd_parser_get_message(parser);
+		mpd_error_message(&connector->error,
+				  message != NULL
+				  ? message : "Unspecified MPD error");
+		break;
+
+	case MPD_PARSER_MALFORMED:
+	case MPD_PARSER_PAIR:
+		mpd_error_code(&connector->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connector->error,
+				  "Unexpected response to the password command");
+		break;
+	}
+
+	mpd_parser_free(parser);
+	mpd_connector_fail(connector);
+}
+
+/**
+ * Performs I/O on the #mpd_async object, and handles the response
+ * line if there is one.
+ */
+static void
+mpd_connector_io(struct mpd_connector *connector,
+		 enum mpd_async_event events)
+{
+	if (events != 0 && !mpd_async_io(connector->async, events)) {
+		mpd_connector_fail_async(connector);
+		return;
+	}
+
+	char *line = mpd_async_recv_line(connector->async);
+	if (line == NULL) {
+		if (mpd_async_get_error(connector->async) != MPD_ERROR_SUCCESS)
+			mpd_connector_fail_async(connector);
+		return;
+	}
+
+	if (connector->phase == PHASE_WELCOME)
+		mpd_connector_welcome(connector, line);
+	else
+		mpd_connector_password(connector, line);
+}
+
+enum mpd_connector_state
+mpd_connector_step(struct mpd_connector *connector,
+		   enum mpd_async_event events)
+{
+	assert(connector != NULL);
+
+	enum mpd_connector_phase old_phase;
+
+	/* keep going as long as progress is made without
+	   waiting */
+	do {
+		old_phase = connector->phase;
+
+		switch (connector->phase) {
+		case PHASE_RESOLVE:
+			mpd_connector_resolve(connector);
+			break;
+
+		case PHASE_CONNECT:
+			mpd_connector_connect(connector);
+			break;
+
+		case PHASE_WELCOME:
+		case PHASE_PASSWORD:
+			mpd_connector_io(connector, events);
+			break;
+
+		case PHASE_READY:
+			return MPD_CONNECTOR_READY;
+
+		case PHASE_FAILED:
+			return MPD_CONNECTOR_FAILED;
+		}
+
+		/* the events belong to the old file descriptor */
+		events = 0;
+	} while (connector->phase != old_phase);
+
+	if (mpd_clock_now_ms() >= connector->deadline_ms) {
+		mpd_error_code(&connector->error, MPD_ERROR_TIMEOUT);
+		mpd_error_message(&connector->error,
+				  "Timeout while connecting");
+		mpd_connector_fail(connector);
+		return MPD_CONNECTOR_FAILED;
+	}
+
+	return MPD_CONNECTOR_RUNNING;
+}
+
+int
+mpd_connector_get_fd(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	switch (connector->phase) {
+	case PHASE_RESOLVE:
+#ifndef _WIN32
+		if (connector->resolving != NULL)
+			return resolver_async_get_fd(connector->resolving);
+#endif
+		break;
+
+	case PHASE_CONNECT:
+		if (connector->n_fds > 0)
+			return connector->fds[connector->n_fds - 1];
+		break;
+
+	case PHASE_WELCOME:
+	case PHASE_PASSWORD:
+		return mpd_async_get_fd(connector->async);
+
+	case PHASE_READY:
+	case PHASE_FAILED:
+		break;
+	}
+
+	return -1;
+}
+
+enum mpd_async_event
+mpd_connector_get_events(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	switch (connector->phase) {
+	case PHASE_RESOLVE:
+		return MPD_ASYNC_EVENT_READ;
+
+	case PHASE_CONNECT:
+		return MPD_ASYNC_EVENT_WRITE;
+
+	case PHASE_WELCOME:
+	case PHASE_PASSWORD:
+		return mpd_async_events(connector->async);
+
+	case PHASE_READY:
+	case PHASE_FAILED:
+		break;
+	}
+
+	return 0;
+}
+
+int
+mpd_connector_get_timeout(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	if (connector->phase == PHASE_READY ||
+	    connector->phase == PHASE_FAILED)
+		return -1;
+
+	long long until = connector->deadline_ms;
+
+	if (connector->phase == PHASE_CONNECT &&
+	    (connector->next_address < connector->n_addresses ||
+	     connector->n_fds > 1)) {
+		/* the next attempt is due, or older attempts (which
+		   the caller does not watch) need to be checked */
+		long long next = connector->next_attempt_ms;
+		if (connector->next_address >= connector->n_addresses)
+			next = mpd_clock_now_ms() + MPD_SOCKET_ATTEMPT_DELAY_MS;
+		if (next < until)
+			until = next;
+	}
+
+	long long timeout = until - mpd_clock_now_ms();
+	if (timeout < 0)
+		return 0;
+
+	return (int)timeout;
+}
+
+struct mpd_connection *
+mpd_connector_get_connection(struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+	assert(connector->phase == PHASE_READY);
+	assert(connector->connection != NULL);
+
+	struct mpd_connection *connection = connector->connection;
+	connector->connection = NULL;
+	return connection;
+}
+
+enum mpd_error
+mpd_connector_get_error(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	return connector->error.code;
+}
+
+const char *
+mpd_connector_get_error_message(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+
+	return mpd_error_get_message(&connector->error);
+}
+
+enum mpd_server_error
+mpd_connector_get_server_error(const struct mpd_connector *connector)
+{
+	assert(connector != NULL);
+	assert(connector->error.code == MPD_ERROR_SERVER);
+
+	return connector->error.server;
+}
@@ -0,0 +1,87 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "decimal.h"
+
+#include <stdlib.h>
+
+/**
+ * Powers of ten which are exactly representable as double.
+ */
+static const double mpd_decimal_pow10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+double
+mpd_decimal_parse_double(const char *p)
+{
+	const char *const start = p;
+
+	const bool negative = *p == '-';
+	if (negative)
+		++p;
+
+	/* if the mantissa fits in 53 bits and is multiplied or
+	   divided by an exact power of ten, the result is correctly
+	   rounded, i.e. the same as strtod()'s */
+	unsigned long long mantissa = 0;
+	unsigned n_digits = 0, n_fraction = 0;
+
+	for (; mpd_decimal_is_digit(*p); ++p, ++n_digits)
+		mantissa = mantissa * 10 + (*p - '0');
+
+	if (*p == '.') {
+		for (++p; mpd_decimal_is_digit(*p); ++p, ++n_digits, ++n_fraction)
+			mantissa = mantissa * 10 + (*p - '0');
+	}
+
+	if (n_digits == 0 || n_digits > 15)
+		/* "nan", "inf" and long mantissas are rare; let the
+		   C library deal with them */
+		return strtod(start, NULL);
+
+	int exponent = -(int)n_fraction;
+	if (*p == 'e' || *p == 'E') {
+		const char *end;
+		const int e = mpd_decimal_parse_int(p[1] == '+' ? p + 2 : p + 1,
+						    &end);
+		if (end == p + 1 || end == p + 2 || e < -22 || e > 22)
+			return strtod(start, NULL);
+
+		exponent += e;
+	}
+
+	if (exponent < -22 || exponent > 22)
+		return strtod(start, NULL);
+
+	const double value = exponent < 0
+		? (double)mantissa / mpd_decimal_pow10[-exponent]
+		: (double)mantissa * mpd_decimal_pow10[exponent];
+	return negative ? -value : value;
+}
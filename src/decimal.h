@@ -0,0 +1,148 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MPD_DECIMAL_H
+#define MPD_DECIMAL_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Decimal number parsers for the values sent by MPD.  Unlike
+ * strtoul() and friends, they do not skip whitespace, do not detect
+ * the base, do not depend on the locale and do not touch errno, which
+ * makes them a lot cheaper in the hot *_feed() functions.  Out of
+ * range values saturate instead of overflowing.
+ */
+
+static inline bool
+mpd_decimal_is_digit(char ch)
+{
+	return (unsigned char)(ch - '0') < 10;
+}
+
+/**
+ * Parses an unsigned decimal integer.
+ *
+ * @param endptr_r if not NULL, receives a pointer to the first
+ * character after the digits (equals @p if there were no digits)
+ * @param max the maximum value; larger values are clipped
+ * @return the parsed value, or 0 if there were no digits
+ */
+static inline unsigned long long
+mpd_decimal_parse_max(const char *p, const char **endptr_r,
+		      unsigned long long max)
+{
+	unsigned long long value = 0;
+	const unsigned long long limit = max / 10;
+
+	for (; mpd_decimal_is_digit(*p); ++p) {
+		const unsigned digit = *p - '0';
+		if (value > limit || value * 10 > max - digit)
+			value = max;
+		else
+			value = value * 10 + digit;
+	}
+
+	if (endptr_r != NULL)
+		*endptr_r = p;
+	return value;
+}
+
+static inline unsigned
+mpd_decimal_parse_unsigned(const char *p, const char **endptr_r)
+{
+	return mpd_decimal_parse_max(p, endptr_r, UINT_MAX);
+}
+
+static inline unsigned long
+mpd_decimal_parse_ulong(const char *p, const char **endptr_r)
+{
+	return mpd_decimal_parse_max(p, endptr_r, ULONG_MAX);
+}
+
+/**
+ * Parses a decimal integer with an optional minus sign.  Out of
+ * range values are clipped to INT_MIN or INT_MAX.
+ */
+static inline int
+mpd_decimal_parse_int(const char *p, const char **endptr_r)
+{
+	if (*p == '-') {
+		const char *end;
+		unsigned long long value =
+			mpd_decimal_parse_max(p + 1, &end,
+					      -(long long)INT_MIN);
+		if (endptr_r != NULL)
+			*endptr_r = end > p + 1 ? end : p;
+		return (int)-(long long)value;
+	}
+
+	return (int)mpd_decimal_parse_max(p, endptr_r, INT_MAX);
+}
+
+/**
+ * Parses a fixed-point number of seconds (e.g. "245.133") to
+ * milliseconds.  Digits after the third fractional digit are
+ * truncated.
+ */
+static inline unsigned
+mpd_decimal_parse_ms(const char *p, const char **endptr_r)
+{
+	/* the extra second makes sure that too large values get
+	   clipped below */
+	unsigned long long ms =
+		mpd_decimal_parse_max(p, &p, UINT_MAX / 1000 + 1) * 1000;
+
+	if (*p == '.') {
+		++p;
+
+		unsigned scale = 100;
+		for (; mpd_decimal_is_digit(*p); ++p) {
+			ms += (*p - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	if (endptr_r != NULL)
+		*endptr_r = p;
+	return ms < UINT_MAX ? (unsigned)ms : UINT_MAX;
+}
+
+/**
+ * Parses a floating point number.  Plain decimal numbers which can be
+ * converted exactly take a fast path; everything else (exponents,
+ * "nan", very long mantissas) is passed to strtod().
+ *
+ * @return the parsed value, or 0 if @p is not a number
+ */
+double
+mpd_decimal_parse_double(const char *p);
+
+#endif
@@ -34,6 +34,7 @@
 #include <mpd/pair.h>
 #include "uri.h"
 #include "iso8601.h"
+#include "pair_name.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -124,7 +125,7 @@ mpd_directory_begin(const struct mpd_pair *pair)
 	assert(pair->name != NULL);
 	assert(pair->value != NULL);
 
-	if (strcmp(pair->name, "directory") != 0 ||
+	if (mpd_pair_name_parse(pair->name) != MPD_PAIR_NAME_DIRECTORY ||
 	    !mpd_verify_local_uri(pair->value)) {
 		errno = EINVAL;
 		return NULL;
@@ -141,12 +142,18 @@ mpd_directory_feed(struct mpd_directory *directory,
 	assert(pair->name != NULL);
 	assert(pair->value != NULL);
 
-	if (strcmp(pair->name, "directory") == 0)
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_DIRECTORY:
 		return false;
 
-	if (strcmp(pair->name, "Last-Modified") == 0)
+	case MPD_PAIR_NAME_LAST_MODIFIED:
 		directory->last_modified =
 			iso8601_datetime_parse(pair->value);
+		break;
+
+	default:
+		break;
+	}
 
 	return true;
 }
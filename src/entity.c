@@ -33,6 +33,8 @@
 #include <mpd/entity.h>
 #include <mpd/playlist.h>
 #include "internal.h"
+#include "isong.h"
+#include "pair_name.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -130,23 +132,31 @@ mpd_entity_get_playlist(const struct mpd_entity *entity)
 static bool
 mpd_entity_feed_first(struct mpd_entity *entity, const struct mpd_pair *pair)
 {
-	if (strcmp(pair->name, "file") == 0) {
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_FILE:
 		entity->type = MPD_ENTITY_TYPE_SONG;
 		entity->info.song = mpd_song_begin(pair);
 		if (entity->info.song == NULL)
 			return false;
-	} else if (strcmp(pair->name, "directory") == 0) {
+		break;
+
+	case MPD_PAIR_NAME_DIRECTORY:
 		entity->type = MPD_ENTITY_TYPE_DIRECTORY;
 		entity->info.directory = mpd_directory_begin(pair);
 		if (entity->info.directory == NULL)
 			return false;
-	} else if (strcmp(pair->name, "playlist") == 0) {
+		break;
+
+	case MPD_PAIR_NAME_PLAYLIST:
 		entity->type = MPD_ENTITY_TYPE_PLAYLIST;
 		entity->info.playlistFile = mpd_playlist_begin(pair);
 		if (entity->info.playlistFile == NULL)
 			return false;
-	} else {
+		break;
+
+	default:
 		entity->type = MPD_ENTITY_TYPE_UNKNOWN;
+		break;
 	}
 
 	return true;
@@ -179,11 +189,16 @@ mpd_entity_feed(struct mpd_entity *entity, const struct mpd_pair *pair)
 	assert(pair->name != NULL);
 	assert(pair->value != NULL);
 
-	if (strcmp(pair->name, "file") == 0 ||
-	    strcmp(pair->name, "directory") == 0 ||
-	    strcmp(pair->name, "playlist") == 0)
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_FILE:
+	case MPD_PAIR_NAME_DIRECTORY:
+	case MPD_PAIR_NAME_PLAYLIST:
 		return false;
 
+	default:
+		break;
+	}
+
 	switch (entity->type) {
 	case MPD_ENTITY_TYPE_UNKNOWN:
 		break;
@@ -230,6 +245,9 @@ mpd_recv_entity(struct mpd_connection *connection)
 		return NULL;
 	}
 
+	if (entity->type == MPD_ENTITY_TYPE_SONG)
+		entity->info.song = mpd_song_pack(entity->info.song);
+
 	/* unread this pair for the next mpd_recv_entity() call */
 	mpd_enqueue_pair(connection, pair);
 
@@ -75,5 +75,10 @@ mpd_connection_clear_error(struct mpd_connection *connection)
 		return false;
 
 	mpd_error_clear(&connection->error);
+	connection->deadline_ms = -1;
+
+	/* after a server error, the failed response is over; continue
+	   with the next queued one */
+	mpd_connection_next_response(connection);
 	return true;
 }
@@ -28,7 +28,7 @@
 
 /*
  * This code is copied from MPD.  It is a subset of the original
- * library (we don't need pipes and regular files in libmpdclient).
+ * library (we don't need regular files in libmpdclient).
  *
  */
 
@@ -43,6 +43,7 @@
 #include <winsock2.h>
 #else
 #include <sys/socket.h>
+#include <unistd.h>
 #endif
 
 #ifndef _WIN32
@@ -117,3 +118,27 @@ socket_cloexec_nonblock(int domain, int type, int protocol)
 
 	return fd;
 }
+
+#ifndef _WIN32
+
+int
+pipe_cloexec_nonblock(int fd[2])
+{
+#ifdef __linux__
+	int ret = pipe2(fd, O_CLOEXEC|O_NONBLOCK);
+	if (ret >= 0 || errno != ENOSYS)
+		return ret;
+#endif
+
+	int ret2 = pipe(fd);
+	if (ret2 >= 0) {
+		fd_set_cloexec(fd[0], true);
+		fd_set_cloexec(fd[1], true);
+		fd_set_nonblock(fd[0]);
+		fd_set_nonblock(fd[1]);
+	}
+
+	return ret2;
+}
+
+#endif
@@ -45,4 +45,15 @@
 mpd_socket_t
 socket_cloexec_nonblock(int domain, int type, int protocol);
 
+#ifndef _WIN32
+
+/**
+ * Wrapper for pipe(), which sets the CLOEXEC and the NONBLOCK flag on
+ * both ends (atomically if supported by the OS).
+ */
+int
+pipe_cloexec_nonblock(int fd[2]);
+
+#endif
+
 #endif
@@ -31,6 +31,8 @@
 
 #include <mpd/async.h>
 
+#include <stddef.h>
+
 struct mpd_error_info;
 
 /**
@@ -44,4 +46,124 @@ bool
 mpd_async_copy_error(const struct mpd_async *async,
 		     struct mpd_error_info *dest);
 
+/**
+ * Returns a pointer to the free space at the end of the input buffer,
+ * for an event loop which receives data on its own (e.g. with
+ * io_uring).  After receiving, call mpd_async_input_commit().  The
+ * pointer is valid until the next call to mpd_async_recv_line(),
+ * which may move or grow the buffer.
+ *
+ * @param room_r returns the number of bytes which may be written;
+ * 0 if the input buffer is full
+ */
+void *
+mpd_async_input_tail(struct mpd_async *async, size_t *room_r);
+
+/**
+ * Marks bytes written to the pointer returned by
+ * mpd_async_input_tail() as valid input.
+ */
+void
+mpd_async_input_commit(struct mpd_async *async, size_t nbytes);
+
+/**
+ * Copies data from the output buffer and removes it there, for an
+ * event loop which sends data on its own.
+ *
+ * @return the number of bytes copied
+ */
+size_t
+mpd_async_take_output(struct mpd_async *async, void *dest, size_t max_length);
+
+/**
+ * Receives data from the socket into the input buffer, like
+ * mpd_async_io() with #MPD_ASYNC_EVENT_READ does, but reports whether
+ * anything was received.  This is useful for edge-triggered event
+ * loops which must read until the socket is drained.
+ *
+ * @return the number of bytes received; 0 if no data is available,
+ * if the input buffer is full or if an error has occurred (which is
+ * then stored in #async)
+ */
+size_t
+mpd_async_fill(struct mpd_async *async);
+
+/**
+ * The state of mpd_async_skip_response() between calls.  Initialize
+ * it with zeroes at the beginning of a response line.
+ */
+struct mpd_async_skip {
+	/** the number of bytes of a binary chunk still to be skipped */
+	size_t binary;
+
+	/**
+	 * Has the beginning of the current line been checked (and
+	 * discarded) already?
+	 */
+	bool mid_line;
+};
+
+/**
+ * Discards response lines from the input buffer without parsing
+ * them, until the input buffer begins with a line which finishes
+ * the response ("OK", "list_OK" or "ACK").  That line is left for
+ * mpd_async_recv_line().  Binary chunks are skipped as a whole.
+ *
+ * Instead of looking at each line, this searches the raw input for
+ * the few lines which matter, which makes discarding a large
+ * response much cheaper than receiving all of its pairs.
+ *
+ * @return true if the input buffer now begins with such a line,
+ * false if more input is needed
+ */
+bool
+mpd_async_skip_response(struct mpd_async *async, struct mpd_async_skip *skip);
+
+/**
+ * Like mpd_async_recv_raw(), but if the input buffer is empty,
+ * receives directly from the socket into the destination buffer.
+ *
+ * @return the number of bytes copied to the destination buffer; 0 if
+ * no data is available or if an error has occurred (which is then
+ * stored in #async)
+ */
+size_t
+mpd_async_recv_direct(struct mpd_async *async, void *dest, size_t length);
+
+/**
+ * Moves up to the specified number of bytes from the connection to
+ * the given file descriptor.  The input buffer is drained first;
+ * after that, the data is moved with splice() if possible, and
+ * through the input buffer otherwise.
+ *
+ * @param fd a blocking file descriptor
+ * @return the number of bytes which were written to #fd; 0 if no data
+ * is available or if an error has occurred (which is then stored in
+ * #async)
+ */
+size_t
+mpd_async_recv_to_fd(struct mpd_async *async, int fd, size_t length);
+
+/**
+ * Appends as much of the specified data to the output buffer as fits.
+ * Unlike mpd_async_send_command(), this may be used to stream a
+ * command which is larger than the output buffer, piece by piece.
+ *
+ * @return the number of bytes which were appended; 0 if the output
+ * buffer is full or if there is an error condition
+ */
+size_t
+mpd_async_append_raw(struct mpd_async *async,
+		     const char *data, size_t length);
+
+/**
+ * Appends as much of the specified null-terminated string to the
+ * output buffer as fits, escaping special characters.  Escape
+ * sequences are never split.
+ *
+ * @return the number of source characters which were consumed
+ */
+size_t
+mpd_async_append_escaped(struct mpd_async *async, const char *value);
+
 #endif
@@ -38,6 +38,7 @@
 #include <mpd/response.h>
 #include "internal.h"
 #include "isend.h"
+#include "pair_name.h"
 #include "run.h"
 
 #include <string.h>
@@ -73,11 +74,46 @@ mpd_idle_name_parse(const char *name)
 {
 	assert(name != NULL);
 
-	for (unsigned i = 0; idle_names[i] != NULL; ++i)
-		if (strcmp(name, idle_names[i]) == 0)
-			return 1 << i;
+	switch (mpd_pair_name_parse(name)) {
+	case MPD_PAIR_NAME_DATABASE:
+		return MPD_IDLE_DATABASE;
+
+	case MPD_PAIR_NAME_STORED_PLAYLIST:
+		return MPD_IDLE_STORED_PLAYLIST;
+
+	case MPD_PAIR_NAME_PLAYLIST:
+		return MPD_IDLE_QUEUE;
+
+	case MPD_PAIR_NAME_PLAYER:
+		return MPD_IDLE_PLAYER;
+
+	case MPD_PAIR_NAME_MIXER:
+		return MPD_IDLE_MIXER;
+
+	case MPD_PAIR_NAME_OUTPUT:
+		return MPD_IDLE_OUTPUT;
+
+	case MPD_PAIR_NAME_OPTIONS:
+		return MPD_IDLE_OPTIONS;
 
-	return 0;
+	case MPD_PAIR_NAME_UPDATE:
+		return MPD_IDLE_UPDATE;
+
+	case MPD_PAIR_NAME_STICKER:
+		return MPD_IDLE_STICKER;
+
+	case MPD_PAIR_NAME_SUBSCRIPTION:
+		return MPD_IDLE_SUBSCRIPTION;
+
+	case MPD_PAIR_NAME_MESSAGE:
+		return MPD_IDLE_MESSAGE;
+
+	case MPD_PAIR_NAME_PARTITION:
+		return MPD_IDLE_PARTITION;
+
+	default:
+		return 0;
+	}
 }
 
 enum mpd_idle
@@ -85,7 +121,7 @@ mpd_idle_parse_pair(const struct mpd_pair *pair)
 {
 	assert(pair != NULL);
 
-	if (strcmp(pair->name, "changed") != 0)
+	if (mpd_pair_name_parse(pair->name) != MPD_PAIR_NAME_CHANGED)
 		return 0;
 
 	return mpd_idle_name_parse(pair->value);
@@ -96,7 +132,7 @@ mpd_recv_idle(struct mpd_connection *connection, bool disable_timeout)
 {
 	enum mpd_idle flags = 0;
 	struct mpd_pair *pair;
-	struct timeval old_timeout;
+	unsigned old_timeout_ms = 0;
 
 	assert(connection != NULL);
 
@@ -108,19 +144,8 @@ mpd_recv_idle(struct mpd_connection *connection, bool disable_timeout)
 		if (!mpd_flush(connection))
 			return 0;
 
-		old_timeout = connection->timeout;
-		connection->timeout = (struct timeval){
-			.tv_sec = 0,
-			.tv_usec = 0,
-		};
-	} else {
-		/* work around bogus gcc warning "may be used
-		   uninitialized"; gcc is too dumb to see that we're
-		   accessing old_timeout only if it was initialized */
-		old_timeout = (struct timeval){
-			.tv_sec = 0,
-			.tv_usec = 0,
-		};
+		old_timeout_ms = connection->timeout_ms;
+		connection->timeout_ms = 0;
 	}
 
 	while ((pair = mpd_recv_pair(connection)) != NULL) {
@@ -131,7 +156,7 @@ mpd_recv_idle(struct mpd_connection *connection, bool disable_timeout)
 
 	/* re-enable timeout */
 	if (disable_timeout)
-		connection->timeout = old_timeout;
+		connection->timeout_ms = old_timeout_ms;
 
 	return flags;
 }
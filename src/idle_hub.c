@@ -0,0 +1,367 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "internal.h"
+#include "fd_util.h"
+#include "clock.h"
+
+#include <mpd/idle_hub.h>
+#include <mpd/async.h>
+#include <mpd/connection.h>
+#include <mpd/idle.h>
+#include <mpd/response.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+enum mpd_idle_hub_slot_state {
+	/** the slot is unused */
+	SLOT_FREE,
+
+	/** mpd_idle_hub_subscribe() is initializing the slot */
+	SLOT_CLAIMED,
+
+	/** the slot belongs to a subscriber */
+	SLOT_ACTIVE,
+
+	/**
+	 * mpd_idle_hub_run() is delivering events to this slot;
+	 * mpd_idle_hub_unsubscribe() waits until it is done.
+	 */
+	SLOT_DELIVERING,
+};
+
+enum mpd_idle_hub_wait_result {
+	WAIT_ERROR,
+
+	/** the coalescing time span is over */
+	WAIT_TIMEOUT,
+
+	/** the idle response is readable */
+	WAIT_READY,
+
+	/** mpd_idle_hub_stop() has been called */
+	WAIT_STOP,
+};
+
+struct mpd_idle_hub_subscriber {
+	/**
+	 * An #mpd_idle_hub_slot_state value.  Accessed atomically;
+	 * the other fields may only be accessed by the thread which
+	 * has moved the slot out of #SLOT_FREE or #SLOT_ACTIVE.
+	 */
+	unsigned state;
+
+	enum mpd_idle mask;
+
+	mpd_idle_hub_notify_cb notify_cb;
+	void *ctx;
+
+	/**
+	 * The events which have not yet been taken by the
+	 * subscriber.  Accessed atomically.
+	 */
+	unsigned pending;
+};
+
+struct mpd_idle_hub {
+	struct mpd_connection *connection;
+
+	/**
+	 * A pipe which wakes up mpd_idle_hub_run() when
+	 * mpd_idle_hub_stop() is called.
+	 */
+	int wake_fds[2];
+
+	unsigned coalesce_ms;
+
+	unsigned n_slots;
+
+	struct mpd_idle_hub_subscriber slots[];
+};
+
+struct mpd_idle_hub *
+mpd_idle_hub_new(struct mpd_connection *connection, unsigned max_subscribers)
+{
+	assert(connection != NULL);
+
+	struct mpd_idle_hub *hub =
+		malloc(sizeof(*hub) + max_subscribers * sizeof(hub->slots[0]));
+	if (hub == NULL)
+		return NULL;
+
+	if (pipe_cloexec_nonblock(hub->wake_fds) < 0) {
+		free(hub);
+		return NULL;
+	}
+
+	hub->connection = connection;
+	hub->coalesce_ms = 0;
+	hub->n_slots = max_subscribers;
+
+	for (unsigned i = 0; i < max_subscribers; ++i) {
+		hub->slots[i].state = SLOT_FREE;
+		hub->slots[i].pending = 0;
+	}
+
+	return hub;
+}
+
+void
+mpd_idle_hub_free(struct mpd_idle_hub *hub)
+{
+	assert(hub != NULL);
+
+	mpd_connection_free(hub->connection);
+	close(hub->wake_fds[0]);
+	close(hub->wake_fds[1]);
+	free(hub);
+}
+
+struct mpd_connection *
+mpd_idle_hub_get_connection(const struct mpd_idle_hub *hub)
+{
+	assert(hub != NULL);
+
+	return hub->connection;
+}
+
+void
+mpd_idle_hub_set_coalesce(struct mpd_idle_hub *hub, unsigned coalesce_ms)
+{
+	assert(hub != NULL);
+
+	hub->coalesce_ms = coalesce_ms;
+}
+
+struct mpd_idle_hub_subscriber *
+mpd_idle_hub_subscribe(struct mpd_idle_hub *hub, enum mpd_idle mask,
+		       mpd_idle_hub_notify_cb notify_cb, void *ctx)
+{
+	assert(hub != NULL);
+
+	for (unsigned i = 0; i < hub->n_slots; ++i) {
+		struct mpd_idle_hub_subscriber *slot = &hub->slots[i];
+
+		unsigned expected = SLOT_FREE;
+		if (!__atomic_compare_exchange_n(&slot->state, &expected,
+						 SLOT_CLAIMED, false,
+						 __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			continue;
+
+		slot->mask = mask;
+		slot->notify_cb = notify_cb;
+		slot->ctx = ctx;
+		__atomic_store_n(&slot->pending, 0, __ATOMIC_RELAXED);
+
+		/* publish the fields to mpd_idle_hub_run() */
+		__atomic_store_n(&slot->state, SLOT_ACTIVE, __ATOMIC_RELEASE);
+		return slot;
+	}
+
+	return NULL;
+}
+
+void
+mpd_idle_hub_unsubscribe(struct mpd_idle_hub_subscriber *subscriber)
+{
+	assert(subscriber != NULL);
+
+	while (true) {
+		unsigned expected = SLOT_ACTIVE;
+		if (__atomic_compare_exchange_n(&subscriber->state, &expected,
+						SLOT_FREE, false,
+						__ATOMIC_RELEASE,
+						__ATOMIC_RELAXED))
+			return;
+
+		/* mpd_idle_hub_run() is delivering events to this
+		   slot right now; this takes only a moment */
+		assert(expected == SLOT_DELIVERING);
+		sched_yield();
+	}
+}
+
+enum mpd_idle
+mpd_idle_hub_subscriber_take(struct mpd_idle_hub_subscriber *subscriber)
+{
+	assert(subscriber != NULL);
+
+	return (enum mpd_idle)__atomic_exchange_n(&subscriber->pending, 0,
+						  __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Adds the events to all matching subscribers, and notifies those
+ * which had no pending events.
+ */
+static void
+mpd_idle_hub_deliver(struct mpd_idle_hub *hub, enum mpd_idle events)
+{
+	for (unsigned i = 0; i < hub->n_slots; ++i) {
+		struct mpd_idle_hub_subscriber *slot = &hub->slots[i];
+
+		unsigned expected = SLOT_ACTIVE;
+		if (!__atomic_compare_exchange_n(&slot->state, &expected,
+						 SLOT_DELIVERING, false,
+						 __ATOMIC_ACQUIRE,
+						 __ATOMIC_RELAXED))
+			continue;
+
+		const unsigned matched = events & slot->mask;
+		if (matched != 0 &&
+		    __atomic_fetch_or(&slot->pending, matched,
+				      __ATOMIC_RELEASE) == 0 &&
+		    slot->notify_cb != NULL)
+			/* if the subscriber has not taken the previous
+			   events yet, it has already been notified */
+			slot->notify_cb(slot->ctx);
+
+		__atomic_store_n(&slot->state, SLOT_ACTIVE, __ATOMIC_RELEASE);
+	}
+}
+
+/**
+ * Consumes all pending mpd_idle_hub_stop() requests.
+ */
+static void
+mpd_idle_hub_drain_wake(struct mpd_idle_hub *hub)
+{
+	char buffer[64];
+	while (read(hub->wake_fds[0], buffer, sizeof(buffer)) > 0) {}
+}
+
+/**
+ * Waits until the idle response arrives, the coalescing deadline
+ * expires or mpd_idle_hub_stop() is called.
+ *
+ * @param deadline_ms the coalescing deadline [CLOCK_MONOTONIC
+ * milliseconds] or -1
+ */
+static enum mpd_idle_hub_wait_result
+mpd_idle_hub_wait(struct mpd_idle_hub *hub, long long deadline_ms)
+{
+	struct pollfd pfds[2] = {
+		{
+			.fd = mpd_async_get_fd(hub->connection->async),
+			.events = POLLIN,
+		},
+		{
+			.fd = hub->wake_fds[0],
+			.events = POLLIN,
+		},
+	};
+
+	while (true) {
+		int timeout_ms = -1;
+		if (deadline_ms >= 0) {
+			const long long remaining_ms =
+				deadline_ms - mpd_clock_now_ms();
+			timeout_ms = remaining_ms > 0 ? (int)remaining_ms : 0;
+		}
+
+		int n = poll(pfds, 2, timeout_ms);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return WAIT_ERROR;
+		}
+
+		if (pfds[1].revents != 0) {
+			mpd_idle_hub_drain_wake(hub);
+			return WAIT_STOP;
+		}
+
+		return n > 0 ? WAIT_READY : WAIT_TIMEOUT;
+	}
+}
+
+bool
+mpd_idle_hub_run(struct mpd_idle_hub *hub)
+{
+	assert(hub != NULL);
+
+	struct mpd_connection *connection = hub->connection;
+	if (mpd_connection_get_error(connection) != MPD_ERROR_SUCCESS)
+		return false;
+
+	/* events which have been received but not yet delivered,
+	   because more may follow within the coalescing time span */
+	enum mpd_idle collected = 0;
+	long long deliver_ms = -1;
+
+	while (true) {
+		if (!mpd_send_idle(connection))
+			return false;
+
+		const enum mpd_idle_hub_wait_result result =
+			mpd_idle_hub_wait(hub, deliver_ms);
+		if (result == WAIT_ERROR) {
+			mpd_error_errno(&connection->error);
+			return false;
+		}
+
+		if (result != WAIT_READY && !mpd_send_noidle(connection))
+			return false;
+
+		/* the response is either ready or follows "noidle"
+		   right away */
+		collected |= mpd_recv_idle(connection, false);
+		if (!mpd_response_finish(connection))
+			return false;
+
+		if (collected != 0 && deliver_ms < 0)
+			deliver_ms = mpd_clock_now_ms() + hub->coalesce_ms;
+
+		if (collected != 0 &&
+		    (result == WAIT_STOP || mpd_clock_now_ms() >= deliver_ms)) {
+			mpd_idle_hub_deliver(hub, collected);
+			collected = 0;
+			deliver_ms = -1;
+		}
+
+		if (result == WAIT_STOP)
+			return true;
+	}
+}
+
+void
+mpd_idle_hub_stop(struct mpd_idle_hub *hub)
+{
+	assert(hub != NULL);
+
+	static const char dummy = 0;
+	ssize_t nbytes = write(hub->wake_fds[1], &dummy, sizeof(dummy));
+	(void)nbytes;
+}
@@ -32,13 +32,7 @@
 #include <mpd/pair.h>
 
 #include "ierror.h"
-
-/* for struct timeval */
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <sys/time.h>
-#endif
+#include "clock.h"
 
 /**
  * This opaque object represents a connection to a MPD server.  Call
@@ -68,11 +62,18 @@ struct mpd_connection {
 	struct mpd_async *async;
 
 	/**
-	 * The timeout for all commands.  If the MPD server does not
-	 * respond within this time span, the connection is assumed to
-	 * be dead.
+	 * The timeout for each synchronous operation in milliseconds;
+	 * 0 means no timeout.  If the MPD server does not respond
+	 * within this time span, the connection is assumed to be
+	 * dead.
+	 */
+	unsigned timeout_ms;
+
+	/**
+	 * The deadline set by mpd_connection_set_deadline()
+	 * [CLOCK_MONOTONIC milliseconds], or -1 if there is none.
 	 */
-	struct timeval timeout;
+	long long deadline_ms;
 
 	/**
 	 * The parser object used to parse response lines received
@@ -85,6 +86,21 @@ struct mpd_connection {
 	 */
 	bool receiving;
 
+	/**
+	 * Is the connection corked, i.e. are commands collected in
+	 * the output buffer instead of being flushed?  See
+	 * mpd_connection_cork().
+	 */
+	bool corked;
+
+	/**
+	 * The number of commands sent after the one whose response
+	 * is being received (#receiving), whose responses have not
+	 * been read yet.  This can only be non-zero after commands
+	 * were sent while the connection was corked.
+	 */
+	unsigned queued_responses;
+
 	/**
 	 * Sending a command list right now?
 	 */
@@ -157,13 +173,40 @@ struct mpd_connection {
 void
 mpd_connection_sync_error(struct mpd_connection *connection);
 
-static inline const struct timeval *
-mpd_connection_timeout(const struct mpd_connection *connection)
+/**
+ * Called after the current response has been finished (or has failed
+ * with a server error which was cleared): start receiving the next
+ * one which was queued while the connection was corked.
+ */
+static inline void
+mpd_connection_next_response(struct mpd_connection *connection)
+{
+	if (!connection->receiving && connection->queued_responses > 0) {
+		--connection->queued_responses;
+		connection->receiving = true;
+	}
+}
+
+/**
+ * Returns the absolute deadline for a synchronous operation which
+ * starts now: the configured timeout from now, but never later than
+ * the deadline of the current command.
+ *
+ * @return the deadline [CLOCK_MONOTONIC milliseconds] or -1 if there
+ * is none
+ */
+static inline long long
+mpd_connection_deadline(const struct mpd_connection *connection)
 {
-	return connection->timeout.tv_sec != 0 ||
-		connection->timeout.tv_usec != 0
-		? &connection->timeout
-		: NULL;
+	long long deadline_ms = connection->timeout_ms > 0
+		? mpd_clock_now_ms() + connection->timeout_ms
+		: -1;
+
+	if (connection->deadline_ms >= 0 &&
+	    (deadline_ms < 0 || connection->deadline_ms < deadline_ms))
+		deadline_ms = connection->deadline_ms;
+
+	return deadline_ms;
 }
 
 #endif
@@ -29,10 +29,19 @@
 #ifndef MPD_ISEND_H
 #define MPD_ISEND_H
 
+#include <stdarg.h>
 #include <stdbool.h>
 
 struct mpd_connection;
 
+/**
+ * Like mpd_send_command(), but the arguments are passed as a
+ * va_list.
+ */
+bool
+mpd_send_command_v(struct mpd_connection *connection, const char *command,
+		   va_list args);
+
 /**
  * Sends a command without arguments to the server, but does not
  * update the "receiving" flag nor the "listOks" counter.  This is
@@ -27,6 +27,7 @@
 */
 
 #include "iso8601.h"
+#include "decimal.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -44,96 +45,68 @@ gmtime_r(const time_t *timep, struct tm *result)
 #endif /* _WIN32 */
 
 /**
- * @return the current time zone offset in seconds
+ * Converts a date in the proleptic Gregorian calendar to the number
+ * of days since 1970-01-01.  This replaces mktime(), which depends
+ * on the current time zone and is expensive (it may even read the
+ * time zone database).
  */
-static time_t
-timezone_offset(void)
+static long
+days_from_civil(unsigned year, unsigned month, unsigned day)
 {
-	const time_t t0 = 1234567890;
-	time_t t = t0;
-	struct tm tm_buffer, *tm;
-
-	tm = gmtime_r(&t, &tm_buffer);
-	if (tm == NULL)
-		return 0;
-
-	/* force the daylight saving time to be off; gmtime_r() should
-	   have set this already */
-	tm->tm_isdst = 0;
-
-	t = mktime(tm);
-	if (t == -1)
-		return 0;
-
-	return t0 - t;
-}
-
-/**
- * Unfortunately, the useful timegm() function is a GNU extension, and
- * mktime() returns a stamp relative to the current time zone.  This
- * function emulates timegm() by subtracting the time zone offset, see
- * timezone_offset().
- */
-static time_t
-timegm_emulation(struct tm *tm)
-{
-	time_t t = mktime(tm);
-	if (t == -1)
-		return 0;
-
-	return t + timezone_offset();
+	/* let the year begin in March, so the leap day is the last
+	   day of the year */
+	if (month <= 2)
+		--year;
+
+	const unsigned era = year / 400;
+	const unsigned year_of_era = year - era * 400;
+	const unsigned day_of_year =
+		(153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 -
+		year_of_era / 100 + day_of_year;
+
+	return (long)era * 146097 + (long)day_of_era - 719468;
 }
 
 time_t
 iso8601_datetime_parse(const char *input)
 {
-	char *endptr;
+	const char *endptr;
 	unsigned year, month, day, hour, minute, second;
-	struct tm tm;
 
-	year = strtoul(input, &endptr, 10);
+	year = mpd_decimal_parse_unsigned(input, &endptr);
 	if (year < 1970 || year >= 3000 || *endptr != '-')
 		/* beware of the Y3K problem! */
 		return 0;
 
 	input = endptr + 1;
-	month = strtoul(input, &endptr, 10);
+	month = mpd_decimal_parse_unsigned(input, &endptr);
 	if (month < 1 || month > 12 || *endptr != '-')
 		return 0;
 
 	input = endptr + 1;
-	day = strtoul(input, &endptr, 10);
+	day = mpd_decimal_parse_unsigned(input, &endptr);
 	if (day < 1 || day > 31 || *endptr != 'T')
 		return 0;
 
 	input = endptr + 1;
-	hour = strtoul(input, &endptr, 10);
+	hour = mpd_decimal_parse_unsigned(input, &endptr);
 	if (endptr == input || hour >= 24 || *endptr != ':')
 		return 0;
 
 	input = endptr + 1;
-	minute = strtoul(input, &endptr, 10);
+	minute = mpd_decimal_parse_unsigned(input, &endptr);
 	if (endptr == input || minute >= 60 || *endptr != ':')
 		return 0;
 
 	input = endptr + 1;
-	second = strtoul(input, &endptr, 10);
+	second = mpd_decimal_parse_unsigned(input, &endptr);
 	if (endptr == input || second >= 60 ||
 	    (*endptr != 0 && *endptr != 'Z'))
 		return 0;
 
-	tm.tm_year = year - 1900;
-	tm.tm_mon = month - 1;
-	tm.tm_mday = day;
-	tm.tm_hour = hour;
-	tm.tm_min = minute;
-	tm.tm_sec = second;
-
-	/* force the daylight saving time to be off, same as in
-	   timezone_offset() */
-	tm.tm_isdst = 0;
-
-	return timegm_emulation(&tm);
+	return (time_t)days_from_civil(year, month, day) * 86400 +
+		hour * 3600 + minute * 60 + second;
 }
 
 bool
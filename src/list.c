@@ -51,6 +51,13 @@ mpd_command_list_begin(struct mpd_connection *connection, bool discrete_ok)
 		return false;
 	}
 
+	if (connection->corked || connection->queued_responses > 0) {
+		mpd_error_code(&connection->error, MPD_ERROR_STATE);
+		mpd_error_message(&connection->error,
+				  "Not possible while corked");
+		return false;
+	}
+
 	success = mpd_send_command2(connection,
 				    discrete_ok
 				    ? "command_list_ok_begin"
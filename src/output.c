@@ -32,7 +32,9 @@
 
 #include <mpd/output.h>
 #include <mpd/pair.h>
+#include "decimal.h"
 #include "kvlist.h"
+#include "pair_name.h"
 
 #include <assert.h>
 #include <string.h>
@@ -55,14 +57,14 @@ mpd_output_begin(const struct mpd_pair *pair)
 
 	assert(pair != NULL);
 
-	if (strcmp(pair->name, "outputid") != 0)
+	if (mpd_pair_name_parse(pair->name) != MPD_PAIR_NAME_OUTPUTID)
 		return NULL;
 
 	output = malloc(sizeof(*output));
 	if (output == NULL)
 		return NULL;
 
-	output->id = atoi(pair->value);
+	output->id = mpd_decimal_parse_unsigned(pair->value, NULL);
 
 	output->name = NULL;
 	output->plugin = NULL;
@@ -75,23 +77,37 @@ mpd_output_begin(const struct mpd_pair *pair)
 bool
 mpd_output_feed(struct mpd_output *output, const struct mpd_pair *pair)
 {
-	if (strcmp(pair->name, "outputid") == 0)
+	const char *eq;
+
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_OUTPUTID:
 		return false;
 
-	if (strcmp(pair->name, "outputname") == 0) {
+	case MPD_PAIR_NAME_OUTPUTNAME:
 		free(output->name);
 		output->name = strdup(pair->value);
-	} else if (strcmp(pair->name, "outputenabled") == 0)
-		output->enabled = atoi(pair->value) != 0;
-	else if (strcmp(pair->name, "plugin") == 0) {
+		break;
+
+	case MPD_PAIR_NAME_OUTPUTENABLED:
+		output->enabled =
+			mpd_decimal_parse_int(pair->value, NULL) != 0;
+		break;
+
+	case MPD_PAIR_NAME_PLUGIN:
 		free(output->plugin);
 		output->plugin = strdup(pair->value);
-	} else if (strcmp(pair->name, "attribute") == 0) {
-		const char *eq = strchr(pair->value, '=');
+		break;
+
+	case MPD_PAIR_NAME_ATTRIBUTE:
+		eq = strchr(pair->value, '=');
 		if (eq != NULL && eq > pair->value)
 			mpd_kvlist_add(&output->attributes,
 				       pair->value, eq - pair->value,
 				       eq + 1);
+		break;
+
+	default:
+		break;
 	}
 
 	return true;
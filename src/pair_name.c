@@ -0,0 +1,604 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "pair_name.h"
+
+#include <assert.h>
+#include <string.h>
+
+/*
+ * The switch statements below dispatch on the length of the name and
+ * on its first character; each leaf has only one or two candidates
+ * left, which are verified with a memcmp() of constant size.  When
+ * adding a name, add it to the enum in pair_name.h and to the
+ * matching "case" here.
+ */
+
+enum mpd_pair_name
+mpd_pair_name_parse(const char *name)
+{
+	assert(name != NULL);
+
+	const size_t length = strlen(name);
+
+	switch (length) {
+	case 2:
+		if (memcmp(name, "Id", 2) == 0)
+			return MPD_PAIR_NAME_ID;
+		break;
+
+	case 3:
+		if (memcmp(name, "Pos", 3) == 0)
+			return MPD_PAIR_NAME_POS;
+		break;
+
+	case 4:
+		switch (name[0]) {
+		case 'D':
+			if (memcmp(name, "Date", 4) == 0)
+				return (enum mpd_pair_name)MPD_TAG_DATE;
+			if (memcmp(name, "Disc", 4) == 0)
+				return (enum mpd_pair_name)MPD_TAG_DISC;
+			break;
+		case 'N':
+			if (memcmp(name, "Name", 4) == 0)
+				return (enum mpd_pair_name)MPD_TAG_NAME;
+			break;
+		case 'P':
+			if (memcmp(name, "Prio", 4) == 0)
+				return MPD_PAIR_NAME_PRIO;
+			break;
+		case 'T':
+			if (memcmp(name, "Time", 4) == 0)
+				return MPD_PAIR_NAME_SONG_TIME;
+			break;
+		case 'W':
+			if (memcmp(name, "Work", 4) == 0)
+				return (enum mpd_pair_name)MPD_TAG_WORK;
+			break;
+		case 'f':
+			if (memcmp(name, "file", 4) == 0)
+				return MPD_PAIR_NAME_FILE;
+			break;
+		case 's':
+			if (memcmp(name, "song", 4) == 0)
+				return MPD_PAIR_NAME_SONG;
+			break;
+		case 't':
+			if (memcmp(name, "time", 4) == 0)
+				return MPD_PAIR_NAME_TIME;
+			break;
+		}
+
+		break;
+
+	case 5:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "Album", 5) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ALBUM;
+			break;
+		case 'G':
+			if (memcmp(name, "Genre", 5) == 0)
+				return (enum mpd_pair_name)MPD_TAG_GENRE;
+			break;
+		case 'L':
+			if (memcmp(name, "Label", 5) == 0)
+				return (enum mpd_pair_name)MPD_TAG_LABEL;
+			break;
+		case 'R':
+			if (memcmp(name, "Range", 5) == 0)
+				return MPD_PAIR_NAME_RANGE;
+			break;
+		case 'T':
+			if (memcmp(name, "Title", 5) == 0)
+				return (enum mpd_pair_name)MPD_TAG_TITLE;
+			if (memcmp(name, "Track", 5) == 0)
+				return (enum mpd_pair_name)MPD_TAG_TRACK;
+			break;
+		case 'a':
+			if (memcmp(name, "audio", 5) == 0)
+				return MPD_PAIR_NAME_AUDIO;
+			break;
+		case 'e':
+			if (memcmp(name, "error", 5) == 0)
+				return MPD_PAIR_NAME_ERROR;
+			break;
+		case 'm':
+			if (memcmp(name, "mixer", 5) == 0)
+				return MPD_PAIR_NAME_MIXER;
+			break;
+		case 's':
+			if (memcmp(name, "state", 5) == 0)
+				return MPD_PAIR_NAME_STATE;
+			if (memcmp(name, "songs", 5) == 0)
+				return MPD_PAIR_NAME_SONGS;
+			break;
+		case 'x':
+			if (memcmp(name, "xfade", 5) == 0)
+				return MPD_PAIR_NAME_XFADE;
+			break;
+		}
+
+		break;
+
+	case 6:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "Artist", 6) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ARTIST;
+			break;
+		case 'F':
+			if (memcmp(name, "Format", 6) == 0)
+				return MPD_PAIR_NAME_FORMAT;
+			break;
+		case 'a':
+			if (memcmp(name, "albums", 6) == 0)
+				return MPD_PAIR_NAME_ALBUMS;
+			break;
+		case 'o':
+			if (memcmp(name, "output", 6) == 0)
+				return MPD_PAIR_NAME_OUTPUT;
+			break;
+		case 'p':
+			if (memcmp(name, "plugin", 6) == 0)
+				return MPD_PAIR_NAME_PLUGIN;
+			if (memcmp(name, "player", 6) == 0)
+				return MPD_PAIR_NAME_PLAYER;
+			break;
+		case 'r':
+			if (memcmp(name, "repeat", 6) == 0)
+				return MPD_PAIR_NAME_REPEAT;
+			if (memcmp(name, "random", 6) == 0)
+				return MPD_PAIR_NAME_RANDOM;
+			break;
+		case 's':
+			if (memcmp(name, "single", 6) == 0)
+				return MPD_PAIR_NAME_SINGLE;
+			if (memcmp(name, "songid", 6) == 0)
+				return MPD_PAIR_NAME_SONGID;
+			break;
+		case 'u':
+			if (memcmp(name, "uptime", 6) == 0)
+				return MPD_PAIR_NAME_UPTIME;
+			if (memcmp(name, "update", 6) == 0)
+				return MPD_PAIR_NAME_UPDATE;
+			break;
+		case 'v':
+			if (memcmp(name, "volume", 6) == 0)
+				return MPD_PAIR_NAME_VOLUME;
+			break;
+		}
+
+		break;
+
+	case 7:
+		switch (name[0]) {
+		case 'C':
+			if (memcmp(name, "Comment", 7) == 0)
+				return (enum mpd_pair_name)MPD_TAG_COMMENT;
+			break;
+		case 'a':
+			if (memcmp(name, "artists", 7) == 0)
+				return MPD_PAIR_NAME_ARTISTS;
+			break;
+		case 'b':
+			if (memcmp(name, "bitrate", 7) == 0)
+				return MPD_PAIR_NAME_BITRATE;
+			break;
+		case 'c':
+			if (memcmp(name, "consume", 7) == 0)
+				return MPD_PAIR_NAME_CONSUME;
+			if (memcmp(name, "changed", 7) == 0)
+				return MPD_PAIR_NAME_CHANGED;
+			break;
+		case 'e':
+			if (memcmp(name, "elapsed", 7) == 0)
+				return MPD_PAIR_NAME_ELAPSED;
+			break;
+		case 'm':
+			if (memcmp(name, "message", 7) == 0)
+				return MPD_PAIR_NAME_MESSAGE;
+			break;
+		case 'o':
+			if (memcmp(name, "options", 7) == 0)
+				return MPD_PAIR_NAME_OPTIONS;
+			break;
+		case 's':
+			if (memcmp(name, "sticker", 7) == 0)
+				return MPD_PAIR_NAME_STICKER;
+			break;
+		}
+
+		break;
+
+	case 8:
+		switch (name[0]) {
+		case 'C':
+			if (memcmp(name, "Composer", 8) == 0)
+				return (enum mpd_pair_name)MPD_TAG_COMPOSER;
+			break;
+		case 'G':
+			if (memcmp(name, "Grouping", 8) == 0)
+				return (enum mpd_pair_name)MPD_TAG_GROUPING;
+			break;
+		case 'd':
+			if (memcmp(name, "duration", 8) == 0)
+				return MPD_PAIR_NAME_DURATION;
+			if (memcmp(name, "database", 8) == 0)
+				return MPD_PAIR_NAME_DATABASE;
+			break;
+		case 'n':
+			if (memcmp(name, "nextsong", 8) == 0)
+				return MPD_PAIR_NAME_NEXTSONG;
+			break;
+		case 'o':
+			if (memcmp(name, "outputid", 8) == 0)
+				return MPD_PAIR_NAME_OUTPUTID;
+			break;
+		case 'p':
+			if (memcmp(name, "playlist", 8) == 0)
+				return MPD_PAIR_NAME_PLAYLIST;
+			if (memcmp(name, "playtime", 8) == 0)
+				return MPD_PAIR_NAME_PLAYTIME;
+			break;
+		}
+
+		break;
+
+	case 9:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "AlbumSort", 9) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ALBUM_SORT;
+			break;
+		case 'C':
+			if (memcmp(name, "Conductor", 9) == 0)
+				return (enum mpd_pair_name)MPD_TAG_CONDUCTOR;
+			break;
+		case 'P':
+			if (memcmp(name, "Performer", 9) == 0)
+				return (enum mpd_pair_name)MPD_TAG_PERFORMER;
+			break;
+		case 'a':
+			if (memcmp(name, "attribute", 9) == 0)
+				return MPD_PAIR_NAME_ATTRIBUTE;
+			break;
+		case 'd':
+			if (memcmp(name, "db_update", 9) == 0)
+				return MPD_PAIR_NAME_DB_UPDATE;
+			if (memcmp(name, "directory", 9) == 0)
+				return MPD_PAIR_NAME_DIRECTORY;
+			break;
+		case 'm':
+			if (memcmp(name, "mixrampdb", 9) == 0)
+				return MPD_PAIR_NAME_MIXRAMPDB;
+			break;
+		case 'p':
+			if (memcmp(name, "partition", 9) == 0)
+				return MPD_PAIR_NAME_PARTITION;
+			break;
+		}
+
+		break;
+
+	case 10:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "ArtistSort", 10) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ARTIST_SORT;
+			break;
+		case 'n':
+			if (memcmp(name, "nextsongid", 10) == 0)
+				return MPD_PAIR_NAME_NEXTSONGID;
+			break;
+		case 'o':
+			if (memcmp(name, "outputname", 10) == 0)
+				return MPD_PAIR_NAME_OUTPUTNAME;
+			break;
+		}
+
+		break;
+
+	case 11:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "AlbumArtist", 11) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ALBUM_ARTIST;
+			break;
+		case 'd':
+			if (memcmp(name, "db_playtime", 11) == 0)
+				return MPD_PAIR_NAME_DB_PLAYTIME;
+			break;
+		case 'u':
+			if (memcmp(name, "updating_db", 11) == 0)
+				return MPD_PAIR_NAME_UPDATING_DB;
+			break;
+		}
+
+		break;
+
+	case 12:
+		switch (name[0]) {
+		case 'O':
+			if (memcmp(name, "OriginalDate", 12) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ORIGINAL_DATE;
+			break;
+		case 'm':
+			if (memcmp(name, "mixrampdelay", 12) == 0)
+				return MPD_PAIR_NAME_MIXRAMPDELAY;
+			break;
+		case 's':
+			if (memcmp(name, "subscription", 12) == 0)
+				return MPD_PAIR_NAME_SUBSCRIPTION;
+			break;
+		}
+
+		break;
+
+	case 13:
+		switch (name[0]) {
+		case 'L':
+			if (memcmp(name, "Last-Modified", 13) == 0)
+				return MPD_PAIR_NAME_LAST_MODIFIED;
+			break;
+		case 'o':
+			if (memcmp(name, "outputenabled", 13) == 0)
+				return MPD_PAIR_NAME_OUTPUTENABLED;
+			break;
+		}
+
+		break;
+
+	case 14:
+		if (memcmp(name, "playlistlength", 14) == 0)
+			return MPD_PAIR_NAME_PLAYLISTLENGTH;
+		break;
+
+	case 15:
+		switch (name[0]) {
+		case 'A':
+			if (memcmp(name, "AlbumArtistSort", 15) == 0)
+				return (enum mpd_pair_name)MPD_TAG_ALBUM_ARTIST_SORT;
+			break;
+		case 's':
+			if (memcmp(name, "stored_playlist", 15) == 0)
+				return MPD_PAIR_NAME_STORED_PLAYLIST;
+			break;
+		}
+
+		break;
+
+	case 18:
+		if (memcmp(name, "MUSICBRAINZ_WORKID", 18) == 0)
+			return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_WORKID;
+		break;
+
+	case 19:
+		switch (name[0]) {
+		case 'M':
+			if (memcmp(name, "MUSICBRAINZ_ALBUMID", 19) == 0)
+				return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_ALBUMID;
+			if (memcmp(name, "MUSICBRAINZ_TRACKID", 19) == 0)
+				return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_TRACKID;
+			break;
+		}
+
+		break;
+
+	case 20:
+		if (memcmp(name, "MUSICBRAINZ_ARTISTID", 20) == 0)
+			return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_ARTISTID;
+		break;
+
+	case 25:
+		if (memcmp(name, "MUSICBRAINZ_ALBUMARTISTID", 25) == 0)
+			return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_ALBUMARTISTID;
+		break;
+
+	case 26:
+		if (memcmp(name, "MUSICBRAINZ_RELEASETRACKID", 26) == 0)
+			return (enum mpd_pair_name)MPD_TAG_MUSICBRAINZ_RELEASETRACKID;
+		break;
+	}
+
+	return MPD_PAIR_NAME_UNKNOWN;
+}
+
+/**
+ * This implementation is limited to ASCII letters.  Cheap, and good
+ * enough for us: all valid tag names are hard-coded below.
+ */
+static inline bool
+ignore_case_char_equals(const char a, const char b)
+{
+	return (a & ~0x20) == (b & ~0x20);
+}
+
+static bool
+ignore_case_equals(const char *a, const char *b, size_t length)
+{
+	assert(a != NULL);
+	assert(b != NULL);
+
+	for (size_t i = 0; i < length; ++i)
+		if (!ignore_case_char_equals(a[i], b[i]))
+			return false;
+
+	return true;
+}
+
+enum mpd_tag_type
+mpd_pair_name_iparse_tag(const char *name)
+{
+	assert(name != NULL);
+
+	const size_t length = strlen(name);
+
+	switch (length) {
+	case 4:
+		switch (name[0] | 0x20) {
+		case 'd':
+			if (ignore_case_equals(name, "Date", 4))
+				return MPD_TAG_DATE;
+			if (ignore_case_equals(name, "Disc", 4))
+				return MPD_TAG_DISC;
+			break;
+		case 'n':
+			if (ignore_case_equals(name, "Name", 4))
+				return MPD_TAG_NAME;
+			break;
+		case 'w':
+			if (ignore_case_equals(name, "Work", 4))
+				return MPD_TAG_WORK;
+			break;
+		}
+
+		break;
+
+	case 5:
+		switch (name[0] | 0x20) {
+		case 'a':
+			if (ignore_case_equals(name, "Album", 5))
+				return MPD_TAG_ALBUM;
+			break;
+		case 'g':
+			if (ignore_case_equals(name, "Genre", 5))
+				return MPD_TAG_GENRE;
+			break;
+		case 'l':
+			if (ignore_case_equals(name, "Label", 5))
+				return MPD_TAG_LABEL;
+			break;
+		case 't':
+			if (ignore_case_equals(name, "Title", 5))
+				return MPD_TAG_TITLE;
+			if (ignore_case_equals(name, "Track", 5))
+				return MPD_TAG_TRACK;
+			break;
+		}
+
+		break;
+
+	case 6:
+		if (ignore_case_equals(name, "Artist", 6))
+			return MPD_TAG_ARTIST;
+		break;
+
+	case 7:
+		if (ignore_case_equals(name, "Comment", 7))
+			return MPD_TAG_COMMENT;
+		break;
+
+	case 8:
+		switch (name[0] | 0x20) {
+		case 'c':
+			if (ignore_case_equals(name, "Composer", 8))
+				return MPD_TAG_COMPOSER;
+			break;
+		case 'g':
+			if (ignore_case_equals(name, "Grouping", 8))
+				return MPD_TAG_GROUPING;
+			break;
+		}
+
+		break;
+
+	case 9:
+		switch (name[0] | 0x20) {
+		case 'a':
+			if (ignore_case_equals(name, "AlbumSort", 9))
+				return MPD_TAG_ALBUM_SORT;
+			break;
+		case 'c':
+			if (ignore_case_equals(name, "Conductor", 9))
+				return MPD_TAG_CONDUCTOR;
+			break;
+		case 'p':
+			if (ignore_case_equals(name, "Performer", 9))
+				return MPD_TAG_PERFORMER;
+			break;
+		}
+
+		break;
+
+	case 10:
+		if (ignore_case_equals(name, "ArtistSort", 10))
+			return MPD_TAG_ARTIST_SORT;
+		break;
+
+	case 11:
+		if (ignore_case_equals(name, "AlbumArtist", 11))
+			return MPD_TAG_ALBUM_ARTIST;
+		break;
+
+	case 12:
+		if (ignore_case_equals(name, "OriginalDate", 12))
+			return MPD_TAG_ORIGINAL_DATE;
+		break;
+
+	case 15:
+		if (ignore_case_equals(name, "AlbumArtistSort", 15))
+			return MPD_TAG_ALBUM_ARTIST_SORT;
+		break;
+
+	case 18:
+		if (ignore_case_equals(name, "MUSICBRAINZ_WORKID", 18))
+			return MPD_TAG_MUSICBRAINZ_WORKID;
+		break;
+
+	case 19:
+		switch (name[0] | 0x20) {
+		case 'm':
+			if (ignore_case_equals(name, "MUSICBRAINZ_ALBUMID", 19))
+				return MPD_TAG_MUSICBRAINZ_ALBUMID;
+			if (ignore_case_equals(name, "MUSICBRAINZ_TRACKID", 19))
+				return MPD_TAG_MUSICBRAINZ_TRACKID;
+			break;
+		}
+
+		break;
+
+	case 20:
+		if (ignore_case_equals(name, "MUSICBRAINZ_ARTISTID", 20))
+			return MPD_TAG_MUSICBRAINZ_ARTISTID;
+		break;
+
+	case 25:
+		if (ignore_case_equals(name, "MUSICBRAINZ_ALBUMARTISTID", 25))
+			return MPD_TAG_MUSICBRAINZ_ALBUMARTISTID;
+		break;
+
+	case 26:
+		if (ignore_case_equals(name, "MUSICBRAINZ_RELEASETRACKID", 26))
+			return MPD_TAG_MUSICBRAINZ_RELEASETRACKID;
+		break;
+	}
+
+	return MPD_TAG_UNKNOWN;
+}
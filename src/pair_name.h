@@ -0,0 +1,141 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef MPD_PAIR_NAME_H
+#define MPD_PAIR_NAME_H
+
+#include <mpd/tag.h>
+
+#include <stdbool.h>
+
+/**
+ * All pair names known to the response parsers.  The values below
+ * #MPD_TAG_COUNT are tag names, and they are equal to the
+ * corresponding #mpd_tag_type; this allows mpd_pair_name_parse() to
+ * resolve tags and other attributes with just one lookup.
+ */
+enum mpd_pair_name {
+	MPD_PAIR_NAME_UNKNOWN = -1,
+
+	/* song */
+	MPD_PAIR_NAME_FILE = MPD_TAG_COUNT,
+	MPD_PAIR_NAME_SONG_TIME,
+	MPD_PAIR_NAME_DURATION,
+	MPD_PAIR_NAME_RANGE,
+	MPD_PAIR_NAME_LAST_MODIFIED,
+	MPD_PAIR_NAME_POS,
+	MPD_PAIR_NAME_ID,
+	MPD_PAIR_NAME_PRIO,
+	MPD_PAIR_NAME_FORMAT,
+
+	/* status */
+	MPD_PAIR_NAME_VOLUME,
+	MPD_PAIR_NAME_REPEAT,
+	MPD_PAIR_NAME_RANDOM,
+	MPD_PAIR_NAME_SINGLE,
+	MPD_PAIR_NAME_CONSUME,
+	MPD_PAIR_NAME_PLAYLIST,
+	MPD_PAIR_NAME_PLAYLISTLENGTH,
+	MPD_PAIR_NAME_BITRATE,
+	MPD_PAIR_NAME_STATE,
+	MPD_PAIR_NAME_SONG,
+	MPD_PAIR_NAME_SONGID,
+	MPD_PAIR_NAME_NEXTSONG,
+	MPD_PAIR_NAME_NEXTSONGID,
+	MPD_PAIR_NAME_TIME,
+	MPD_PAIR_NAME_ELAPSED,
+	MPD_PAIR_NAME_PARTITION,
+	MPD_PAIR_NAME_ERROR,
+	MPD_PAIR_NAME_XFADE,
+	MPD_PAIR_NAME_MIXRAMPDB,
+	MPD_PAIR_NAME_MIXRAMPDELAY,
+	MPD_PAIR_NAME_UPDATING_DB,
+	MPD_PAIR_NAME_AUDIO,
+
+	/* stats */
+	MPD_PAIR_NAME_ARTISTS,
+	MPD_PAIR_NAME_ALBUMS,
+	MPD_PAIR_NAME_SONGS,
+	MPD_PAIR_NAME_UPTIME,
+	MPD_PAIR_NAME_DB_UPDATE,
+	MPD_PAIR_NAME_PLAYTIME,
+	MPD_PAIR_NAME_DB_PLAYTIME,
+
+	/* output */
+	MPD_PAIR_NAME_OUTPUTID,
+	MPD_PAIR_NAME_OUTPUTNAME,
+	MPD_PAIR_NAME_OUTPUTENABLED,
+	MPD_PAIR_NAME_PLUGIN,
+	MPD_PAIR_NAME_ATTRIBUTE,
+
+	/* idle */
+	MPD_PAIR_NAME_CHANGED,
+	MPD_PAIR_NAME_DATABASE,
+	MPD_PAIR_NAME_STORED_PLAYLIST,
+	MPD_PAIR_NAME_PLAYER,
+	MPD_PAIR_NAME_MIXER,
+	MPD_PAIR_NAME_OUTPUT,
+	MPD_PAIR_NAME_OPTIONS,
+	MPD_PAIR_NAME_UPDATE,
+	MPD_PAIR_NAME_STICKER,
+	MPD_PAIR_NAME_SUBSCRIPTION,
+	MPD_PAIR_NAME_MESSAGE,
+
+	/* directory */
+	MPD_PAIR_NAME_DIRECTORY,
+};
+
+/**
+ * Is this pair name a tag name?
+ */
+static inline bool
+mpd_pair_name_is_tag(enum mpd_pair_name name)
+{
+	return (unsigned)name < MPD_TAG_COUNT;
+}
+
+/**
+ * Looks up a pair name with a switch on its length and its first
+ * character, i.e. with at most a few memcmp() calls instead of a
+ * chain of strcmp() calls.  Matching is case sensitive.
+ *
+ * @return the #mpd_pair_name, or #MPD_PAIR_NAME_UNKNOWN
+ */
+enum mpd_pair_name
+mpd_pair_name_parse(const char *name);
+
+/**
+ * Same as mpd_pair_name_parse(), but only looks up tag names, and
+ * ignores case.
+ *
+ * @return the #mpd_tag_type, or #MPD_TAG_UNKNOWN
+ */
+enum mpd_tag_type
+mpd_pair_name_iparse_tag(const char *name);
+
+#endif
@@ -0,0 +1,237 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <mpd/pipeline.h>
+#include <mpd/connection.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include "isend.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdlib.h>
+
+struct mpd_pipeline_command {
+	mpd_pipeline_callback callback;
+	void *ctx;
+};
+
+struct mpd_pipeline {
+	struct mpd_connection *connection;
+
+	unsigned window;
+
+	/**
+	 * The commands whose responses have not been received yet: a
+	 * ring buffer of #window elements, starting at #head.
+	 */
+	unsigned head, n_pending;
+
+	struct mpd_pipeline_command commands[];
+};
+
+struct mpd_pipeline *
+mpd_pipeline_new(struct mpd_connection *connection, unsigned window)
+{
+	assert(connection != NULL);
+	assert(window > 0);
+
+	if (mpd_error_is_defined(&connection->error))
+		return NULL;
+
+	if (connection->receiving || connection->queued_responses > 0) {
+		mpd_error_code(&connection->error, MPD_ERROR_STATE);
+		mpd_error_message(&connection->error,
+				  "Cannot start a pipeline while "
+				  "receiving a response");
+		return NULL;
+	}
+
+	struct mpd_pipeline *pipeline =
+		malloc(sizeof(*pipeline) + window * sizeof(pipeline->commands[0]));
+	if (pipeline == NULL) {
+		mpd_error_code(&connection->error, MPD_ERROR_OOM);
+		return NULL;
+	}
+
+	if (!mpd_connection_cork(connection)) {
+		free(pipeline);
+		return NULL;
+	}
+
+	pipeline->connection = connection;
+	pipeline->window = window;
+	pipeline->head = 0;
+	pipeline->n_pending = 0;
+	return pipeline;
+}
+
+/**
+ * Returns the number of responses the connection has yet to
+ * receive, including the current one.
+ */
+static unsigned
+mpd_pipeline_outstanding(const struct mpd_connection *connection)
+{
+	return connection->receiving + connection->queued_responses;
+}
+
+/**
+ * Receives the oldest pending response.
+ *
+ * @param invoke_callback false to discard the response without
+ * invoking its callback
+ * @return false if the connection has failed
+ */
+static bool
+mpd_pipeline_receive(struct mpd_pipeline *pipeline, bool invoke_callback)
+{
+	struct mpd_connection *connection = pipeline->connection;
+
+	assert(pipeline->n_pending > 0);
+	assert(mpd_pipeline_outstanding(connection) == pipeline->n_pending);
+
+	const struct mpd_pipeline_command *command =
+		&pipeline->commands[pipeline->head];
+	pipeline->head = (pipeline->head + 1) % pipeline->window;
+	--pipeline->n_pending;
+
+	if (invoke_callback && command->callback != NULL)
+		command->callback(connection, command->ctx);
+
+	if (!mpd_error_is_defined(&connection->error)) {
+		if (mpd_pipeline_outstanding(connection) > pipeline->n_pending)
+			/* the callback has not finished the response */
+			mpd_response_finish(connection);
+		else
+			/* the callback may have read the response up
+			   to the NULL pair, which does not start
+			   receiving the next one by itself */
+			mpd_connection_next_response(connection);
+	}
+
+	if (mpd_connection_get_error(connection) == MPD_ERROR_SERVER)
+		/* a server error belongs to this command only;
+		   clearing it starts receiving the next response */
+		return mpd_connection_clear_error(connection);
+
+	return !mpd_error_is_defined(&connection->error);
+}
+
+void
+mpd_pipeline_free(struct mpd_pipeline *pipeline)
+{
+	struct mpd_connection *connection = pipeline->connection;
+
+	while (pipeline->n_pending > 0 &&
+	       mpd_pipeline_receive(pipeline, false)) {}
+
+	mpd_connection_uncork(connection);
+	free(pipeline);
+}
+
+/**
+ * Makes room for one more command, and remembers its callback.
+ */
+static bool
+mpd_pipeline_prepare(struct mpd_pipeline *pipeline)
+{
+	if (mpd_error_is_defined(&pipeline->connection->error))
+		return false;
+
+	return pipeline->n_pending < pipeline->window ||
+		mpd_pipeline_receive(pipeline, true);
+}
+
+static void
+mpd_pipeline_add(struct mpd_pipeline *pipeline,
+		 mpd_pipeline_callback callback, void *ctx)
+{
+	assert(pipeline->n_pending < pipeline->window);
+
+	struct mpd_pipeline_command *command =
+		&pipeline->commands[(pipeline->head + pipeline->n_pending) %
+				    pipeline->window];
+	command->callback = callback;
+	command->ctx = ctx;
+	++pipeline->n_pending;
+}
+
+bool
+mpd_pipeline_send(struct mpd_pipeline *pipeline,
+		  mpd_pipeline_callback callback, void *ctx,
+		  const char *command, ...)
+{
+	if (!mpd_pipeline_prepare(pipeline))
+		return false;
+
+	va_list ap;
+	va_start(ap, command);
+	bool success = mpd_send_command_v(pipeline->connection, command, ap);
+	va_end(ap);
+
+	if (success)
+		mpd_pipeline_add(pipeline, callback, ctx);
+	return success;
+}
+
+bool
+mpd_pipeline_send_argv(struct mpd_pipeline *pipeline,
+		       mpd_pipeline_callback callback, void *ctx,
+		       const char *command, const char *const *argv)
+{
+	if (!mpd_pipeline_prepare(pipeline))
+		return false;
+
+	bool success = mpd_send_command_argv(pipeline->connection,
+					     command, argv);
+	if (success)
+		mpd_pipeline_add(pipeline, callback, ctx);
+	return success;
+}
+
+bool
+mpd_pipeline_finish(struct mpd_pipeline *pipeline)
+{
+	if (mpd_error_is_defined(&pipeline->connection->error))
+		return false;
+
+	/* waiting for the first response flushes the output buffer */
+	while (pipeline->n_pending > 0)
+		if (!mpd_pipeline_receive(pipeline, true))
+			return false;
+
+	return mpd_flush(pipeline->connection);
+}
+
+unsigned
+mpd_pipeline_get_pending(const struct mpd_pipeline *pipeline)
+{
+	return pipeline->n_pending;
+}
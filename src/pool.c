@@ -0,0 +1,275 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "internal.h"
+#include "socket.h"
+#include "clock.h"
+
+#include <mpd/pool.h>
+#include <mpd/async.h>
+#include <mpd/connection.h>
+#include <mpd/password.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include <mpd/settings.h>
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+struct mpd_pool_slot {
+	struct mpd_connection *connection;
+
+	/**
+	 * The time of the last mpd_pool_put() call for this
+	 * connection [CLOCK_MONOTONIC milliseconds].
+	 */
+	long long last_used_ms;
+
+	/**
+	 * Has #connection been opened and authenticated
+	 * successfully?  If not, it only carries the error, and
+	 * mpd_pool_put() frees it.
+	 */
+	bool ready;
+
+	/**
+	 * Has this slot been borrowed by mpd_pool_get()?  This is
+	 * the only field which is accessed concurrently; the others
+	 * belong to the thread which has set it.
+	 */
+	bool busy;
+};
+
+struct mpd_pool {
+	struct mpd_settings *settings;
+
+	unsigned idle_check_ms;
+
+	unsigned size;
+
+	struct mpd_pool_slot slots[];
+};
+
+/**
+ * Opens a new connection for the slot, and sends the password.
+ */
+static void
+mpd_pool_connect(const struct mpd_pool *pool, struct mpd_pool_slot *slot)
+{
+	assert(slot->connection == NULL);
+
+	const struct mpd_settings *settings = pool->settings;
+
+	struct mpd_connection *connection =
+		mpd_connection_new(mpd_settings_get_host(settings),
+				   mpd_settings_get_port(settings),
+				   mpd_settings_get_timeout_ms(settings));
+	if (connection == NULL)
+		return;
+
+	/* atomic because mpd_pool_put() compares it from other
+	   threads */
+	__atomic_store_n(&slot->connection, connection, __ATOMIC_RELAXED);
+
+	if (mpd_settings_get_low_latency(settings) &&
+	    connection->async != NULL)
+		mpd_socket_low_latency(mpd_async_get_fd(connection->async));
+
+	const char *password = mpd_settings_get_password(settings);
+	slot->ready =
+		mpd_connection_get_error(slot->connection) == MPD_ERROR_SUCCESS &&
+		(password == NULL ||
+		 mpd_run_password(slot->connection, password));
+	slot->last_used_ms = mpd_clock_now_ms();
+}
+
+static void
+mpd_pool_disconnect(struct mpd_pool_slot *slot)
+{
+	if (slot->connection != NULL) {
+		mpd_connection_free(slot->connection);
+		__atomic_store_n(&slot->connection, NULL, __ATOMIC_RELAXED);
+	}
+
+	slot->ready = false;
+}
+
+/**
+ * Checks whether an idle connection is still alive.
+ */
+static bool
+mpd_pool_ping(struct mpd_connection *connection)
+{
+	return mpd_send_command(connection, "ping", NULL) &&
+		mpd_response_finish(connection);
+}
+
+struct mpd_pool *
+mpd_pool_new(const struct mpd_settings *settings, unsigned size)
+{
+	assert(settings != NULL);
+	assert(size > 0);
+
+	struct mpd_pool *pool =
+		malloc(sizeof(*pool) + size * sizeof(pool->slots[0]));
+	if (pool == NULL)
+		return NULL;
+
+	pool->settings =
+		mpd_settings_new(mpd_settings_get_host(settings),
+				 mpd_settings_get_port(settings),
+				 mpd_settings_get_timeout_ms(settings),
+				 NULL,
+				 mpd_settings_get_password(settings));
+	if (pool->settings == NULL) {
+		free(pool);
+		return NULL;
+	}
+
+	mpd_settings_set_low_latency(pool->settings,
+				     mpd_settings_get_low_latency(settings));
+
+	pool->idle_check_ms = 0;
+	pool->size = size;
+
+	for (unsigned i = 0; i < size; ++i) {
+		struct mpd_pool_slot *slot = &pool->slots[i];
+
+		slot->connection = NULL;
+		slot->ready = false;
+		slot->busy = false;
+
+		mpd_pool_connect(pool, slot);
+		if (!slot->ready)
+			/* try again in mpd_pool_get() */
+			mpd_pool_disconnect(slot);
+	}
+
+	return pool;
+}
+
+void
+mpd_pool_free(struct mpd_pool *pool)
+{
+	assert(pool != NULL);
+
+	for (unsigned i = 0; i < pool->size; ++i) {
+		assert(!__atomic_load_n(&pool->slots[i].busy, __ATOMIC_RELAXED));
+
+		mpd_pool_disconnect(&pool->slots[i]);
+	}
+
+	mpd_settings_free(pool->settings);
+	free(pool);
+}
+
+void
+mpd_pool_set_idle_check(struct mpd_pool *pool, unsigned idle_ms)
+{
+	assert(pool != NULL);
+
+	pool->idle_check_ms = idle_ms;
+}
+
+/**
+ * Attempts to claim a slot which is not in use.
+ */
+static struct mpd_pool_slot *
+mpd_pool_claim(struct mpd_pool *pool)
+{
+	for (unsigned i = 0; i < pool->size; ++i) {
+		struct mpd_pool_slot *slot = &pool->slots[i];
+
+		if (!__atomic_load_n(&slot->busy, __ATOMIC_RELAXED) &&
+		    !__atomic_exchange_n(&slot->busy, true, __ATOMIC_ACQUIRE))
+			return slot;
+	}
+
+	return NULL;
+}
+
+struct mpd_connection *
+mpd_pool_get(struct mpd_pool *pool)
+{
+	assert(pool != NULL);
+
+	struct mpd_pool_slot *slot = mpd_pool_claim(pool);
+	if (slot == NULL)
+		return NULL;
+
+	if (slot->connection != NULL && pool->idle_check_ms > 0 &&
+	    mpd_clock_now_ms() - slot->last_used_ms >= pool->idle_check_ms &&
+	    !mpd_pool_ping(slot->connection))
+		/* the server has probably closed the idle
+		   connection */
+		mpd_pool_disconnect(slot);
+
+	if (slot->connection == NULL) {
+		mpd_pool_connect(pool, slot);
+		if (slot->connection == NULL) {
+			/* out of memory */
+			__atomic_store_n(&slot->busy, false,
+					 __ATOMIC_RELEASE);
+			return NULL;
+		}
+	}
+
+	return slot->connection;
+}
+
+void
+mpd_pool_put(struct mpd_pool *pool, struct mpd_connection *connection)
+{
+	assert(pool != NULL);
+	assert(connection != NULL);
+
+	struct mpd_pool_slot *slot = NULL;
+	for (unsigned i = 0; i < pool->size; ++i) {
+		if (__atomic_load_n(&pool->slots[i].connection,
+				    __ATOMIC_RELAXED) == connection) {
+			slot = &pool->slots[i];
+			break;
+		}
+	}
+
+	assert(slot != NULL);
+	assert(__atomic_load_n(&slot->busy, __ATOMIC_RELAXED));
+
+	if (!slot->ready || !mpd_connection_clear_error(connection) ||
+	    connection->receiving || connection->sending_command_list ||
+	    connection->corked || connection->queued_responses > 0)
+		/* broken (e.g. #MPD_ERROR_CLOSED or
+		   #MPD_ERROR_TIMEOUT), or in the middle of a
+		   response; open a new one next time */
+		mpd_pool_disconnect(slot);
+	else
+		slot->last_used_ms = mpd_clock_now_ms();
+
+	__atomic_store_n(&slot->busy, false, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,1287 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "config.h"
+#include "iasync.h"
+#include "ierror.h"
+#include "ireactor.h"
+
+#include <mpd/reactor.h>
+#include <mpd/async.h>
+#include <mpd/pair.h>
+#include <mpd/parser.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_IO_URING
+#  include "uring.h"
+#  include <stdint.h>
+#  include <sys/socket.h>
+#endif
+
+#ifdef HAVE_EPOLL
+#  include <sys/epoll.h>
+#  include <unistd.h>
+#elif defined(_WIN32)
+#  include <winsock2.h>
+#else
+#  include <poll.h>
+#endif
+
+enum {
+	/**
+	 * The maximum number of events handled by one epoll_wait()
+	 * call.
+	 */
+	MPD_REACTOR_MAX_EVENTS = 64,
+};
+
+#ifdef HAVE_IO_URING
+
+enum {
+	/** the number of io_uring submission queue entries */
+	MPD_REACTOR_URING_ENTRIES = 256,
+
+	/** the size of #mpd_reactor_connection::send_buffer */
+	MPD_REACTOR_SEND_BUFFER_SIZE = 4096,
+
+	/**
+	 * How long mpd_reactor_free() waits for cancelled operations
+	 * before shutting down their sockets, and again before giving
+	 * up.
+	 */
+	MPD_REACTOR_FREE_TIMEOUT_MS = 1000,
+};
+
+/**
+ * The operation type, stored in the low bits of an io_uring
+ * "user_data" value; the other bits are the
+ * #mpd_reactor_connection pointer.
+ */
+enum mpd_reactor_op {
+	MPD_REACTOR_OP_RECV,
+	MPD_REACTOR_OP_SEND,
+	MPD_REACTOR_OP_CANCEL,
+
+	MPD_REACTOR_OP_MASK = 3,
+};
+
+#endif
+
+/**
+ * A command which has been sent, and whose response is pending.
+ */
+struct mpd_reactor_command {
+	mpd_reactor_pair_cb pair_cb;
+	mpd_reactor_done_cb done_cb;
+	void *ctx;
+};
+
+struct mpd_reactor_connection {
+	struct mpd_reactor *reactor;
+
+	/** the doubly linked list of all connections */
+	struct mpd_reactor_connection *prev, *next;
+
+	/**
+	 * The singly linked list of connections which have queued
+	 * output, see mpd_reactor_flush().
+	 */
+	struct mpd_reactor_connection *next_dirty;
+
+	struct mpd_async *async;
+
+	struct mpd_parser *parser;
+
+	/**
+	 * A copy of the error which made this connection fail.  Once
+	 * set, the connection is not monitored anymore.
+	 */
+	struct mpd_error_info error;
+
+	/**
+	 * A ring buffer of commands whose responses are pending, in
+	 * the order in which they were sent.
+	 */
+	struct mpd_reactor_command *commands;
+	unsigned command_head, n_commands, command_capacity;
+
+	/** do we expect the server's welcome line? */
+	bool welcome;
+
+	/** is this connection in the #mpd_reactor::dirty list? */
+	bool dirty;
+
+	/**
+	 * Has mpd_reactor_remove() been called during
+	 * mpd_reactor_dispatch()?  The object will be freed at the
+	 * end of mpd_reactor_dispatch().
+	 */
+	bool removed;
+
+#ifdef HAVE_IO_URING
+	/**
+	 * The number of io_uring operations in flight.  The object
+	 * cannot be freed before they are complete.
+	 */
+	unsigned uring_pending;
+
+	/** is an io_uring recv operation in flight? */
+	bool uring_recv;
+
+	/**
+	 * The data of the io_uring send operation in flight.  It is
+	 * copied from the output buffer, which may be modified (and
+	 * moved) while the kernel reads from this buffer.
+	 */
+	char *send_buffer;
+	size_t send_position, send_length;
+
+	/**
+	 * The value of mpd_reactor::reap_generation when this
+	 * connection was last counted by mpd_reactor_uring_reap().
+	 */
+	unsigned reap_generation;
+#endif
+};
+
+struct mpd_reactor {
+#ifdef HAVE_IO_URING
+	struct mpd_uring uring;
+
+	/**
+	 * Is the io_uring backend used?  If not, io_uring is not
+	 * available, and we fall back to epoll.
+	 */
+	bool use_uring;
+
+	/**
+	 * Incremented by each mpd_reactor_uring_reap() call, to count
+	 * each connection only once.
+	 */
+	unsigned reap_generation;
+#endif
+
+#ifdef HAVE_EPOLL
+	int epoll_fd;
+#endif
+
+	/** all connections (including failed ones) */
+	struct mpd_reactor_connection *connections;
+
+	/** connections which have queued output */
+	struct mpd_reactor_connection *dirty;
+
+	/** connections removed during dispatch, to be freed later */
+	struct mpd_reactor_connection *garbage;
+
+	/** is mpd_reactor_dispatch() running? */
+	bool dispatching;
+};
+
+struct mpd_reactor *
+mpd_reactor_new(void)
+{
+	struct mpd_reactor *reactor = malloc(sizeof(*reactor));
+	if (reactor == NULL)
+		return NULL;
+
+#ifdef HAVE_IO_URING
+	reactor->use_uring = mpd_uring_init(&reactor->uring,
+					    MPD_REACTOR_URING_ENTRIES);
+	if (reactor->use_uring)
+		reactor->epoll_fd = -1;
+	else
+#endif
+#ifdef HAVE_EPOLL
+	{
+		reactor->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (reactor->epoll_fd < 0) {
+			free(reactor);
+			return NULL;
+		}
+	}
+#endif
+
+	reactor->connections = NULL;
+	reactor->dirty = NULL;
+	reactor->garbage = NULL;
+	reactor->dispatching = false;
+#ifdef HAVE_IO_URING
+	reactor->reap_generation = 0;
+#endif
+	return reactor;
+}
+
+static void
+mpd_reactor_connection_free(struct mpd_reactor_connection *connection)
+{
+#ifdef HAVE_IO_URING
+	assert(connection->uring_pending == 0);
+
+	free(connection->send_buffer);
+#endif
+
+	mpd_async_free(connection->async);
+	mpd_parser_free(connection->parser);
+	mpd_error_deinit(&connection->error);
+	free(connection->commands);
+	free(connection);
+}
+
+static void
+mpd_reactor_collect_garbage(struct mpd_reactor *reactor)
+{
+	struct mpd_reactor_connection **p = &reactor->garbage, *connection;
+
+	while ((connection = *p) != NULL) {
+#ifdef HAVE_IO_URING
+		if (connection->uring_pending > 0) {
+			/* the kernel still uses its buffers */
+			p = &connection->next;
+			continue;
+		}
+#endif
+
+		*p = connection->next;
+		mpd_reactor_connection_free(connection);
+	}
+}
+
+#ifdef HAVE_IO_URING
+
+static struct mpd_reactor_connection *
+mpd_reactor_uring_complete(const struct io_uring_cqe *cqe);
+
+/**
+ * Handles all completions which are available.
+ *
+ * @param n_connections_r if not NULL, returns the number of
+ * connections which had completions, like epoll_wait() would
+ * @return the number of completions
+ */
+static int
+mpd_reactor_uring_reap(struct mpd_reactor *reactor,
+		       unsigned *n_connections_r)
+{
+	struct io_uring_cqe *cqe;
+	const unsigned generation = ++reactor->reap_generation;
+	unsigned n_connections = 0;
+	int n = 0;
+
+	while ((cqe = mpd_uring_peek_cqe(&reactor->uring)) != NULL) {
+		/* copy the entry, because the callbacks invoked by
+		   mpd_reactor_uring_complete() may submit more
+		   operations */
+		const struct io_uring_cqe copy = *cqe;
+		mpd_uring_cqe_seen(&reactor->uring);
+
+		struct mpd_reactor_connection *connection =
+			mpd_reactor_uring_complete(&copy);
+		if (connection != NULL &&
+		    connection->reap_generation != generation) {
+			connection->reap_generation = generation;
+			++n_connections;
+		}
+
+		++n;
+	}
+
+	if (n_connections_r != NULL)
+		*n_connections_r = n_connections;
+	return n;
+}
+
+#endif
+
+void
+mpd_reactor_free(struct mpd_reactor *reactor)
+{
+	assert(reactor != NULL);
+	assert(!reactor->dispatching);
+
+	while (reactor->connections != NULL)
+		mpd_reactor_remove(reactor->connections);
+
+	reactor->dirty = NULL;
+	mpd_reactor_collect_garbage(reactor);
+
+#ifdef HAVE_IO_URING
+	if (reactor->use_uring) {
+		/* wait until the operations of all removed
+		   connections have been cancelled; if they don't
+		   complete in time, shut their sockets down, and if
+		   even that doesn't help, leak the connections
+		   instead of freeing buffers the kernel may still
+		   use */
+		bool shut_down = false;
+		while (reactor->garbage != NULL &&
+		       mpd_uring_submit(&reactor->uring, true,
+					MPD_REACTOR_FREE_TIMEOUT_MS)) {
+			if (mpd_reactor_uring_reap(reactor, NULL) == 0) {
+				if (shut_down)
+					break;
+
+				for (struct mpd_reactor_connection *c =
+					     reactor->garbage;
+				     c != NULL; c = c->next)
+					shutdown(mpd_async_get_fd(c->async),
+						 SHUT_RDWR);
+				shut_down = true;
+			}
+
+			mpd_reactor_collect_garbage(reactor);
+		}
+
+		mpd_uring_deinit(&reactor->uring);
+	}
+#endif
+
+#ifdef HAVE_EPOLL
+	if (reactor->epoll_fd >= 0)
+		close(reactor->epoll_fd);
+#endif
+	free(reactor);
+}
+
+int
+mpd_reactor_get_fd(const struct mpd_reactor *reactor)
+{
+	assert(reactor != NULL);
+
+#ifdef HAVE_IO_URING
+	if (reactor->use_uring)
+		return reactor->uring.fd;
+#endif
+
+#ifdef HAVE_EPOLL
+	return reactor->epoll_fd;
+#else
+	(void)reactor;
+	return -1;
+#endif
+}
+
+#ifdef HAVE_IO_URING
+
+static uint64_t
+mpd_reactor_uring_data(struct mpd_reactor_connection *connection,
+		       enum mpd_reactor_op op)
+{
+	return (uint64_t)(uintptr_t)connection | op;
+}
+
+/**
+ * Submits a recv operation which receives directly into the free
+ * space of the input buffer.
+ *
+ * @return false on error (stored in #mpd_reactor_connection::error)
+ */
+static bool
+mpd_reactor_uring_recv(struct mpd_reactor_connection *connection)
+{
+	assert(!connection->uring_recv);
+
+	size_t room;
+	void *dest = mpd_async_input_tail(connection->async, &room);
+	if (dest == NULL) {
+		/* mpd_async_recv_line() grows a full buffer, so
+		   this happens only if it is at its limit */
+		mpd_error_code(&connection->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connection->error,
+				  "Response line too large");
+		return false;
+	}
+
+	struct io_uring_sqe *sqe =
+		mpd_uring_get_sqe(&connection->reactor->uring);
+	if (sqe == NULL) {
+		mpd_error_errno(&connection->error);
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = mpd_async_get_fd(connection->async);
+	sqe->addr = (uintptr_t)dest;
+	sqe->len = room;
+	sqe->user_data = mpd_reactor_uring_data(connection,
+						MPD_REACTOR_OP_RECV);
+
+	connection->uring_recv = true;
+	++connection->uring_pending;
+	return true;
+}
+
+/**
+ * Submits a send operation for the rest of
+ * #mpd_reactor_connection::send_buffer; if that is empty, it is
+ * refilled from the output buffer first.
+ *
+ * @return false on error (stored in #mpd_reactor_connection::error)
+ */
+static bool
+mpd_reactor_uring_send(struct mpd_reactor_connection *connection)
+{
+	if (connection->send_position == connection->send_length) {
+		if (connection->send_buffer == NULL) {
+			connection->send_buffer =
+				malloc(MPD_REACTOR_SEND_BUFFER_SIZE);
+			if (connection->send_buffer == NULL) {
+				mpd_error_code(&connection->error,
+					       MPD_ERROR_OOM);
+				return false;
+			}
+		}
+
+		connection->send_position = 0;
+		connection->send_length =
+			mpd_async_take_output(connection->async,
+					      connection->send_buffer,
+					      MPD_REACTOR_SEND_BUFFER_SIZE);
+		if (connection->send_length == 0)
+			/* nothing to send */
+			return true;
+	}
+
+	struct io_uring_sqe *sqe =
+		mpd_uring_get_sqe(&connection->reactor->uring);
+	if (sqe == NULL) {
+		mpd_error_errno(&connection->error);
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_SEND;
+	sqe->fd = mpd_async_get_fd(connection->async);
+	sqe->addr = (uintptr_t)(connection->send_buffer +
+				connection->send_position);
+	sqe->len = connection->send_length - connection->send_position;
+	sqe->msg_flags = MSG_NOSIGNAL;
+	sqe->user_data = mpd_reactor_uring_data(connection,
+						MPD_REACTOR_OP_SEND);
+
+	++connection->uring_pending;
+	return true;
+}
+
+/**
+ * Is an io_uring send operation in flight?
+ */
+static bool
+mpd_reactor_uring_sending(const struct mpd_reactor_connection *connection)
+{
+	return connection->send_position < connection->send_length;
+}
+
+/**
+ * Submits a request to cancel the specified operation.  If the
+ * submission queue is full, the socket is shut down instead, which
+ * makes the operation complete, too.
+ */
+static void
+mpd_reactor_uring_cancel(struct mpd_reactor_connection *connection,
+			 enum mpd_reactor_op op)
+{
+	struct io_uring_sqe *sqe =
+		mpd_uring_get_sqe(&connection->reactor->uring);
+	if (sqe == NULL) {
+		shutdown(mpd_async_get_fd(connection->async), SHUT_RDWR);
+		return;
+	}
+
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = mpd_reactor_uring_data(connection, op);
+	sqe->user_data = MPD_REACTOR_OP_CANCEL;
+}
+
+#endif
+
+/**
+ * Starts monitoring the socket.
+ */
+static bool
+mpd_reactor_register(struct mpd_reactor_connection *connection)
+{
+#ifdef HAVE_IO_URING
+	if (connection->reactor->use_uring)
+		return mpd_reactor_uring_recv(connection);
+#endif
+
+#ifdef HAVE_EPOLL
+	struct epoll_event event = {
+		/* edge-triggered: we read until the socket is
+		   drained, and write until the output buffer is
+		   empty or the socket is full */
+		.events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET,
+		.data.ptr = connection,
+	};
+
+	return epoll_ctl(connection->reactor->epoll_fd, EPOLL_CTL_ADD,
+			 mpd_async_get_fd(connection->async), &event) == 0;
+#else
+	(void)connection;
+	return true;
+#endif
+}
+
+/**
+ * Stops monitoring the socket.
+ */
+static void
+mpd_reactor_unregister(struct mpd_reactor_connection *connection)
+{
+#ifdef HAVE_IO_URING
+	if (connection->reactor->use_uring) {
+		if (connection->uring_recv)
+			mpd_reactor_uring_cancel(connection,
+						 MPD_REACTOR_OP_RECV);
+		if (mpd_reactor_uring_sending(connection))
+			mpd_reactor_uring_cancel(connection,
+						 MPD_REACTOR_OP_SEND);
+		return;
+	}
+#endif
+
+#ifdef HAVE_EPOLL
+	epoll_ctl(connection->reactor->epoll_fd, EPOLL_CTL_DEL,
+		  mpd_async_get_fd(connection->async), NULL);
+#else
+	(void)connection;
+#endif
+}
+
+/**
+ * Adds the connection to the #mpd_reactor::dirty list, so its output
+ * buffer will be flushed.
+ */
+static void
+mpd_reactor_mark_dirty(struct mpd_reactor_connection *connection)
+{
+	if (connection->dirty)
+		return;
+
+	struct mpd_reactor *reactor = connection->reactor;
+	connection->dirty = true;
+	connection->next_dirty = reactor->dirty;
+	reactor->dirty = connection;
+}
+
+struct mpd_reactor_connection *
+mpd_reactor_add(struct mpd_reactor *reactor, struct mpd_async *async,
+		bool welcome)
+{
+	assert(reactor != NULL);
+	assert(async != NULL);
+
+	struct mpd_reactor_connection *connection =
+		malloc(sizeof(*connection));
+	if (connection == NULL)
+		return NULL;
+
+	connection->parser = mpd_parser_new();
+	if (connection->parser == NULL) {
+		free(connection);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	connection->reactor = reactor;
+	connection->async = async;
+	mpd_error_init(&connection->error);
+	connection->commands = NULL;
+	connection->command_head = 0;
+	connection->n_commands = 0;
+	connection->command_capacity = 0;
+	connection->welcome = welcome;
+	connection->dirty = false;
+	connection->removed = false;
+
+#ifdef HAVE_IO_URING
+	connection->uring_pending = 0;
+	connection->uring_recv = false;
+	connection->send_buffer = NULL;
+	connection->send_position = connection->send_length = 0;
+	connection->reap_generation = 0;
+#endif
+
+	if (!mpd_reactor_register(connection)) {
+		mpd_error_deinit(&connection->error);
+		mpd_parser_free(connection->parser);
+		free(connection);
+		return NULL;
+	}
+
+	connection->prev = NULL;
+	connection->next = reactor->connections;
+	if (connection->next != NULL)
+		connection->next->prev = connection;
+	reactor->connections = connection;
+
+	/* there may be output already, e.g. a command queued
+	   before the connection was added */
+	mpd_reactor_mark_dirty(connection);
+
+	return connection;
+}
+
+/**
+ * Removes the oldest pending command from the queue and returns it.
+ */
+static struct mpd_reactor_command
+mpd_reactor_shift_command(struct mpd_reactor_connection *connection)
+{
+	assert(connection->n_commands > 0);
+
+	struct mpd_reactor_command command =
+		connection->commands[connection->command_head];
+	connection->command_head = (connection->command_head + 1)
+		% connection->command_capacity;
+	--connection->n_commands;
+	return command;
+}
+
+/**
+ * Invokes the done callbacks of all pending commands with the
+ * specified error.
+ */
+static void
+mpd_reactor_cancel_commands(struct mpd_reactor_connection *connection,
+			    enum mpd_error error, const char *message)
+{
+	while (connection->n_commands > 0) {
+		struct mpd_reactor_command command =
+			mpd_reactor_shift_command(connection);
+		if (command.done_cb != NULL)
+			command.done_cb(error, MPD_SERVER_ERROR_UNK,
+					message, command.ctx);
+	}
+}
+
+/**
+ * Marks the connection as failed, using the error which has been
+ * stored in #mpd_reactor_connection::error (or the one in the
+ * #mpd_async object, if that is not set).
+ */
+static void
+mpd_reactor_fail(struct mpd_reactor_connection *connection)
+{
+	if (!mpd_error_is_defined(&connection->error))
+		mpd_async_copy_error(connection->async, &connection->error);
+
+	assert(mpd_error_is_defined(&connection->error));
+
+	mpd_reactor_unregister(connection);
+	mpd_reactor_cancel_commands(connection, connection->error.code,
+				    mpd_error_get_message(&connection->error));
+}
+
+void
+mpd_reactor_remove(struct mpd_reactor_connection *connection)
+{
+	assert(connection != NULL);
+	assert(!connection->removed);
+
+	struct mpd_reactor *reactor = connection->reactor;
+
+	if (!mpd_error_is_defined(&connection->error)) {
+		mpd_reactor_unregister(connection);
+
+		mpd_error_code(&connection->error, MPD_ERROR_CLOSED);
+		mpd_error_message(&connection->error, "Connection removed");
+		mpd_reactor_cancel_commands(connection,
+					    connection->error.code,
+					    mpd_error_get_message(&connection->error));
+	}
+
+	if (connection->prev != NULL)
+		connection->prev->next = connection->next;
+	else
+		reactor->connections = connection->next;
+	if (connection->next != NULL)
+		connection->next->prev = connection->prev;
+
+#ifdef HAVE_IO_URING
+	const bool uring_pending = connection->uring_pending > 0;
+#else
+	const bool uring_pending = false;
+#endif
+
+	if (connection->dirty || reactor->dispatching || uring_pending) {
+		/* still referenced by the dirty list, by the pending
+		   events or by io_uring operations; free it later */
+		connection->removed = true;
+		connection->next = reactor->garbage;
+		reactor->garbage = connection;
+	} else
+		mpd_reactor_connection_free(connection);
+}
+
+struct mpd_async *
+mpd_reactor_connection_get_async(const struct mpd_reactor_connection *connection)
+{
+	assert(connection != NULL);
+
+	return connection->async;
+}
+
+enum mpd_error
+mpd_reactor_connection_get_error(const struct mpd_reactor_connection *connection)
+{
+	assert(connection != NULL);
+
+	return connection->error.code;
+}
+
+const char *
+mpd_reactor_connection_get_error_message(const struct mpd_reactor_connection *connection)
+{
+	assert(connection != NULL);
+
+	if (!mpd_error_is_defined(&connection->error))
+		return NULL;
+
+	return mpd_error_get_message(&connection->error);
+}
+
+/**
+ * Appends a command to the queue, growing it if necessary.
+ */
+static bool
+mpd_reactor_push_command(struct mpd_reactor_connection *connection,
+			 const struct mpd_reactor_command *command)
+{
+	if (connection->n_commands == connection->command_capacity) {
+		unsigned new_capacity = connection->command_capacity > 0
+			? connection->command_capacity * 2
+			: 8;
+		struct mpd_reactor_command *new_commands =
+			malloc(new_capacity * sizeof(*new_commands));
+		if (new_commands == NULL)
+			return false;
+
+		/* copy the ring buffer contents in order */
+		for (unsigned i = 0; i < connection->n_commands; ++i)
+			new_commands[i] = connection->commands[(connection->command_head + i) % connection->command_capacity];
+
+		free(connection->commands);
+		connection->commands = new_commands;
+		connection->command_head = 0;
+		connection->command_capacity = new_capacity;
+	}
+
+	connection->commands[(connection->command_head + connection->n_commands) % connection->command_capacity] = *command;
+	++connection->n_commands;
+	return true;
+}
+
+bool
+mpd_reactor_send_v(struct mpd_reactor_connection *connection,
+		   mpd_reactor_pair_cb pair_cb, mpd_reactor_done_cb done_cb,
+		   void *ctx, const char *command, va_list args)
+{
+	assert(connection != NULL);
+	assert(!connection->removed);
+	assert(command != NULL);
+
+	if (mpd_error_is_defined(&connection->error))
+		return false;
+
+	const struct mpd_reactor_command c = {
+		.pair_cb = pair_cb,
+		.done_cb = done_cb,
+		.ctx = ctx,
+	};
+
+	if (!mpd_reactor_push_command(connection, &c))
+		return false;
+
+	bool success = mpd_async_send_command_v(connection->async,
+						 command, args);
+	if (!success) {
+		/* undo mpd_reactor_push_command() */
+		--connection->n_commands;
+		return false;
+	}
+
+	/* flush the output buffer in the next mpd_reactor_dispatch()
+	   call */
+	mpd_reactor_mark_dirty(connection);
+
+	return true;
+}
+
+bool
+mpd_reactor_send(struct mpd_reactor_connection *connection,
+		 mpd_reactor_pair_cb pair_cb, mpd_reactor_done_cb done_cb,
+		 void *ctx, const char *command, ...)
+{
+	va_list args;
+	va_start(args, command);
+	bool success = mpd_reactor_send_v(connection, pair_cb, done_cb, ctx,
+					  command, args);
+	va_end(args);
+
+	return success;
+}
+
+/**
+ * Handles one line received from the server.
+ */
+static void
+mpd_reactor_handle_line(struct mpd_reactor_connection *connection,
+			char *line)
+{
+	if (connection->welcome) {
+		if (strncmp(line, "OK MPD ", 7) != 0) {
+			mpd_error_code(&connection->error,
+				       MPD_ERROR_MALFORMED);
+			mpd_error_message(&connection->error,
+					  "Malformed connect message received");
+			mpd_reactor_fail(connection);
+			return;
+		}
+
+		connection->welcome = false;
+		return;
+	}
+
+	if (connection->n_commands == 0) {
+		mpd_error_code(&connection->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connection->error,
+				  "Unexpected response line");
+		mpd_reactor_fail(connection);
+		return;
+	}
+
+	struct mpd_reactor_command *command =
+		&connection->commands[connection->command_head];
+	struct mpd_parser *parser = connection->parser;
+	struct mpd_reactor_command c;
+	struct mpd_pair pair;
+
+	switch (mpd_parser_feed(parser, line)) {
+	case MPD_PARSER_MALFORMED:
+		mpd_error_code(&connection->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connection->error,
+				  "Failed to parse MPD response");
+		mpd_reactor_fail(connection);
+		break;
+
+	case MPD_PARSER_SUCCESS:
+		if (mpd_parser_is_discrete(parser)) {
+			mpd_error_code(&connection->error,
+				       MPD_ERROR_MALFORMED);
+			mpd_error_message(&connection->error,
+					  "got an unexpected list_OK");
+			mpd_reactor_fail(connection);
+			break;
+		}
+
+		/* dequeue before invoking the callback, which may
+		   send more commands */
+		c = mpd_reactor_shift_command(connection);
+		if (c.done_cb != NULL)
+			c.done_cb(MPD_ERROR_SUCCESS, MPD_SERVER_ERROR_UNK,
+				  NULL, c.ctx);
+		break;
+
+	case MPD_PARSER_ERROR:
+		c = mpd_reactor_shift_command(connection);
+		if (c.done_cb != NULL) {
+			const char *message = mpd_parser_get_message(parser);
+			c.done_cb(MPD_ERROR_SERVER,
+				  mpd_parser_get_server_error(parser),
+				  message != NULL
+				  ? message : "Unspecified MPD error",
+				  c.ctx);
+		}
+		break;
+
+	case MPD_PARSER_PAIR:
+		if (command->pair_cb != NULL) {
+			pair.name = mpd_parser_get_name(parser);
+			pair.value = mpd_parser_get_value(parser);
+			command->pair_cb(&pair, command->ctx);
+		}
+		break;
+	}
+}
+
+/**
+ * Is this connection still usable after invoking callbacks?
+ */
+static bool
+mpd_reactor_is_alive(const struct mpd_reactor_connection *connection)
+{
+	return !connection->removed &&
+		!mpd_error_is_defined(&connection->error);
+}
+
+/**
+ * Handles all complete lines in the input buffer.
+ *
+ * @return true if the connection is still alive
+ */
+static bool
+mpd_reactor_handle_lines(struct mpd_reactor_connection *connection)
+{
+	char *line;
+
+	while ((line = mpd_async_recv_line(connection->async)) != NULL) {
+		mpd_reactor_handle_line(connection, line);
+		if (!mpd_reactor_is_alive(connection))
+			return false;
+	}
+
+	if (mpd_async_get_error(connection->async) != MPD_ERROR_SUCCESS) {
+		mpd_reactor_fail(connection);
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Receives and handles all data until the socket would block.
+ */
+static void
+mpd_reactor_handle_input(struct mpd_reactor_connection *connection)
+{
+	/* mpd_async_recv_line() has grown the input buffer if it was
+	   full, so mpd_async_fill() returns 0 only if the socket is
+	   drained (or on error) */
+	do {
+		if (!mpd_reactor_handle_lines(connection))
+			return;
+	} while (mpd_async_fill(connection->async) > 0);
+
+	if (mpd_async_get_error(connection->async) != MPD_ERROR_SUCCESS)
+		mpd_reactor_fail(connection);
+}
+
+/**
+ * Writes the output buffer until it is empty or the socket is full.
+ */
+static void
+mpd_reactor_handle_output(struct mpd_reactor_connection *connection)
+{
+#ifdef HAVE_IO_URING
+	if (connection->reactor->use_uring) {
+		/* if a send operation is in flight, its completion
+		   handler continues with the rest */
+		if (!mpd_reactor_uring_sending(connection) &&
+		    !mpd_reactor_uring_send(connection))
+			mpd_reactor_fail(connection);
+		return;
+	}
+#endif
+
+	if ((mpd_async_events(connection->async) & MPD_ASYNC_EVENT_WRITE) != 0 &&
+	    !mpd_async_io(connection->async, MPD_ASYNC_EVENT_WRITE))
+		mpd_reactor_fail(connection);
+}
+
+/**
+ * Flushes the output buffers of all connections which have queued
+ * commands.  Writing right away is necessary with edge-triggered
+ * epoll, because the socket is probably writable already, and no
+ * new edge will be reported.
+ */
+static void
+mpd_reactor_flush(struct mpd_reactor *reactor)
+{
+	struct mpd_reactor_connection *connection;
+
+	while ((connection = reactor->dirty) != NULL) {
+		reactor->dirty = connection->next_dirty;
+		connection->dirty = false;
+
+		if (mpd_reactor_is_alive(connection))
+			mpd_reactor_handle_output(connection);
+	}
+}
+
+#ifdef HAVE_EPOLL
+
+static int
+mpd_reactor_wait(struct mpd_reactor *reactor, int timeout_ms)
+{
+	struct epoll_event events[MPD_REACTOR_MAX_EVENTS];
+
+	int n = epoll_wait(reactor->epoll_fd, events,
+			   MPD_REACTOR_MAX_EVENTS, timeout_ms);
+	if (n < 0)
+		return errno == EINTR ? 0 : -1;
+
+	for (int i = 0; i < n; ++i) {
+		struct mpd_reactor_connection *connection =
+			events[i].data.ptr;
+
+		if (!mpd_reactor_is_alive(connection))
+			/* removed or failed by a callback */
+			continue;
+
+		if (events[i].events & EPOLLOUT)
+			mpd_reactor_handle_output(connection);
+
+		/* on hangup or error, read until recv() reports it,
+		   so no response data is lost */
+		if (mpd_reactor_is_alive(connection) &&
+		    events[i].events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR))
+			mpd_reactor_handle_input(connection);
+	}
+
+	return n;
+}
+
+#else
+
+/**
+ * A wrapper for poll() which treats EINTR like a timeout.  On
+ * Windows, it uses WSAPoll(), which cannot wait without sockets.
+ */
+static int
+mpd_reactor_poll(struct pollfd *fds, unsigned n, int timeout_ms)
+{
+#ifdef _WIN32
+	if (n == 0) {
+		Sleep(timeout_ms < 0 ? INFINITE : (DWORD)timeout_ms);
+		return 0;
+	}
+
+	return WSAPoll(fds, n, timeout_ms);
+#else
+	int result = poll(fds, n, timeout_ms);
+	return result < 0 && errno == EINTR ? 0 : result;
+#endif
+}
+
+static int
+mpd_reactor_wait(struct mpd_reactor *reactor, int timeout_ms)
+{
+	unsigned n_connections = 0;
+	for (const struct mpd_reactor_connection *c = reactor->connections;
+	     c != NULL; c = c->next)
+		if (mpd_reactor_is_alive(c))
+			++n_connections;
+
+	if (n_connections == 0)
+		return mpd_reactor_poll(NULL, 0, timeout_ms);
+
+	struct pollfd *fds = malloc(n_connections * sizeof(*fds));
+	struct mpd_reactor_connection **connections =
+		malloc(n_connections * sizeof(*connections));
+	if (fds == NULL || connections == NULL) {
+		free(fds);
+		free(connections);
+		errno = ENOMEM;
+		return -1;
+	}
+
+	unsigned i = 0;
+	for (struct mpd_reactor_connection *c = reactor->connections;
+	     c != NULL; c = c->next) {
+		if (!mpd_reactor_is_alive(c))
+			continue;
+
+		fds[i].fd = mpd_async_get_fd(c->async);
+		fds[i].events = POLLIN;
+		if (mpd_async_events(c->async) & MPD_ASYNC_EVENT_WRITE)
+			fds[i].events |= POLLOUT;
+		connections[i] = c;
+		++i;
+	}
+
+	int n = mpd_reactor_poll(fds, n_connections, timeout_ms);
+
+	for (i = 0; n > 0 && i < n_connections; ++i) {
+		struct mpd_reactor_connection *connection = connections[i];
+
+		if (fds[i].revents == 0 || !mpd_reactor_is_alive(connection))
+			continue;
+
+		if (fds[i].revents & POLLOUT)
+			mpd_reactor_handle_output(connection);
+
+		if (mpd_reactor_is_alive(connection) &&
+		    fds[i].revents & (POLLIN|POLLHUP|POLLERR))
+			mpd_reactor_handle_input(connection);
+	}
+
+	free(fds);
+	free(connections);
+	return n;
+}
+
+#endif
+
+#ifdef HAVE_IO_URING
+
+static void
+mpd_reactor_uring_recv_complete(struct mpd_reactor_connection *connection,
+				int res)
+{
+	if (res > 0) {
+		mpd_async_input_commit(connection->async, res);
+		if (!mpd_reactor_handle_lines(connection))
+			return;
+	} else if (res == 0) {
+		mpd_error_code(&connection->error, MPD_ERROR_CLOSED);
+		mpd_error_message(&connection->error,
+				  "Connection closed by the server");
+		mpd_reactor_fail(connection);
+		return;
+	} else if (res != -EINTR && res != -EAGAIN) {
+		mpd_error_system_message(&connection->error, -res);
+		mpd_reactor_fail(connection);
+		return;
+	}
+
+	if (!mpd_reactor_uring_recv(connection))
+		mpd_reactor_fail(connection);
+}
+
+static void
+mpd_reactor_uring_send_complete(struct mpd_reactor_connection *connection,
+				int res)
+{
+	if (res < 0 && res != -EINTR && res != -EAGAIN) {
+		mpd_error_system_message(&connection->error, -res);
+		mpd_reactor_fail(connection);
+		return;
+	}
+
+	if (res > 0)
+		connection->send_position += res;
+
+	/* send the rest, or refill the buffer and send more */
+	if (!mpd_reactor_uring_send(connection))
+		mpd_reactor_fail(connection);
+}
+
+/**
+ * Handles one completion.
+ *
+ * @return the connection the completion belongs to, or NULL if it
+ * was a cancel request
+ */
+static struct mpd_reactor_connection *
+mpd_reactor_uring_complete(const struct io_uring_cqe *cqe)
+{
+	const enum mpd_reactor_op op = cqe->user_data & MPD_REACTOR_OP_MASK;
+	if (op == MPD_REACTOR_OP_CANCEL)
+		return NULL;
+
+	struct mpd_reactor_connection *connection = (void *)(uintptr_t)
+		(cqe->user_data & ~(uint64_t)MPD_REACTOR_OP_MASK);
+
+	assert(connection->uring_pending > 0);
+	--connection->uring_pending;
+
+	if (op == MPD_REACTOR_OP_RECV)
+		connection->uring_recv = false;
+
+	if (!mpd_reactor_is_alive(connection)) {
+		/* removed or failed; the operation was probably
+		   cancelled */
+		if (op == MPD_REACTOR_OP_SEND)
+			connection->send_position = connection->send_length = 0;
+		return connection;
+	}
+
+	if (op == MPD_REACTOR_OP_RECV)
+		mpd_reactor_uring_recv_complete(connection, cqe->res);
+	else
+		mpd_reactor_uring_send_complete(connection, cqe->res);
+
+	/* removed connections are freed only after dispatching, so
+	   the pointer is still valid */
+	return connection;
+}
+
+/**
+ * Submits all queued operations, waits for completions and handles
+ * them.
+ *
+ * @return the number of connections which had completions, or -1 on
+ * error
+ */
+static int
+mpd_reactor_uring_wait(struct mpd_reactor *reactor, int timeout_ms)
+{
+	if (!mpd_uring_submit(&reactor->uring, timeout_ms != 0, timeout_ms))
+		return -1;
+
+	unsigned n_connections;
+	mpd_reactor_uring_reap(reactor, &n_connections);
+	return (int)n_connections;
+}
+
+#endif
+
+int
+mpd_reactor_dispatch(struct mpd_reactor *reactor, int timeout_ms)
+{
+	assert(reactor != NULL);
+	assert(!reactor->dispatching);
+
+	reactor->dispatching = true;
+
+	mpd_reactor_flush(reactor);
+
+#ifdef HAVE_IO_URING
+	if (reactor->use_uring) {
+		int result = mpd_reactor_uring_wait(reactor, timeout_ms);
+
+		/* send the commands queued by callbacks, all with
+		   one system call */
+		mpd_reactor_flush(reactor);
+		if (!mpd_uring_submit(&reactor->uring, false, 0))
+			result = -1;
+
+		reactor->dispatching = false;
+		mpd_reactor_collect_garbage(reactor);
+
+		return result;
+	}
+#endif
+
+	int result = mpd_reactor_wait(reactor, timeout_ms);
+
+	/* send the commands queued by callbacks */
+	mpd_reactor_flush(reactor);
+
+	reactor->dispatching = false;
+	mpd_reactor_collect_garbage(reactor);
+
+	return result;
+}
@@ -0,0 +1,301 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ * Typed responses on top of mpd_reactor_send(): the name-value pairs
+ * are fed into the same parsers which are used by the blocking
+ * mpd_recv_*() functions, and each finished object is passed to the
+ * caller.
+ */
+
+#include "ireactor.h"
+#include "isong.h"
+
+#include <mpd/reactor.h>
+#include <mpd/entity.h>
+#include <mpd/pair.h>
+#include <mpd/song.h>
+#include <mpd/status.h>
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum reactor_recv_type {
+	REACTOR_RECV_SONGS,
+	REACTOR_RECV_ENTITIES,
+	REACTOR_RECV_STATUS,
+};
+
+/**
+ * The state of one typed command.  It is allocated when the command
+ * is queued, and freed by reactor_recv_done().
+ */
+struct reactor_recv {
+	enum reactor_recv_type type;
+
+	union {
+		mpd_reactor_song_cb song;
+		mpd_reactor_entity_cb entity;
+		mpd_reactor_status_cb status;
+	} cb;
+
+	mpd_reactor_done_cb done_cb;
+	void *ctx;
+
+	/**
+	 * The object which is being parsed; it has not been passed
+	 * to the caller yet.
+	 */
+	union {
+		struct mpd_song *song;
+		struct mpd_entity *entity;
+		struct mpd_status *status;
+		void *any;
+	} current;
+
+	/**
+	 * Set when an object could not be allocated.  All further
+	 * pairs are ignored, and the done callback reports
+	 * #MPD_ERROR_OOM.
+	 */
+	bool oom;
+};
+
+static struct reactor_recv *
+reactor_recv_new(enum reactor_recv_type type,
+		 mpd_reactor_done_cb done_cb, void *ctx)
+{
+	struct reactor_recv *r = malloc(sizeof(*r));
+	if (r == NULL)
+		return NULL;
+
+	r->type = type;
+	r->done_cb = done_cb;
+	r->ctx = ctx;
+	r->current.any = NULL;
+	r->oom = false;
+	return r;
+}
+
+/**
+ * Passes the current object to the caller.
+ */
+static void
+reactor_recv_emit(struct reactor_recv *r)
+{
+	if (r->current.any == NULL)
+		return;
+
+	switch (r->type) {
+	case REACTOR_RECV_SONGS:
+		r->cb.song(mpd_song_pack(r->current.song), r->ctx);
+		break;
+
+	case REACTOR_RECV_ENTITIES:
+		r->cb.entity(r->current.entity, r->ctx);
+		break;
+
+	case REACTOR_RECV_STATUS:
+		r->cb.status(r->current.status, r->ctx);
+		break;
+	}
+
+	r->current.any = NULL;
+}
+
+/**
+ * Frees the current object without passing it to the caller.
+ */
+static void
+reactor_recv_discard(struct reactor_recv *r)
+{
+	if (r->current.any == NULL)
+		return;
+
+	switch (r->type) {
+	case REACTOR_RECV_SONGS:
+		mpd_song_free(r->current.song);
+		break;
+
+	case REACTOR_RECV_ENTITIES:
+		mpd_entity_free(r->current.entity);
+		break;
+
+	case REACTOR_RECV_STATUS:
+		mpd_status_free(r->current.status);
+		break;
+	}
+
+	r->current.any = NULL;
+}
+
+static void
+reactor_recv_pair(const struct mpd_pair *pair, void *ctx)
+{
+	struct reactor_recv *r = ctx;
+	if (r->oom)
+		return;
+
+	switch (r->type) {
+	case REACTOR_RECV_SONGS:
+		if (r->current.song != NULL &&
+		    mpd_song_feed(r->current.song, pair))
+			return;
+
+		if (strcmp(pair->name, "file") != 0)
+			/* ignore pairs before the first song */
+			return;
+
+		reactor_recv_emit(r);
+		r->current.song = mpd_song_begin(pair);
+		break;
+
+	case REACTOR_RECV_ENTITIES:
+		if (r->current.entity != NULL &&
+		    mpd_entity_feed(r->current.entity, pair))
+			return;
+
+		reactor_recv_emit(r);
+		r->current.entity = mpd_entity_begin(pair);
+		break;
+
+	case REACTOR_RECV_STATUS:
+		mpd_status_feed(r->current.status, pair);
+		return;
+	}
+
+	if (r->current.any == NULL)
+		r->oom = true;
+}
+
+static void
+reactor_recv_done(enum mpd_error error, enum mpd_server_error server_error,
+		  const char *message, void *ctx)
+{
+	struct reactor_recv *r = ctx;
+
+	if (error == MPD_ERROR_SUCCESS && r->oom) {
+		error = MPD_ERROR_OOM;
+		message = "Out of memory";
+	}
+
+	if (error == MPD_ERROR_SUCCESS)
+		reactor_recv_emit(r);
+	else
+		reactor_recv_discard(r);
+
+	if (r->done_cb != NULL)
+		r->done_cb(error, server_error, message, r->ctx);
+
+	free(r);
+}
+
+static bool
+reactor_recv_send_v(struct mpd_reactor_connection *connection,
+		    struct reactor_recv *r,
+		    const char *command, va_list args)
+{
+	if (!mpd_reactor_send_v(connection, reactor_recv_pair,
+				reactor_recv_done, r, command, args)) {
+		reactor_recv_discard(r);
+		free(r);
+		return false;
+	}
+
+	return true;
+}
+
+bool
+mpd_reactor_send_songs(struct mpd_reactor_connection *connection,
+		       mpd_reactor_song_cb song_cb,
+		       mpd_reactor_done_cb done_cb,
+		       void *ctx, const char *command, ...)
+{
+	struct reactor_recv *r =
+		reactor_recv_new(REACTOR_RECV_SONGS, done_cb, ctx);
+	if (r == NULL)
+		return false;
+
+	r->cb.song = song_cb;
+
+	va_list args;
+	va_start(args, command);
+	bool success = reactor_recv_send_v(connection, r, command, args);
+	va_end(args);
+
+	return success;
+}
+
+bool
+mpd_reactor_send_entities(struct mpd_reactor_connection *connection,
+			  mpd_reactor_entity_cb entity_cb,
+			  mpd_reactor_done_cb done_cb,
+			  void *ctx, const char *command, ...)
+{
+	struct reactor_recv *r =
+		reactor_recv_new(REACTOR_RECV_ENTITIES, done_cb, ctx);
+	if (r == NULL)
+		return false;
+
+	r->cb.entity = entity_cb;
+
+	va_list args;
+	va_start(args, command);
+	bool success = reactor_recv_send_v(connection, r, command, args);
+	va_end(args);
+
+	return success;
+}
+
+bool
+mpd_reactor_send_status(struct mpd_reactor_connection *connection,
+			mpd_reactor_status_cb status_cb,
+			mpd_reactor_done_cb done_cb, void *ctx)
+{
+	struct reactor_recv *r =
+		reactor_recv_new(REACTOR_RECV_STATUS, done_cb, ctx);
+	if (r == NULL)
+		return false;
+
+	r->cb.status = status_cb;
+	r->current.status = mpd_status_begin();
+	if (r->current.status == NULL) {
+		free(r);
+		return false;
+	}
+
+	if (!mpd_reactor_send(connection, reactor_recv_pair,
+			      reactor_recv_done, r, "status", NULL)) {
+		reactor_recv_discard(r);
+		free(r);
+		return false;
+	}
+
+	return true;
+}
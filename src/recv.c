@@ -36,6 +36,29 @@
 #include <string.h>
 #include <stdlib.h>
 
+/**
+ * Receives the newline which terminates a binary chunk.
+ */
+static bool
+recv_binary_newline(struct mpd_connection *connection, long long deadline_ms)
+{
+	char newline;
+	if (mpd_sync_recv_raw(connection->async, deadline_ms,
+			      &newline, sizeof(newline)) == 0) {
+		mpd_connection_sync_error(connection);
+		return false;
+	}
+
+	if (newline != '\n') {
+		mpd_error_code(&connection->error, MPD_ERROR_MALFORMED);
+		mpd_error_message(&connection->error,
+				  "Malformed binary response");
+		return false;
+	}
+
+	return true;
+}
+
 bool
 mpd_recv_binary(struct mpd_connection *connection, void *data, size_t length)
 {
@@ -47,10 +70,12 @@ mpd_recv_binary(struct mpd_connection *connection, void *data, size_t length)
 	/* check if the caller has returned the previous pair */
 	assert(connection->pair_state != PAIR_STATE_FLOATING);
 
+	/* one deadline for the whole chunk, not for each read */
+	const long long deadline_ms = mpd_connection_deadline(connection);
+
 	while (length > 0) {
 		size_t nbytes = mpd_sync_recv_raw(connection->async,
-						  mpd_connection_timeout(connection),
-						  data, length);
+						  deadline_ms, data, length);
 		if (nbytes == 0) {
 			mpd_connection_sync_error(connection);
 			return false;
@@ -60,55 +85,45 @@ mpd_recv_binary(struct mpd_connection *connection, void *data, size_t length)
 		length -= nbytes;
 	}
 
-	char newline;
-	if (mpd_sync_recv_raw(connection->async,
-			      mpd_connection_timeout(connection),
-			      &newline, sizeof(newline)) == 0) {
-		mpd_connection_sync_error(connection);
-		return false;
-	}
-
-	if (newline != '\n') {
-		mpd_error_code(&connection->error, MPD_ERROR_MALFORMED);
-		mpd_error_message(&connection->error,
-				  "Malformed binary response");
-		return false;
-	}
-
-	return true;
+	return recv_binary_newline(connection, deadline_ms);
 }
 
-struct mpd_pair *
-mpd_recv_pair(struct mpd_connection *connection)
+bool
+mpd_recv_binary_to_fd(struct mpd_connection *connection, int fd,
+		      size_t length)
 {
-	struct mpd_pair *pair;
-	char *line;
-	enum mpd_parser_result result;
-	const char *msg;
-
 	assert(connection != NULL);
+	assert(fd >= 0);
 
 	if (mpd_error_is_defined(&connection->error))
-		return NULL;
+		return false;
 
 	/* check if the caller has returned the previous pair */
 	assert(connection->pair_state != PAIR_STATE_FLOATING);
 
-	if (connection->pair_state == PAIR_STATE_NULL) {
-		/* return the enqueued NULL pair */
-		connection->pair_state = PAIR_STATE_NONE;
-		return NULL;
-	}
+	const long long deadline_ms = mpd_connection_deadline(connection);
 
-	if (connection->pair_state == PAIR_STATE_QUEUED) {
-		/* dequeue the pair from mpd_enqueue_pair() */
-		pair = &connection->pair;
-		connection->pair_state = PAIR_STATE_FLOATING;
-		return pair;
+	while (length > 0) {
+		size_t nbytes = mpd_sync_recv_to_fd(connection->async,
+						    deadline_ms, fd, length);
+		if (nbytes == 0) {
+			mpd_connection_sync_error(connection);
+			return false;
+		}
+
+		length -= nbytes;
 	}
 
-	assert(connection->pair_state == PAIR_STATE_NONE);
+	return recv_binary_newline(connection, deadline_ms);
+}
 
+/**
+ * Checks whether the connection is currently receiving a response
+ * which may contain more pairs.
+ */
+static bool
+recv_pair_check(struct mpd_connection *connection)
+{
 	if (!connection->receiving ||
 	    (connection->sending_command_list &&
 	     connection->command_list_remaining > 0 &&
@@ -116,18 +131,26 @@ mpd_recv_pair(struct mpd_connection *connection)
 		mpd_error_code(&connection->error, MPD_ERROR_STATE);
 		mpd_error_message(&connection->error,
 				  "already done processing current command");
-		return NULL;
+		return false;
 	}
 
-	line = mpd_sync_recv_line(connection->async,
-				  mpd_connection_timeout(connection));
-	if (line == NULL) {
-		connection->receiving = false;
-		connection->sending_command_list = false;
+	return true;
+}
 
-		mpd_connection_sync_error(connection);
-		return NULL;
-	}
+/**
+ * Feeds a response line to the parser, and updates the connection
+ * state.
+ *
+ * @return true if the line is a name-value pair (which is then stored
+ * in #pair), false if the response is finished or an error has
+ * occurred
+ */
+static bool
+recv_pair_line(struct mpd_connection *connection, char *line,
+	       struct mpd_pair *pair)
+{
+	enum mpd_parser_result result;
+	const char *msg;
 
 	result = mpd_parser_feed(connection->parser, line);
 	switch (result) {
@@ -136,7 +159,8 @@ mpd_recv_pair(struct mpd_connection *connection)
 		mpd_error_message(&connection->error,
 				  "Failed to parse MPD response");
 		connection->receiving = false;
-		return NULL;
+		connection->deadline_ms = -1;
+		return false;
 
 	case MPD_PARSER_SUCCESS:
 		if (!mpd_parser_is_discrete(connection->parser)) {
@@ -149,7 +173,10 @@ mpd_recv_pair(struct mpd_connection *connection)
 				connection->command_list_remaining = 0;
 			}
 
+			/* the response is over, and so is the deadline
+			   of its command */
 			connection->receiving = false;
+			connection->deadline_ms = -1;
 			connection->sending_command_list = false;
 			connection->discrete_finished = false;
 		} else {
@@ -165,10 +192,11 @@ mpd_recv_pair(struct mpd_connection *connection)
 			}
 		}
 
-		return NULL;
+		return false;
 
 	case MPD_PARSER_ERROR:
 		connection->receiving = false;
+		connection->deadline_ms = -1;
 		connection->sending_command_list = false;
 		mpd_error_server(&connection->error,
 				 mpd_parser_get_server_error(connection->parser),
@@ -177,20 +205,146 @@ mpd_recv_pair(struct mpd_connection *connection)
 		if (msg == NULL)
 			msg = "Unspecified MPD error";
 		mpd_error_message(&connection->error, msg);
-		return NULL;
+		return false;
 
 	case MPD_PARSER_PAIR:
-		pair = &connection->pair;
 		pair->name = mpd_parser_get_name(connection->parser);
 		pair->value = mpd_parser_get_value(connection->parser);
+		return true;
+	}
+
+	/* unreachable */
+	assert(false);
+	return false;
+}
+
+/**
+ * Receives the next line, waiting for it if necessary.
+ */
+static char *
+recv_pair_sync_line(struct mpd_connection *connection)
+{
+	char *line = mpd_sync_recv_line(connection->async,
+					mpd_connection_deadline(connection));
+	if (line == NULL) {
+		connection->receiving = false;
+		connection->sending_command_list = false;
 
+		mpd_connection_sync_error(connection);
+	}
+
+	return line;
+}
+
+struct mpd_pair *
+mpd_recv_pair(struct mpd_connection *connection)
+{
+	struct mpd_pair *pair;
+	char *line;
+
+	assert(connection != NULL);
+
+	if (mpd_error_is_defined(&connection->error))
+		return NULL;
+
+	/* check if the caller has returned the previous pair */
+	assert(connection->pair_state != PAIR_STATE_FLOATING);
+
+	if (connection->pair_state == PAIR_STATE_NULL) {
+		/* return the enqueued NULL pair */
+		connection->pair_state = PAIR_STATE_NONE;
+		return NULL;
+	}
+
+	if (connection->pair_state == PAIR_STATE_QUEUED) {
+		/* dequeue the pair from mpd_enqueue_pair() */
+		pair = &connection->pair;
 		connection->pair_state = PAIR_STATE_FLOATING;
 		return pair;
 	}
 
-	/* unreachable */
-	assert(false);
-	return NULL;
+	assert(connection->pair_state == PAIR_STATE_NONE);
+
+	if (!recv_pair_check(connection))
+		return NULL;
+
+	line = recv_pair_sync_line(connection);
+	if (line == NULL)
+		return NULL;
+
+	pair = &connection->pair;
+	if (!recv_pair_line(connection, line, pair))
+		return NULL;
+
+	connection->pair_state = PAIR_STATE_FLOATING;
+	return pair;
+}
+
+unsigned
+mpd_recv_pairs(struct mpd_connection *connection,
+	       struct mpd_pair *pairs, unsigned max)
+{
+	unsigned n = 0;
+	char *line;
+
+	assert(connection != NULL);
+	assert(pairs != NULL);
+	assert(max > 0);
+
+	if (mpd_error_is_defined(&connection->error))
+		return 0;
+
+	/* check if the caller has returned the previous pair */
+	assert(connection->pair_state != PAIR_STATE_FLOATING);
+
+	if (connection->pair_state == PAIR_STATE_NULL) {
+		/* return the enqueued NULL pair */
+		connection->pair_state = PAIR_STATE_NONE;
+		return 0;
+	}
+
+	if (connection->pair_state == PAIR_STATE_QUEUED) {
+		/* dequeue the pair from mpd_enqueue_pair() */
+		pairs[n++] = connection->pair;
+		connection->pair_state = PAIR_STATE_NONE;
+		if (n == max)
+			return n;
+
+		line = mpd_async_recv_line(connection->async);
+		if (line == NULL)
+			return n;
+	} else {
+		assert(connection->pair_state == PAIR_STATE_NONE);
+
+		if (!recv_pair_check(connection))
+			return 0;
+
+		/* only the first line may block; all following lines
+		   are taken from the input buffer without doing I/O,
+		   because that could invalidate the pointers of the
+		   pairs received so far */
+		line = recv_pair_sync_line(connection);
+		if (line == NULL)
+			return 0;
+	}
+
+	while (true) {
+		if (!recv_pair_line(connection, line, &pairs[n])) {
+			if (n > 0 &&
+			    !mpd_error_is_defined(&connection->error))
+				/* report the end of the response with
+				   the next call */
+				connection->pair_state = PAIR_STATE_NULL;
+			return n;
+		}
+
+		if (++n == max)
+			return n;
+
+		line = mpd_async_recv_line(connection->async);
+		if (line == NULL)
+			return n;
+	}
 }
 
 struct mpd_pair *
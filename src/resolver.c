@@ -27,6 +27,8 @@
 */
 
 #include "resolver.h"
+#include "fd_util.h"
+#include "clock.h"
 #include "config.h"
 
 #include <stdbool.h>
@@ -40,6 +42,10 @@
 #else
 #  include <sys/socket.h>
 #  include <sys/un.h>
+#  include <assert.h>
+#  include <errno.h>
+#  include <pthread.h>
+#  include <unistd.h>
 #ifdef ENABLE_TCP
 #  include <netinet/in.h>
 #  include <arpa/inet.h>
@@ -47,6 +53,69 @@
 #endif
 #endif
 
+#if defined(ENABLE_TCP) && defined(HAVE_GETADDRINFO) && !defined(_WIN32)
+#define RESOLVER_CACHE
+
+enum {
+	/**
+	 * How long a successful lookup is cached [ms].  getaddrinfo()
+	 * does not report the DNS TTL, so this is a fixed value which
+	 * is short enough to follow DNS changes.
+	 */
+	RESOLVER_CACHE_TTL_MS = 60 * 1000,
+
+	/**
+	 * How long a lookup which has failed permanently (e.g. "no
+	 * such host") is cached [ms].  Temporary failures are not
+	 * cached.
+	 */
+	RESOLVER_CACHE_NEGATIVE_TTL_MS = 5 * 1000,
+
+	/** the maximum number of cached host names */
+	RESOLVER_CACHE_SIZE = 16,
+};
+
+/**
+ * A cached getaddrinfo() result.  It is shared by all resolvers
+ * which use it, and freed when the last one is done.
+ */
+struct resolver_cache_entry {
+	struct resolver_cache_entry *next;
+
+	char *host;
+	unsigned port;
+
+	/** the result; NULL for a negative entry */
+	struct addrinfo *ai;
+
+	/** when this entry expires [mpd_clock_now_ms()] */
+	long long expires_ms;
+
+	/**
+	 * Is a thread resolving this host name right now?  Others
+	 * wait for it on #resolver_cache_cond instead of sending the
+	 * same query.
+	 */
+	bool resolving;
+
+	/**
+	 * One reference held by the cache (while the entry is in the
+	 * list), plus one for each resolver using #ai.
+	 */
+	unsigned refs;
+};
+
+/** protects all cache entries */
+static pthread_mutex_t resolver_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** signalled when a #resolver_cache_entry::resolving lookup is done */
+static pthread_cond_t resolver_cache_cond = PTHREAD_COND_INITIALIZER;
+
+/** the cached entries, newest first */
+static struct resolver_cache_entry *resolver_cache;
+
+#endif
+
 struct resolver {
 	enum {
 		TYPE_ZERO, TYPE_ONE, TYPE_ANY
@@ -56,6 +125,14 @@ struct resolver {
 #ifdef HAVE_GETADDRINFO
 	struct addrinfo *ai;
 	const struct addrinfo *next;
+
+#ifdef RESOLVER_CACHE
+	/**
+	 * The cache entry which owns #ai, or NULL if this object owns
+	 * it.
+	 */
+	struct resolver_cache_entry *entry;
+#endif
 #else
 	struct sockaddr_in sin;
 #endif
@@ -68,6 +145,302 @@ struct resolver {
 #endif
 };
 
+#if defined(ENABLE_TCP) && defined(HAVE_GETADDRINFO)
+
+static int
+resolver_getaddrinfo(const char *host, unsigned port, int flags,
+		     struct addrinfo **ai_r)
+{
+	struct addrinfo hints;
+	char service[20];
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_flags = flags;
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	snprintf(service, sizeof(service), "%d", port);
+
+	return getaddrinfo(host, service, &hints, ai_r);
+}
+
+#endif
+
+#ifdef RESOLVER_CACHE
+
+/**
+ * Drops a reference.  Caller must hold #resolver_cache_mutex.
+ */
+static void
+resolver_cache_unref(struct resolver_cache_entry *entry)
+{
+	assert(entry->refs > 0);
+
+	if (--entry->refs > 0)
+		return;
+
+	if (entry->ai != NULL)
+		freeaddrinfo(entry->ai);
+	free(entry->host);
+	free(entry);
+}
+
+/**
+ * Removes an entry from the list.  Caller must hold
+ * #resolver_cache_mutex.
+ */
+static void
+resolver_cache_remove(struct resolver_cache_entry **p)
+{
+	struct resolver_cache_entry *entry = *p;
+	*p = entry->next;
+	resolver_cache_unref(entry);
+}
+
+/**
+ * Inserts a new entry which is being resolved by the calling thread.
+ * Caller must hold #resolver_cache_mutex.
+ *
+ * @return the new entry (with one reference for the cache and one
+ * for the caller), or NULL if out of memory
+ */
+static struct resolver_cache_entry *
+resolver_cache_insert(const char *host, unsigned port)
+{
+	struct resolver_cache_entry *entry = malloc(sizeof(*entry));
+	if (entry == NULL)
+		return NULL;
+
+	entry->host = strdup(host);
+	if (entry->host == NULL) {
+		free(entry);
+		return NULL;
+	}
+
+	entry->port = port;
+	entry->ai = NULL;
+	entry->expires_ms = 0;
+	entry->resolving = true;
+	entry->refs = 2;
+
+	entry->next = resolver_cache;
+	resolver_cache = entry;
+
+	/* evict the oldest entries beyond the limit */
+	unsigned n = 0;
+	for (struct resolver_cache_entry **p = &resolver_cache; *p != NULL;) {
+		if (++n > RESOLVER_CACHE_SIZE && !(*p)->resolving)
+			resolver_cache_remove(p);
+		else
+			p = &(*p)->next;
+	}
+
+	return entry;
+}
+
+enum resolver_cache_result {
+	/** the host name is not in the cache */
+	RESOLVER_CACHE_MISS,
+
+	/** a cached result was found */
+	RESOLVER_CACHE_FOUND,
+
+	/** a cached negative result was found */
+	RESOLVER_CACHE_NOT_FOUND,
+};
+
+/**
+ * Looks up a host name in the cache.
+ *
+ * @param wait if true, wait for another thread which is resolving
+ * this host name, and on a miss, insert an entry which the caller
+ * must complete with resolver_cache_complete(); if false, this
+ * function never blocks
+ * @param entry_r on #RESOLVER_CACHE_FOUND, a referenced entry; on
+ * #RESOLVER_CACHE_MISS with #wait, the inserted entry (or NULL if
+ * out of memory)
+ */
+static enum resolver_cache_result
+resolver_cache_get(const char *host, unsigned port, bool wait,
+		   struct resolver_cache_entry **entry_r)
+{
+	enum resolver_cache_result result = RESOLVER_CACHE_MISS;
+
+	*entry_r = NULL;
+
+	pthread_mutex_lock(&resolver_cache_mutex);
+
+	const long long now = mpd_clock_now_ms();
+	struct resolver_cache_entry **p = &resolver_cache;
+	while (*p != NULL) {
+		struct resolver_cache_entry *entry = *p;
+
+		if (!entry->resolving && entry->expires_ms <= now) {
+			resolver_cache_remove(p);
+			continue;
+		}
+
+		if (entry->port != port || strcmp(entry->host, host) != 0) {
+			p = &entry->next;
+			continue;
+		}
+
+		if (entry->resolving) {
+			if (!wait)
+				break;
+
+			/* another thread is resolving this host name;
+			   wait for it and start over */
+			pthread_cond_wait(&resolver_cache_cond,
+					  &resolver_cache_mutex);
+			p = &resolver_cache;
+			continue;
+		}
+
+		if (entry->ai != NULL) {
+			++entry->refs;
+			*entry_r = entry;
+			result = RESOLVER_CACHE_FOUND;
+		} else
+			result = RESOLVER_CACHE_NOT_FOUND;
+
+		break;
+	}
+
+	if (result == RESOLVER_CACHE_MISS && wait)
+		*entry_r = resolver_cache_insert(host, port);
+
+	pthread_mutex_unlock(&resolver_cache_mutex);
+	return result;
+}
+
+/**
+ * Stores the result of a lookup in an entry which was inserted by
+ * resolver_cache_get(), and wakes up threads waiting for it.
+ *
+ * @return true if the entry is usable (and still referenced by the
+ * caller), false if the lookup has failed (and the caller's
+ * reference has been dropped)
+ */
+static bool
+resolver_cache_complete(struct resolver_cache_entry *entry,
+			int ret, struct addrinfo *ai)
+{
+	pthread_mutex_lock(&resolver_cache_mutex);
+
+	assert(entry->resolving);
+	entry->resolving = false;
+
+	const long long now = mpd_clock_now_ms();
+	if (ret == 0) {
+		entry->ai = ai;
+		entry->expires_ms = now + RESOLVER_CACHE_TTL_MS;
+	} else if (ret == EAI_NONAME || ret == EAI_FAIL)
+		/* the host does not exist */
+		entry->expires_ms = now + RESOLVER_CACHE_NEGATIVE_TTL_MS;
+	else
+		/* a temporary error: don't cache it */
+		entry->expires_ms = now;
+
+	if (ret != 0)
+		resolver_cache_unref(entry);
+
+	pthread_cond_broadcast(&resolver_cache_cond);
+	pthread_mutex_unlock(&resolver_cache_mutex);
+
+	return ret == 0;
+}
+
+void
+resolver_cache_clear(void)
+{
+	pthread_mutex_lock(&resolver_cache_mutex);
+
+	struct resolver_cache_entry **p = &resolver_cache;
+	while (*p != NULL) {
+		if ((*p)->resolving)
+			p = &(*p)->next;
+		else
+			resolver_cache_remove(p);
+	}
+
+	pthread_mutex_unlock(&resolver_cache_mutex);
+}
+
+static void
+resolver_set_cache_entry(struct resolver *resolver,
+			 struct resolver_cache_entry *entry)
+{
+	resolver->entry = entry;
+	resolver->ai = entry->ai;
+	resolver->next = resolver->ai;
+	resolver->type = TYPE_ANY;
+}
+
+#endif
+
+#ifndef RESOLVER_CACHE
+
+void
+resolver_cache_clear(void)
+{
+}
+
+#endif
+
+#if defined(ENABLE_TCP) && defined(HAVE_GETADDRINFO)
+
+/**
+ * Resolves a host name with getaddrinfo(), using the cache.
+ *
+ * @return true on success
+ */
+static bool
+resolver_lookup(struct resolver *resolver, const char *host, unsigned port)
+{
+#ifdef RESOLVER_CACHE
+	struct resolver_cache_entry *entry;
+
+	switch (resolver_cache_get(host, port, true, &entry)) {
+	case RESOLVER_CACHE_FOUND:
+		resolver_set_cache_entry(resolver, entry);
+		return true;
+
+	case RESOLVER_CACHE_NOT_FOUND:
+		return false;
+
+	case RESOLVER_CACHE_MISS:
+		break;
+	}
+
+	resolver->entry = NULL;
+#endif
+
+	struct addrinfo *ai;
+	int ret = resolver_getaddrinfo(host, port, 0, &ai);
+
+#ifdef RESOLVER_CACHE
+	if (entry != NULL) {
+		if (!resolver_cache_complete(entry, ret, ai))
+			return false;
+
+		resolver_set_cache_entry(resolver, entry);
+		return true;
+	}
+#endif
+
+	if (ret != 0)
+		return false;
+
+	resolver->ai = ai;
+	resolver->next = resolver->ai;
+	resolver->type = TYPE_ANY;
+	return true;
+}
+
+#endif
+
 struct resolver *
 resolver_new(const char *host, unsigned port)
 {
@@ -109,25 +482,10 @@ resolver_new(const char *host, unsigned port)
 	} else {
 #ifdef ENABLE_TCP
 #ifdef HAVE_GETADDRINFO
-		struct addrinfo hints;
-		char service[20];
-		int ret;
-
-		memset(&hints, 0, sizeof(hints));
-		hints.ai_family = PF_UNSPEC;
-		hints.ai_socktype = SOCK_STREAM;
-		hints.ai_protocol = IPPROTO_TCP;
-
-		snprintf(service, sizeof(service), "%d", port);
-
-		ret = getaddrinfo(host, service, &hints, &resolver->ai);
-		if (ret != 0) {
+		if (!resolver_lookup(resolver, host, port)) {
 			free(resolver);
 			return NULL;
 		}
-
-		resolver->next = resolver->ai;
-		resolver->type = TYPE_ANY;
 #else
 		const struct hostent *he;
 
@@ -170,12 +528,75 @@ void
 resolver_free(struct resolver *resolver)
 {
 #if defined(ENABLE_TCP) && defined(HAVE_GETADDRINFO)
-	if (resolver->type == TYPE_ANY)
-		freeaddrinfo(resolver->ai);
+	if (resolver->type == TYPE_ANY) {
+#ifdef RESOLVER_CACHE
+		if (resolver->entry != NULL) {
+			pthread_mutex_lock(&resolver_cache_mutex);
+			resolver_cache_unref(resolver->entry);
+			pthread_mutex_unlock(&resolver_cache_mutex);
+		} else
+#endif
+			freeaddrinfo(resolver->ai);
+	}
 #endif
 	free(resolver);
 }
 
+bool
+resolver_new_nonblocking(const char *host, unsigned port,
+			 struct resolver **resolver_r)
+{
+	if (host[0] == '/' || host[0] == '@') {
+		/* local sockets need no lookup */
+		*resolver_r = resolver_new(host, port);
+		return true;
+	}
+
+#if defined(ENABLE_TCP) && defined(HAVE_GETADDRINFO)
+	struct resolver *resolver = malloc(sizeof(*resolver));
+	if (resolver == NULL) {
+		*resolver_r = NULL;
+		return true;
+	}
+
+#ifdef RESOLVER_CACHE
+	struct resolver_cache_entry *entry;
+	switch (resolver_cache_get(host, port, false, &entry)) {
+	case RESOLVER_CACHE_FOUND:
+		resolver_set_cache_entry(resolver, entry);
+		*resolver_r = resolver;
+		return true;
+
+	case RESOLVER_CACHE_NOT_FOUND:
+		free(resolver);
+		*resolver_r = NULL;
+		return true;
+
+	case RESOLVER_CACHE_MISS:
+		break;
+	}
+
+	resolver->entry = NULL;
+#endif
+
+	/* numeric addresses are parsed without a DNS query */
+	struct addrinfo *ai;
+	if (resolver_getaddrinfo(host, port, AI_NUMERICHOST, &ai) == 0) {
+		resolver->ai = ai;
+		resolver->next = resolver->ai;
+		resolver->type = TYPE_ANY;
+		*resolver_r = resolver;
+		return true;
+	}
+
+	free(resolver);
+#else
+	(void)port;
+#endif
+
+	return false;
+}
+
 const struct resolver_address *
 resolver_next(struct resolver *resolver)
 {
@@ -203,3 +624,157 @@ resolver_next(struct resolver *resolver)
 	return NULL;
 #endif
 }
+
+#ifndef _WIN32
+
+struct resolver_async {
+	char *host;
+	unsigned port;
+
+	/**
+	 * The thread writes one byte to pipe_fds[1] when it is
+	 * done.
+	 */
+	int pipe_fds[2];
+
+	/**
+	 * The result; set by the thread before #done.
+	 */
+	struct resolver *result;
+
+	/** has the thread finished?  Accessed atomically. */
+	bool done;
+
+	/**
+	 * The number of references: one held by the caller, one by
+	 * the thread.  Accessed atomically; the last one frees the
+	 * object.
+	 */
+	unsigned refs;
+};
+
+static void
+resolver_async_unref(struct resolver_async *ra)
+{
+	if (__atomic_sub_fetch(&ra->refs, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
+	if (ra->result != NULL)
+		resolver_free(ra->result);
+
+	close(ra->pipe_fds[0]);
+	close(ra->pipe_fds[1]);
+	free(ra->host);
+	free(ra);
+}
+
+static void *
+resolver_async_run(void *arg)
+{
+	struct resolver_async *ra = arg;
+
+	ra->result = resolver_new(ra->host, ra->port);
+	__atomic_store_n(&ra->done, true, __ATOMIC_RELEASE);
+
+	/* wake up the caller's event loop; this cannot fail with
+	   EAGAIN, because only one byte is ever written */
+	ssize_t nbytes = write(ra->pipe_fds[1], "", 1);
+	(void)nbytes;
+
+	resolver_async_unref(ra);
+	return NULL;
+}
+
+struct resolver_async *
+resolver_async_new(const char *host, unsigned port)
+{
+	struct resolver_async *ra = malloc(sizeof(*ra));
+	if (ra == NULL)
+		return NULL;
+
+	struct resolver *result;
+	if (resolver_new_nonblocking(host, port, &result)) {
+		/* no thread needed */
+		if (pipe_cloexec_nonblock(ra->pipe_fds) < 0) {
+			if (result != NULL)
+				resolver_free(result);
+			free(ra);
+			return NULL;
+		}
+
+		ra->host = NULL;
+		ra->result = result;
+		ra->done = true;
+		ra->refs = 1;
+
+		ssize_t nbytes = write(ra->pipe_fds[1], "", 1);
+		(void)nbytes;
+		return ra;
+	}
+
+	ra->host = strdup(host);
+	if (ra->host == NULL) {
+		free(ra);
+		return NULL;
+	}
+
+	if (pipe_cloexec_nonblock(ra->pipe_fds) < 0) {
+		free(ra->host);
+		free(ra);
+		return NULL;
+	}
+
+	ra->port = port;
+	ra->result = NULL;
+	ra->done = false;
+	ra->refs = 2;
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	int error = pthread_create(&thread, &attr, resolver_async_run, ra);
+	pthread_attr_destroy(&attr);
+
+	if (error != 0) {
+		ra->refs = 1;
+		resolver_async_unref(ra);
+		errno = error;
+		return NULL;
+	}
+
+	return ra;
+}
+
+void
+resolver_async_free(struct resolver_async *ra)
+{
+	/* getaddrinfo() cannot be cancelled; the thread frees the
+	   object if it is still running */
+	resolver_async_unref(ra);
+}
+
+int
+resolver_async_get_fd(const struct resolver_async *ra)
+{
+	return ra->pipe_fds[0];
+}
+
+bool
+resolver_async_is_done(const struct resolver_async *ra)
+{
+	return __atomic_load_n(&ra->done, __ATOMIC_ACQUIRE);
+}
+
+struct resolver *
+resolver_async_take(struct resolver_async *ra)
+{
+	assert(resolver_async_is_done(ra));
+
+	struct resolver *result = ra->result;
+	ra->result = NULL;
+	return result;
+}
+
+#endif
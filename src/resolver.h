@@ -29,6 +29,7 @@
 #ifndef LIBMPDCLIENT_RESOLVER_H
 #define LIBMPDCLIENT_RESOLVER_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 struct resolver;
@@ -49,4 +50,72 @@ resolver_free(struct resolver *resolver);
 const struct resolver_address *
 resolver_next(struct resolver *resolver);
 
+/**
+ * Resolves the host name only if that is possible without blocking:
+ * local sockets, numeric addresses and host names found in the cache.
+ *
+ * @param resolver_r on success, the resolver (or NULL if the host
+ * name is known not to exist)
+ * @return true if the host name has been resolved, false if a DNS
+ * lookup is needed
+ */
+bool
+resolver_new_nonblocking(const char *host, unsigned port,
+			 struct resolver **resolver_r);
+
+/**
+ * Discards all cached lookups.
+ */
+void
+resolver_cache_clear(void);
+
+#ifndef _WIN32
+
+/**
+ * A host name resolution which runs in a separate thread, so it does
+ * not block the caller.
+ */
+struct resolver_async;
+
+/**
+ * Starts resolving the host name.  Local sockets, numeric addresses
+ * and cached host names are resolved immediately; all others in a
+ * new thread.
+ *
+ * @return the request, or NULL on error (errno is set)
+ */
+struct resolver_async *
+resolver_async_new(const char *host, unsigned port);
+
+/**
+ * Cancels the request (if still running) and frees it.  This does
+ * not block; the thread finishes in the background.
+ */
+void
+resolver_async_free(struct resolver_async *ra);
+
+/**
+ * Returns a file descriptor which becomes readable when the
+ * resolution is done.
+ */
+int
+resolver_async_get_fd(const struct resolver_async *ra);
+
+/**
+ * Is the resolution done?
+ */
+bool
+resolver_async_is_done(const struct resolver_async *ra);
+
+/**
+ * Returns the result of a request which is done.  The caller is
+ * responsible for freeing it.  This may be called only once.
+ *
+ * @return the resolver, or NULL if the host could not be resolved
+ */
+struct resolver *
+resolver_async_take(struct resolver_async *ra);
+
+#endif
+
 #endif
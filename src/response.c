@@ -33,9 +33,38 @@
 #include <mpd/response.h>
 #include <mpd/recv.h>
 #include "internal.h"
+#include "iasync.h"
+#include "sync.h"
 
 #include <assert.h>
 
+/**
+ * Discards the rest of the current response without parsing it, up
+ * to the line which finishes it; that line is left for
+ * mpd_recv_pair().
+ */
+static bool
+mpd_response_skip(struct mpd_connection *connection)
+{
+	struct mpd_async_skip skip = {
+		.binary = 0,
+		.mid_line = false,
+	};
+
+	while (!mpd_async_skip_response(connection->async, &skip)) {
+		if (!mpd_sync_io(connection->async,
+				 mpd_connection_deadline(connection))) {
+			connection->receiving = false;
+			connection->sending_command_list = false;
+
+			mpd_connection_sync_error(connection);
+			return false;
+		}
+	}
+
+	return true;
+}
+
 bool
 mpd_response_finish(struct mpd_connection *connection)
 {
@@ -54,6 +83,10 @@ mpd_response_finish(struct mpd_connection *connection)
 
 		connection->discrete_finished = false;
 
+		if (connection->pair_state == PAIR_STATE_NONE &&
+		    !mpd_response_skip(connection))
+			break;
+
 		pair = mpd_recv_pair(connection);
 		assert(pair != NULL || !connection->receiving ||
 		       (connection->sending_command_list &&
@@ -64,7 +97,14 @@ mpd_response_finish(struct mpd_connection *connection)
 			mpd_return_pair(connection, pair);
 	}
 
-	return !mpd_error_is_defined(&connection->error);
+	if (mpd_error_is_defined(&connection->error))
+		return false;
+
+	/* the deadline of this command has been met */
+	connection->deadline_ms = -1;
+
+	mpd_connection_next_response(connection);
+	return true;
 }
 
 bool
@@ -49,5 +49,12 @@ mpd_run_check(struct mpd_connection *connection)
 		return false;
 	}
 
+	if (connection->corked || connection->queued_responses > 0) {
+		mpd_error_code(&connection->error, MPD_ERROR_STATE);
+		mpd_error_message(&connection->error,
+				  "Not possible while corked");
+		return false;
+	}
+
 	return true;
 }
@@ -64,7 +64,8 @@ send_check(struct mpd_connection *connection)
 	if (mpd_error_is_defined(&connection->error))
 		return false;
 
-	if (connection->receiving) {
+	if ((connection->receiving || connection->queued_responses > 0) &&
+	    !connection->corked) {
 		mpd_error_code(&connection->error, MPD_ERROR_STATE);
 		mpd_error_message(&connection->error,
 				  "Cannot send a new command while "
@@ -75,23 +76,13 @@ send_check(struct mpd_connection *connection)
 	return true;
 }
 
-bool
-mpd_send_command(struct mpd_connection *connection, const char *command, ...)
+/**
+ * Finishes sending a command: flushes the output buffer (unless a
+ * command list is being sent) and updates the connection state.
+ */
+static bool
+send_finish(struct mpd_connection *connection, bool success)
 {
-	va_list ap;
-	bool success;
-
-	if (!send_check(connection))
-		return false;
-
-	va_start(ap, command);
-
-	success = mpd_sync_send_command_v(connection->async,
-					  mpd_connection_timeout(connection),
-					  command, ap);
-
-	va_end(ap);
-
 	if (!success) {
 		mpd_connection_sync_error(connection);
 		return false;
@@ -100,16 +91,67 @@ mpd_send_command(struct mpd_connection *connection, const char *command, ...)
 	if (!connection->sending_command_list) {
 		/* the caller might expect that we have flushed the
 		   output buffer when this function returns */
-		if (!mpd_flush(connection))
+		if (!connection->corked && !mpd_flush(connection))
 			return false;
 
-		connection->receiving = true;
+		if (connection->receiving)
+			/* corked: the response is received after the
+			   pending ones */
+			++connection->queued_responses;
+		else
+			connection->receiving = true;
 	} else if (connection->sending_command_list_ok)
 		++connection->command_list_remaining;
 
 	return true;
 }
 
+bool
+mpd_send_command_v(struct mpd_connection *connection, const char *command,
+		   va_list args)
+{
+	bool success;
+
+	if (!send_check(connection))
+		return false;
+
+	success = mpd_sync_send_command_v(connection->async,
+					  mpd_connection_deadline(connection),
+					  command, args);
+	return send_finish(connection, success);
+}
+
+bool
+mpd_send_command(struct mpd_connection *connection, const char *command, ...)
+{
+	va_list ap;
+	bool success;
+
+	va_start(ap, command);
+	success = mpd_send_command_v(connection, command, ap);
+	va_end(ap);
+
+	return success;
+}
+
+bool
+mpd_send_command_argv(struct mpd_connection *connection, const char *command,
+		      const char *const *argv)
+{
+	bool success;
+
+	assert(command != NULL);
+	assert(argv != NULL);
+
+	if (!send_check(connection))
+		return false;
+
+	success = mpd_sync_send_command_argv(connection->async,
+					     mpd_connection_deadline(connection),
+					     command, argv);
+	return send_finish(connection, success);
+}
+
 bool
 mpd_send_command2(struct mpd_connection *connection, const char *command)
 {
@@ -119,7 +161,7 @@ mpd_send_command2(struct mpd_connection *connection, const char *command)
 		return false;
 
 	success = mpd_sync_send_command(connection->async,
-					mpd_connection_timeout(connection),
+					mpd_connection_deadline(connection),
 					command, NULL);
 	if (!success) {
 		mpd_connection_sync_error(connection);
@@ -298,7 +340,7 @@ bool
 mpd_flush(struct mpd_connection *connection)
 {
 	if (!mpd_sync_flush(connection->async,
-			    mpd_connection_timeout(connection))) {
+			    mpd_connection_deadline(connection))) {
 		mpd_connection_sync_error(connection);
 		return false;
 	}
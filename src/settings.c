@@ -39,6 +39,8 @@ struct mpd_settings {
 	unsigned port, timeout_ms;
 
 	char *password;
+
+	bool low_latency;
 };
 
 /**
@@ -172,6 +174,7 @@ mpd_settings_new(const char *host, unsigned port, unsigned timeout_ms,
 		settings->host = NULL;
 
 	settings->password = NULL;
+	settings->low_latency = false;
 
 	port = mpd_check_port(port);
 
@@ -249,3 +252,15 @@ mpd_settings_get_password(const struct mpd_settings *settings)
 {
 	return settings->password;
 }
+
+void
+mpd_settings_set_low_latency(struct mpd_settings *settings, bool low_latency)
+{
+	settings->low_latency = low_latency;
+}
+
+bool
+mpd_settings_get_low_latency(const struct mpd_settings *settings)
+{
+	return settings->low_latency;
+}
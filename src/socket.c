@@ -41,12 +41,15 @@
 #  include <ws2tcpip.h>
 #else
 #  include <netinet/in.h>
+#  include <netinet/tcp.h>
 #  include <arpa/inet.h>
-#  include <sys/select.h>
+#  include <poll.h>
 #  include <sys/socket.h>
+#  include <sys/time.h>
 #  include <netdb.h>
 #  include <sys/un.h>
 #  include <errno.h>
+#  include <time.h>
 #  include <unistd.h>
 #endif
 
@@ -75,52 +78,302 @@ mpd_socket_global_init(struct mpd_error_info *error)
 
 #endif
 
+#ifdef _WIN32
+
+enum mpd_async_event
+mpd_socket_poll(mpd_socket_t fd, enum mpd_async_event events,
+		struct timeval *tv)
+{
+	fd_set rfds, wfds, efds;
+	int ret;
+
+	while (1) {
+		FD_ZERO(&rfds);
+		FD_ZERO(&wfds);
+		FD_ZERO(&efds);
+
+		if (events & MPD_ASYNC_EVENT_READ)
+			FD_SET(fd, &rfds);
+		if (events & MPD_ASYNC_EVENT_WRITE)
+			FD_SET(fd, &wfds);
+		if (events & (MPD_ASYNC_EVENT_HUP|MPD_ASYNC_EVENT_ERROR))
+			FD_SET(fd, &efds);
+
+		ret = select(fd + 1, &rfds, &wfds, &efds, tv);
+		if (ret > 0) {
+			if (!FD_ISSET(fd, &rfds))
+				events &= ~MPD_ASYNC_EVENT_READ;
+			if (!FD_ISSET(fd, &wfds))
+				events &= ~MPD_ASYNC_EVENT_WRITE;
+			if (!FD_ISSET(fd, &efds))
+				events &= ~(MPD_ASYNC_EVENT_HUP|
+					    MPD_ASYNC_EVENT_ERROR);
+
+			return events;
+		}
+
+		if (ret == 0 || !mpd_socket_ignore_errno(mpd_socket_errno()))
+			return 0;
+	}
+}
+
+#else
+
 /**
- * Wait for the socket to become writable.
+ * Converts a #timeval to a poll() timeout in milliseconds, rounding
+ * up so we never wake up too early.
  */
 static int
-mpd_socket_wait_writable(unsigned fd, struct timeval *tv)
+timeval_to_ms(const struct timeval *tv)
 {
-	fd_set fds;
+	if (tv == NULL)
+		return -1;
+
+	if (tv->tv_sec >= 1000000)
+		/* clamp to avoid an integer overflow */
+		return 1000000000;
+
+	return tv->tv_sec * 1000 + (tv->tv_usec + 999) / 1000;
+}
+
+static void
+now(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+/**
+ * Subtracts the time elapsed since #start from #tv, like Linux's
+ * select() does.
+ */
+static void
+timeval_subtract_elapsed(struct timeval *tv, const struct timespec *start)
+{
+	struct timespec end;
+	long long remaining_us;
+
+	now(&end);
+
+	remaining_us = (long long)tv->tv_sec * 1000000 + tv->tv_usec
+		- ((long long)(end.tv_sec - start->tv_sec) * 1000000
+		   + (end.tv_nsec - start->tv_nsec) / 1000);
+	if (remaining_us < 0)
+		remaining_us = 0;
+
+	tv->tv_sec = remaining_us / 1000000;
+	tv->tv_usec = remaining_us % 1000000;
+}
+
+enum mpd_async_event
+mpd_socket_poll(mpd_socket_t fd, enum mpd_async_event events,
+		struct timeval *tv)
+{
+	struct pollfd pfd;
+	struct timespec start;
 	int ret;
 
+	pfd.fd = fd;
+	pfd.events = 0;
+	if (events & MPD_ASYNC_EVENT_READ)
+		pfd.events |= POLLIN;
+	if (events & MPD_ASYNC_EVENT_WRITE)
+		pfd.events |= POLLOUT;
+
 	while (1) {
-		FD_ZERO(&fds);
-		FD_SET(fd, &fds);
+		if (tv != NULL)
+			now(&start);
 
-		ret = select(fd + 1, NULL, &fds, NULL, tv);
-		if (ret > 0)
-			return 0;
+		ret = poll(&pfd, 1, timeval_to_ms(tv));
+
+		if (tv != NULL)
+			timeval_subtract_elapsed(tv, &start);
+
+		if (ret > 0) {
+			enum mpd_async_event result = 0;
+
+			if (pfd.revents & POLLIN)
+				result |= MPD_ASYNC_EVENT_READ;
+			else if (pfd.revents & POLLHUP)
+				/* report the hangup only after all
+				   pending data has been read */
+				result |= MPD_ASYNC_EVENT_HUP;
+			if (pfd.revents & POLLOUT)
+				result |= MPD_ASYNC_EVENT_WRITE;
+			if (pfd.revents & (POLLERR|POLLNVAL))
+				result |= MPD_ASYNC_EVENT_ERROR;
+
+			return result & events;
+		}
 
 		if (ret == 0 || !mpd_socket_ignore_errno(mpd_socket_errno()))
-			return -1;
+			return 0;
 	}
 }
 
+#endif
+
+static long long
+timeval_to_us(const struct timeval *tv)
+{
+	return (long long)tv->tv_sec * 1000000 + tv->tv_usec;
+}
+
+static void
+timeval_from_us(struct timeval *tv, long long us)
+{
+	if (us < 0)
+		us = 0;
+
+	tv->tv_sec = us / 1000000;
+	tv->tv_usec = us % 1000000;
+}
+
+#ifdef _WIN32
+
 /**
- * Wait until the socket is connected and check its result.  Returns 1
- * on success, 0 on timeout, -errno on error.
+ * Waits until one of the sockets becomes writable (or fails).
+ *
+ * @param tv the timeout; on return, it contains the remaining time
+ * (zero after a timeout)
+ * @return the index of the socket, -1 on timeout or -2 on error
  */
 static int
-mpd_socket_wait_connected(mpd_socket_t fd, struct timeval *tv)
+mpd_socket_wait_any_writable(const mpd_socket_t *fds, unsigned n,
+			     struct timeval *tv)
+{
+	fd_set wfds, efds;
+	int ret;
+
+	while (1) {
+		FD_ZERO(&wfds);
+		FD_ZERO(&efds);
+		for (unsigned i = 0; i < n; ++i) {
+			FD_SET(fds[i], &wfds);
+			FD_SET(fds[i], &efds);
+		}
+
+		/* the first parameter is ignored on Windows */
+		ret = select(0, NULL, &wfds, &efds, tv);
+		if (ret > 0) {
+			for (unsigned i = 0; i < n; ++i)
+				if (FD_ISSET(fds[i], &wfds) ||
+				    FD_ISSET(fds[i], &efds))
+					return i;
+		}
+
+		if (ret == 0) {
+			timeval_from_us(tv, 0);
+			return -1;
+		}
+
+		if (!mpd_socket_ignore_errno(mpd_socket_errno()))
+			return -2;
+	}
+}
+
+#else
+
+static int
+mpd_socket_wait_any_writable(const mpd_socket_t *fds, unsigned n,
+			     struct timeval *tv)
 {
+	struct pollfd pfds[MPD_SOCKET_MAX_ADDRESSES];
+	struct timespec start;
 	int ret;
+
+	assert(n <= MPD_SOCKET_MAX_ADDRESSES);
+
+	for (unsigned i = 0; i < n; ++i) {
+		pfds[i].fd = fds[i];
+		pfds[i].events = POLLOUT;
+	}
+
+	while (1) {
+		now(&start);
+		ret = poll(pfds, n, timeval_to_ms(tv));
+		timeval_subtract_elapsed(tv, &start);
+
+		if (ret > 0) {
+			for (unsigned i = 0; i < n; ++i)
+				if (pfds[i].revents != 0)
+					return i;
+		}
+
+		if (ret == 0) {
+			timeval_from_us(tv, 0);
+			return -1;
+		}
+
+		if (!mpd_socket_ignore_errno(mpd_socket_errno()))
+			return -2;
+	}
+}
+
+#endif
+
+int
+mpd_socket_connect_result(mpd_socket_t fd)
+{
 	int s_err = 0;
 	socklen_t s_err_size = sizeof(s_err);
 
-	ret = mpd_socket_wait_writable(fd, tv);
-	if (ret < 0)
-		return 0;
+	if (getsockopt(fd, SOL_SOCKET, SO_ERROR,
+		       (char*)&s_err, &s_err_size) < 0)
+		return mpd_socket_errno();
 
-	ret = getsockopt(fd, SOL_SOCKET, SO_ERROR,
-			 (char*)&s_err, &s_err_size);
-	if (ret < 0)
-		return -mpd_socket_errno();
+	return s_err;
+}
+
+unsigned
+mpd_socket_collect_addresses(struct resolver *resolver,
+			     struct resolver_address *addresses)
+{
+	struct resolver_address first[MPD_SOCKET_MAX_ADDRESSES];
+	struct resolver_address other[MPD_SOCKET_MAX_ADDRESSES];
+	unsigned n_first = 0, n_other = 0;
+	const struct resolver_address *address;
+
+	while (n_first + n_other < MPD_SOCKET_MAX_ADDRESSES &&
+	       (address = resolver_next(resolver)) != NULL) {
+		if (n_first == 0 || address->family == first[0].family)
+			first[n_first++] = *address;
+		else
+			other[n_other++] = *address;
+	}
+
+	unsigned n = 0;
+	for (unsigned i = 0; i < n_first || i < n_other; ++i) {
+		if (i < n_first)
+			addresses[n++] = first[i];
+		if (i < n_other)
+			addresses[n++] = other[i];
+	}
+
+	return n;
+}
 
-	if (s_err != 0)
-		return -s_err;
+mpd_socket_t
+mpd_socket_start_connect(const struct resolver_address *address,
+			 struct mpd_error_info *error)
+{
+	mpd_socket_t fd = socket_cloexec_nonblock(address->family,
+						  SOCK_STREAM,
+						  address->protocol);
+	if (fd == MPD_INVALID_SOCKET) {
+		mpd_error_clear(error);
+		mpd_error_errno(error);
+		return MPD_INVALID_SOCKET;
+	}
 
-	return 1;
+	if (connect(fd, address->addr, address->addrlen) < 0 &&
+	    !mpd_socket_ignore_errno(mpd_socket_errno())) {
+		mpd_error_clear(error);
+		mpd_error_errno(error);
+		mpd_socket_close(fd);
+		return MPD_INVALID_SOCKET;
+	}
+
+	return fd;
 }
 
 mpd_socket_t
@@ -129,8 +382,14 @@ mpd_socket_connect(const char *host, unsigned port, const struct timeval *tv0,
 {
 	struct timeval tv = *tv0;
 	struct resolver *resolver;
-	const struct resolver_address *address;
-	int ret;
+	struct resolver_address addresses[MPD_SOCKET_MAX_ADDRESSES];
+	unsigned n_addresses, next_address = 0;
+
+	/* the sockets with a connection attempt in progress */
+	mpd_socket_t fds[MPD_SOCKET_MAX_ADDRESSES];
+	unsigned n_fds = 0;
+
+	mpd_socket_t result = MPD_INVALID_SOCKET;
 
 	resolver = resolver_new(host, port);
 	if (resolver == NULL) {
@@ -141,52 +400,77 @@ mpd_socket_connect(const char *host, unsigned port, const struct timeval *tv0,
 
 	assert(!mpd_error_is_defined(error));
 
-	while ((address = resolver_next(resolver)) != NULL) {
-		mpd_socket_t fd = socket_cloexec_nonblock(address->family,
-							  SOCK_STREAM,
-							  address->protocol);
-		if (fd == MPD_INVALID_SOCKET) {
-			mpd_error_clear(error);
-			mpd_error_errno(error);
-			continue;
-		}
+	n_addresses = mpd_socket_collect_addresses(resolver, addresses);
 
-		ret = connect(fd, address->addr, address->addrlen);
-		if (ret == 0) {
-			resolver_free(resolver);
-			mpd_error_clear(error);
-			return fd;
+	while (true) {
+		if (next_address < n_addresses) {
+			mpd_socket_t fd =
+				mpd_socket_start_connect(&addresses[next_address++],
+							 error);
+			if (fd == MPD_INVALID_SOCKET)
+				/* failed immediately; try the next
+				   address right away */
+				continue;
+
+			fds[n_fds++] = fd;
 		}
 
-		if (!mpd_socket_ignore_errno(mpd_socket_errno())) {
-			mpd_error_clear(error);
-			mpd_error_errno(error);
+		if (n_fds == 0)
+			/* all attempts have failed */
+			break;
+
+		/* wait for the pending attempts, but not longer than
+		   the attempt delay if there are more addresses */
+		struct timeval wait = tv;
+		if (next_address < n_addresses &&
+		    timeval_to_us(&wait) > MPD_SOCKET_ATTEMPT_DELAY_MS * 1000LL)
+			timeval_from_us(&wait,
+					MPD_SOCKET_ATTEMPT_DELAY_MS * 1000LL);
+
+		const long long before_us = timeval_to_us(&wait);
+		int i = mpd_socket_wait_any_writable(fds, n_fds, &wait);
+		timeval_from_us(&tv, timeval_to_us(&tv)
+				- (before_us - timeval_to_us(&wait)));
+
+		if (i >= 0) {
+			mpd_socket_t fd = fds[i];
+			fds[i] = fds[--n_fds];
+
+			int s_err = mpd_socket_connect_result(fd);
+			if (s_err == 0) {
+				result = fd;
+				break;
+			}
 
+			mpd_error_clear(error);
+			mpd_error_system_message(error, s_err);
 			mpd_socket_close(fd);
-			continue;
-		}
-
-		ret = mpd_socket_wait_connected(fd, &tv);
-		if (ret > 0) {
-			resolver_free(resolver);
+		} else if (i < -1) {
 			mpd_error_clear(error);
-			return fd;
-		}
-
-		if (ret == 0) {
+			mpd_error_errno(error);
+			break;
+		} else if (timeval_to_us(&tv) == 0) {
 			mpd_error_clear(error);
 			mpd_error_code(error, MPD_ERROR_TIMEOUT);
 			mpd_error_message(error, "Timeout while connecting");
-		} else if (ret < 0) {
-			mpd_error_clear(error);
-			mpd_error_system_message(error, -ret);
+			break;
 		}
-
-		mpd_socket_close(fd);
 	}
 
+	while (n_fds > 0)
+		mpd_socket_close(fds[--n_fds]);
+
 	resolver_free(resolver);
-	return -1;
+
+	if (result != MPD_INVALID_SOCKET)
+		mpd_error_clear(error);
+	else if (!mpd_error_is_defined(error)) {
+		/* the resolver did not return any address */
+		mpd_error_code(error, MPD_ERROR_RESOLVER);
+		mpd_error_message(error, "Failed to resolve host name");
+	}
+
+	return result;
 }
 
 int
@@ -208,3 +492,27 @@ mpd_socket_keepalive(mpd_socket_t fd, bool keepalive)
 	return setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE,
 			  (const char *) &keepalive_i, sizeof keepalive_i);
 }
+
+int
+mpd_socket_low_latency(mpd_socket_t fd)
+{
+	const int one = 1;
+
+#ifdef TCP_QUICKACK
+	/* acknowledge the welcome line and the first responses right
+	   away; the kernel may fall back to delayed ACKs later */
+	setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK,
+		   (const char *)&one, sizeof(one));
+#endif
+
+#ifdef SO_BUSY_POLL
+	/* raising this beyond net.core.busy_read requires
+	   CAP_NET_ADMIN, so failure is expected */
+	const int busy_poll_us = 50;
+	setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL,
+		   (const char *)&busy_poll_us, sizeof(busy_poll_us));
+#endif
+
+	return setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+			  (const char *)&one, sizeof(one));
+}
@@ -30,6 +30,7 @@
 #define MPD_SOCKET_H
 
 #include <mpd/socket.h>
+#include <mpd/async.h>
 
 #include <stdbool.h>
 
@@ -41,6 +42,8 @@
 
 struct timeval;
 struct mpd_error_info;
+struct resolver;
+struct resolver_address;
 
 #ifdef _WIN32
 bool
@@ -78,7 +81,75 @@ mpd_socket_ignore_errno(int e)
 }
 
 /**
- * Connects the socket to the specified host and port.
+ * Waits for events on the socket.  Uses poll(), which (unlike
+ * select()) works with descriptors beyond FD_SETSIZE; Windows uses
+ * select().
+ *
+ * @param events the events to wait for
+ * @param tv the timeout or NULL to wait forever; on return, it
+ * contains the remaining time (like Linux's select())
+ * @return the events which occurred, or 0 on timeout or error
+ */
+enum mpd_async_event
+mpd_socket_poll(mpd_socket_t fd, enum mpd_async_event events,
+		struct timeval *tv);
+
+enum {
+	/**
+	 * The maximum number of addresses tried by
+	 * mpd_socket_connect().
+	 */
+	MPD_SOCKET_MAX_ADDRESSES = 16,
+
+	/**
+	 * How long to wait for a connection attempt before starting
+	 * the next one in parallel, in milliseconds ("Connection
+	 * Attempt Delay" in RFC 8305).  The RFC recommends 250 ms,
+	 * but permits values down to 10 ms; MPD servers are usually
+	 * on the local network, where 50 ms is plenty.
+	 */
+	MPD_SOCKET_ATTEMPT_DELAY_MS = 50,
+};
+
+/**
+ * Obtains up to #MPD_SOCKET_MAX_ADDRESSES addresses from the
+ * resolver, and reorders them so that address families alternate
+ * (RFC 8305 section 4): if the first address family is unreachable,
+ * the second attempt already uses the other one.
+ *
+ * @param addresses an array of #MPD_SOCKET_MAX_ADDRESSES elements;
+ * the addresses point into the resolver, which must not be freed
+ * while they are in use
+ * @return the number of addresses
+ */
+unsigned
+mpd_socket_collect_addresses(struct resolver *resolver,
+			     struct resolver_address *addresses);
+
+/**
+ * Starts a non-blocking connection attempt.
+ *
+ * @return the socket (which may already be connected), or
+ * #MPD_INVALID_SOCKET on error
+ */
+mpd_socket_t
+mpd_socket_start_connect(const struct resolver_address *address,
+			 struct mpd_error_info *error);
+
+/**
+ * Checks the result of a non-blocking connect(), after the socket
+ * has become writable.
+ *
+ * @return 0 on success, or the error code
+ */
+int
+mpd_socket_connect_result(mpd_socket_t fd);
+
+/**
+ * Connects to all addresses of the host in parallel, staggered by
+ * #MPD_SOCKET_ATTEMPT_DELAY_MS ("Happy Eyeballs", RFC 8305).  The
+ * first socket which gets connected wins, and all others are
+ * closed.
  *
  * @return the socket file descriptor, or -1 on failure
  */
@@ -99,4 +170,15 @@ mpd_socket_close(mpd_socket_t fd);
 int
 mpd_socket_keepalive(mpd_socket_t fd, bool keepalive);
 
+/**
+ * Applies the low-latency profile (see
+ * mpd_settings_set_low_latency()) to a connected socket.  The
+ * options which are not essential are applied on a best-effort
+ * basis; on a local socket, this fails harmlessly.
+ *
+ * @return 0 on success, -1 if TCP_NODELAY could not be set
+ */
+int
+mpd_socket_low_latency(mpd_socket_t fd);
+
 #endif
@@ -38,22 +38,63 @@
 #include "iso8601.h"
 #include "uri.h"
 #include "iaf.h"
+#include "iarena.h"
+#include "isong.h"
+#include "decimal.h"
+#include "pair_name.h"
 
 #include <assert.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
-struct mpd_tag_value {
-	struct mpd_tag_value *next;
+/**
+ * An entry in the tag index of a #mpd_song.
+ */
+struct mpd_song_tag {
+	/** the #mpd_tag_type */
+	unsigned char type;
 
-	char *value;
+	/** the position of the value in mpd_song.strings */
+	unsigned offset;
 };
 
 struct mpd_song {
-	char *uri;
+	/**
+	 * The tag index, sorted by type.  Multiple values of the same
+	 * type are in the order they were received.
+	 */
+	struct mpd_song_tag *tags;
+
+	/**
+	 * The URI (at offset 0), followed by all tag values, each
+	 * null-terminated.
+	 */
+	char *strings;
+
+	/** the number of entries in #tags */
+	unsigned n_tags;
 
-	struct mpd_tag_value tags[MPD_TAG_COUNT];
+	/** the number of bytes used in #strings */
+	unsigned strings_size;
+
+	/** the allocated sizes of #tags and #strings */
+	unsigned tags_capacity, strings_capacity;
+
+	/**
+	 * Are #tags and #strings separate heap allocations owned by
+	 * this object?  If not, they are part of the song's own
+	 * allocation (see mpd_song_alloc_packed()), or they belong to
+	 * a #mpd_song_builder.
+	 */
+	bool heap;
+
+	/**
+	 * Was this song allocated in a #mpd_arena?  Then it is owned
+	 * by the arena, and mpd_song_free() does nothing.
+	 */
+	bool in_arena;
 
 	/**
 	 * Duration of the song in seconds, or 0 for unknown.
@@ -114,28 +155,13 @@ struct mpd_song {
 	struct mpd_audio_format audio_format;
 };
 
-static struct mpd_song *
-mpd_song_new(const char *uri)
+/**
+ * Initializes all attributes of a song which are not stored in
+ * mpd_song.strings.
+ */
+static void
+mpd_song_init(struct mpd_song *song)
 {
-	struct mpd_song *song;
-
-	assert(uri != NULL);
-	assert(mpd_verify_uri(uri));
-
-	song = malloc(sizeof(*song));
-	if (song == NULL)
-		/* out of memory */
-		return NULL;
-
-	song->uri = strdup(uri);
-	if (song->uri == NULL) {
-		free(song);
-		return NULL;
-	}
-
-	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i)
-		song->tags[i].value = NULL;
-
 	song->duration = 0;
 	song->duration_ms = 0;
 	song->start = 0;
@@ -150,81 +176,143 @@ mpd_song_new(const char *uri)
 #ifndef NDEBUG
 	song->finished = false;
 #endif
+}
 
-	return song;
+/**
+ * Returns the size of a "packed" song (see mpd_song_alloc_packed()).
+ */
+static size_t
+mpd_song_packed_size(unsigned n_tags, unsigned strings_size)
+{
+	return sizeof(struct mpd_song) +
+		n_tags * sizeof(struct mpd_song_tag) + strings_size;
 }
 
-void mpd_song_free(struct mpd_song *song) {
-	assert(song != NULL);
+/**
+ * Allocates a "packed" song: the tag index and the strings are
+ * stored right after the struct, in the same allocation.  Only the
+ * array pointers, the sizes and the ownership flags are initialized.
+ *
+ * @param arena the arena to allocate the song in, or NULL to
+ * allocate it on the heap
+ */
+static struct mpd_song *
+mpd_song_alloc_packed(struct mpd_arena *arena,
+		      unsigned n_tags, unsigned strings_size)
+{
+	struct mpd_song *song;
 
-	free(song->uri);
+	const size_t size = mpd_song_packed_size(n_tags, strings_size);
+	song = arena != NULL
+		? mpd_arena_alloc(arena, size)
+		: malloc(size);
+	if (song == NULL)
+		/* out of memory */
+		return NULL;
 
-	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i) {
-		struct mpd_tag_value *tag = &song->tags[i], *next;
+	song->tags = (struct mpd_song_tag *)(song + 1);
+	song->strings = (char *)(song->tags + n_tags);
+	song->n_tags = song->tags_capacity = n_tags;
+	song->strings_size = song->strings_capacity = strings_size;
+	song->heap = false;
+	song->in_arena = arena != NULL;
+	return song;
+}
 
-		if (tag->value == NULL)
-			continue;
+static struct mpd_song *
+mpd_song_new(const char *uri)
+{
+	struct mpd_song *song;
+
+	assert(uri != NULL);
+	assert(mpd_verify_uri(uri));
+
+	const size_t size = strlen(uri) + 1;
+	song = mpd_song_alloc_packed(NULL, 0, size);
+	if (song == NULL)
+		/* out of memory */
+		return NULL;
 
-		free(tag->value);
+	memcpy(song->strings, uri, size);
+	mpd_song_init(song);
+	return song;
+}
 
-		tag = tag->next;
+void mpd_song_free(struct mpd_song *song) {
+	assert(song != NULL);
 
-		while (tag != NULL) {
-			assert(tag->value != NULL);
-			free(tag->value);
+	if (song->in_arena)
+		/* released by mpd_arena_reset() or mpd_arena_free() */
+		return;
 
-			next = tag->next;
-			free(tag);
-			tag = next;
-		}
+	if (song->heap) {
+		free(song->tags);
+		free(song->strings);
 	}
 
 	free(song);
 }
 
-static bool
-mpd_song_add_tag(struct mpd_song *song,
-		 enum mpd_tag_type type, const char *value);
+/**
+ * Copies a song into a new packed allocation without unused space.
+ *
+ * @param arena the arena to allocate the copy in, or NULL to
+ * allocate it on the heap
+ */
+static struct mpd_song *
+mpd_song_pack_copy(struct mpd_arena *arena, const struct mpd_song *src)
+{
+	struct mpd_song *song =
+		mpd_song_alloc_packed(arena, src->n_tags, src->strings_size);
+	if (song == NULL)
+		return NULL;
+
+	struct mpd_song_tag *const tags = song->tags;
+	char *const strings = song->strings;
+
+	*song = *src;
+	song->tags = tags;
+	song->strings = strings;
+	song->tags_capacity = src->n_tags;
+	song->strings_capacity = src->strings_size;
+	song->heap = false;
+	song->in_arena = arena != NULL;
+
+	memcpy(tags, src->tags, src->n_tags * sizeof(tags[0]));
+	memcpy(strings, src->strings, src->strings_size);
+	return song;
+}
+
+struct mpd_song *
+mpd_song_pack(struct mpd_song *song)
+{
+	assert(song != NULL);
+
+	if (!song->heap)
+		return song;
+
+	struct mpd_song *packed = mpd_song_pack_copy(NULL, song);
+	if (packed == NULL)
+		/* out of memory: keep the unpacked song, which is
+		   still valid */
+		return song;
+
+	mpd_song_free(song);
+	return packed;
+}
 
 struct mpd_song *
 mpd_song_dup(const struct mpd_song *song)
 {
 	struct mpd_song *ret;
-	bool success;
 
 	assert(song != NULL);
 
-	ret = mpd_song_new(song->uri);
+	ret = mpd_song_pack_copy(NULL, song);
 	if (ret == NULL)
 		/* out of memory */
 		return NULL;
 
-	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i) {
-		const struct mpd_tag_value *src_tag = &song->tags[i];
-
-		if (src_tag->value == NULL)
-			continue;
-
-		do {
-			success = mpd_song_add_tag(ret, i, src_tag->value);
-			if (!success) {
-				mpd_song_free(ret);
-				return NULL;
-			}
-
-			src_tag = src_tag->next;
-		} while (src_tag != NULL);
-	}
-
-	ret->duration = song->duration;
-	ret->duration_ms = song->duration_ms;
-	ret->start = song->start;
-	ret->end = song->end;
-	ret->last_modified = song->last_modified;
-	ret->pos = song->pos;
-	ret->id = song->id;
-	ret->prio = song->prio;
-
 #ifndef NDEBUG
 	ret->finished = true;
 #endif
@@ -237,98 +325,170 @@ mpd_song_get_uri(const struct mpd_song *song)
 {
 	assert(song != NULL);
 
-	return song->uri;
+	return song->strings;
 }
 
+/**
+ * Moves the arrays of a song which does not own them to the heap.
+ *
+ * @return false if out of memory
+ */
+static bool
+mpd_song_move_to_heap(struct mpd_song *song,
+		      unsigned tags_capacity, unsigned strings_capacity)
+{
+	assert(!song->heap);
+	assert(tags_capacity > 0);
+	assert(tags_capacity >= song->n_tags);
+	assert(strings_capacity >= song->strings_size);
+
+	struct mpd_song_tag *tags = malloc(tags_capacity * sizeof(tags[0]));
+	char *strings = malloc(strings_capacity);
+	if (tags == NULL || strings == NULL) {
+		free(tags);
+		free(strings);
+		return false;
+	}
+
+	memcpy(tags, song->tags, song->n_tags * sizeof(tags[0]));
+	memcpy(strings, song->strings, song->strings_size);
+
+	song->tags = tags;
+	song->tags_capacity = tags_capacity;
+	song->strings = strings;
+	song->strings_capacity = strings_capacity;
+	song->heap = true;
+	return true;
+}
 
 /**
- * Adds a tag value to the song.
+ * Makes sure there is room for one more entry in mpd_song.tags.
  *
- * @return true on success, false if the tag is not supported or if no
- * memory could be allocated
+ * @return false if out of memory
  */
 static bool
-mpd_song_add_tag(struct mpd_song *song,
-		 enum mpd_tag_type type, const char *value)
+mpd_song_reserve_tag(struct mpd_song *song)
 {
-	struct mpd_tag_value *tag = &song->tags[type], *prev;
+	if (song->n_tags < song->tags_capacity)
+		return true;
 
-	if ((int)type < 0 || type >= MPD_TAG_COUNT)
-		return false;
+	const unsigned capacity = song->tags_capacity < 8
+		? 16
+		: song->tags_capacity * 2;
 
-	if (tag->value == NULL) {
-		tag->next = NULL;
-		tag->value = strdup(value);
-		if (tag->value == NULL)
-			return false;
-	} else {
-		while (tag->next != NULL)
-			tag = tag->next;
-
-		prev = tag;
-		tag = malloc(sizeof(*tag));
-		if (tag == NULL)
-			return NULL;
-
-		tag->value = strdup(value);
-		if (tag->value == NULL) {
-			free(tag);
-			return false;
-		}
+	if (!song->heap)
+		return mpd_song_move_to_heap(song, capacity,
+					     song->strings_capacity);
 
-		tag->next = NULL;
-		prev->next = tag;
-	}
+	struct mpd_song_tag *tags =
+		realloc(song->tags, capacity * sizeof(tags[0]));
+	if (tags == NULL)
+		return false;
 
+	song->tags = tags;
+	song->tags_capacity = capacity;
 	return true;
 }
 
-#ifdef UNUSED_CODE
 /**
- * Removes all values of the specified tag.
+ * Appends a string to mpd_song.strings.
+ *
+ * @return the offset of the copy, or -1 if out of memory
  */
-static void
-mpd_song_clear_tag(struct mpd_song *song, enum mpd_tag_type type)
+static long
+mpd_song_append_string(struct mpd_song *song, const char *value)
 {
-	struct mpd_tag_value *tag = &song->tags[type];
+	const size_t size = strlen(value) + 1;
+
+	if (size > song->strings_capacity - song->strings_size) {
+		if (size > UINT_MAX / 4 - song->strings_size)
+			return -1;
+
+		unsigned capacity = song->strings_capacity < 256
+			? 512
+			: song->strings_capacity;
+		while (capacity - song->strings_size < size)
+			capacity *= 2;
+
+		if (!song->heap) {
+			if (!mpd_song_move_to_heap(song,
+						   song->tags_capacity > 0
+						   ? song->tags_capacity
+						   : 16,
+						   capacity))
+				return -1;
+		} else {
+			char *strings = realloc(song->strings, capacity);
+			if (strings == NULL)
+				return -1;
+
+			song->strings = strings;
+			song->strings_capacity = capacity;
+		}
+	}
+
+	const unsigned offset = song->strings_size;
+	memcpy(song->strings + offset, value, size);
+	song->strings_size += size;
+	return offset;
+}
 
+/**
+ * Adds a tag value to the song.
+ *
+ * @return true on success, false if the tag is not supported or if no
+ * memory could be allocated
+ */
+static bool
+mpd_song_add_tag(struct mpd_song *song,
+		 enum mpd_tag_type type, const char *value)
+{
 	if ((unsigned)type >= MPD_TAG_COUNT)
-		return;
+		return false;
 
-	if (tag->value == NULL)
-		/* this tag type is empty */
-		return;
+	if (!mpd_song_reserve_tag(song))
+		return false;
 
-	/* free and clear the first value */
-	free(tag->value);
-	tag->value = NULL;
+	const long offset = mpd_song_append_string(song, value);
+	if (offset < 0)
+		return false;
 
-	/* free all other values; no need to clear the "next" pointer,
-	   because it is "undefined" as long as value==NULL */
-	while ((tag = tag->next) != NULL)
-		free(tag->value);
+	/* insert after all values of the same type to keep the
+	   index sorted; MPD sends tags mostly in order, so this
+	   rarely moves anything */
+	unsigned i = song->n_tags;
+	while (i > 0 && song->tags[i - 1].type > type)
+		--i;
+
+	memmove(&song->tags[i + 1], &song->tags[i],
+		(song->n_tags - i) * sizeof(song->tags[0]));
+	song->tags[i].type = type;
+	song->tags[i].offset = offset;
+	++song->n_tags;
+	return true;
 }
-#endif
 
 const char *
 mpd_song_get_tag(const struct mpd_song *song,
 		 enum mpd_tag_type type, unsigned idx)
 {
-	const struct mpd_tag_value *tag = &song->tags[type];
-
-	if ((int)type < 0)
-		return NULL;
-
-	if (tag->value == NULL)
+	if ((unsigned)type >= MPD_TAG_COUNT)
 		return NULL;
 
-	while (idx-- > 0) {
-		tag = tag->next;
-		if (tag == NULL)
-			return NULL;
+	/* binary search for the first value of this type */
+	unsigned lo = 0, hi = song->n_tags;
+	while (lo < hi) {
+		const unsigned mid = (lo + hi) / 2;
+		if (song->tags[mid].type < type)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
 
-	return tag->value;
+	if (idx >= song->n_tags - lo || song->tags[lo + idx].type != type)
+		return NULL;
+
+	return song->strings + song->tags[lo + idx].offset;
 }
 
 static void
@@ -454,7 +614,8 @@ mpd_song_begin(const struct mpd_pair *pair)
 	assert(pair->name != NULL);
 	assert(pair->value != NULL);
 
-	if (strcmp(pair->name, "file") != 0 || !mpd_verify_uri(pair->value)) {
+	if (mpd_pair_name_parse(pair->name) != MPD_PAIR_NAME_FILE ||
+	    !mpd_verify_uri(pair->value)) {
 		errno = EINVAL;
 		return NULL;
 	}
@@ -468,24 +629,24 @@ mpd_song_parse_range(struct mpd_song *song, const char *value)
 	assert(song != NULL);
 	assert(value != NULL);
 
-	char *endptr;
-	double start, end;
+	const char *endptr;
+	unsigned start_ms, end_ms;
 
 	if (*value == '-') {
-		start = 0.0;
-		end = strtod(value + 1, NULL);
+		start_ms = 0;
+		end_ms = mpd_decimal_parse_ms(value + 1, NULL);
 	} else {
-		start = strtod(value, &endptr);
+		start_ms = mpd_decimal_parse_ms(value, &endptr);
 		if (*endptr != '-')
 			return;
 
-		end = strtod(endptr + 1, NULL);
+		end_ms = mpd_decimal_parse_ms(endptr + 1, NULL);
 	}
 
-	song->start = start > 0.0 ? (unsigned)start : 0;
+	song->start = start_ms / 1000;
 
-	if (end > 0.0) {
-		song->end = (unsigned)end;
+	if (end_ms > 0) {
+		song->end = end_ms / 1000;
 		if (song->end == 0)
 			/* round up, because the caller must sees that
 			   there's an upper limit */
@@ -503,81 +664,295 @@ mpd_song_parse_audio_format(struct mpd_song *song, const char *value)
 	mpd_parse_audio_format(&song->audio_format, value);
 }
 
+/**
+ * Parses a song attribute which is not a tag.  Unknown attributes
+ * are ignored.
+ */
+static void
+mpd_song_feed_attribute(struct mpd_song *song, enum mpd_pair_name name,
+			const char *value)
+{
+	switch (name) {
+	case MPD_PAIR_NAME_SONG_TIME:
+		mpd_song_set_duration(song,
+				      mpd_decimal_parse_unsigned(value, NULL));
+		break;
+
+	case MPD_PAIR_NAME_DURATION:
+		mpd_song_set_duration_ms(song, mpd_decimal_parse_ms(value, NULL));
+		break;
+
+	case MPD_PAIR_NAME_RANGE:
+		mpd_song_parse_range(song, value);
+		break;
+
+	case MPD_PAIR_NAME_LAST_MODIFIED:
+		mpd_song_set_last_modified(song, iso8601_datetime_parse(value));
+		break;
+
+	case MPD_PAIR_NAME_POS:
+		mpd_song_set_pos(song, mpd_decimal_parse_unsigned(value, NULL));
+		break;
+
+	case MPD_PAIR_NAME_ID:
+		mpd_song_set_id(song, mpd_decimal_parse_unsigned(value, NULL));
+		break;
+
+	case MPD_PAIR_NAME_PRIO:
+		mpd_song_set_prio(song, mpd_decimal_parse_unsigned(value, NULL));
+		break;
+
+	case MPD_PAIR_NAME_FORMAT:
+		mpd_song_parse_audio_format(song, value);
+		break;
+
+	default:
+		break;
+	}
+}
+
+/**
+ * Parses a pair whose name was already looked up, and which is not
+ * the beginning of the next song.
+ */
+static void
+mpd_song_feed_value(struct mpd_song *song, enum mpd_pair_name name,
+		    const char *value)
+{
+	if (*value == 0)
+		return;
+
+	if (mpd_pair_name_is_tag(name))
+		mpd_song_add_tag(song, (enum mpd_tag_type)name, value);
+	else
+		mpd_song_feed_attribute(song, name, value);
+}
+
 bool
 mpd_song_feed(struct mpd_song *song, const struct mpd_pair *pair)
 {
-	enum mpd_tag_type tag_type;
-
 	assert(song != NULL);
 	assert(!song->finished);
 	assert(pair != NULL);
 	assert(pair->name != NULL);
 	assert(pair->value != NULL);
 
-	if (strcmp(pair->name, "file") == 0) {
+	const enum mpd_pair_name name = mpd_pair_name_parse(pair->name);
+	if (name == MPD_PAIR_NAME_FILE) {
 #ifndef NDEBUG
 		song->finished = true;
 #endif
 		return false;
 	}
 
-	if (*pair->value == 0)
-		return true;
+	mpd_song_feed_value(song, name, pair->value);
+	return true;
+}
 
-	tag_type = mpd_tag_name_parse(pair->name);
-	if (tag_type != MPD_TAG_UNKNOWN) {
-		mpd_song_add_tag(song, tag_type, pair->value);
-		return true;
+enum {
+	/**
+	 * The number of tag values a #mpd_song_builder can hold
+	 * without a heap allocation.
+	 */
+	MPD_SONG_BUILDER_TAGS = 32,
+
+	/**
+	 * The number of string bytes a #mpd_song_builder can hold
+	 * without a heap allocation.
+	 */
+	MPD_SONG_BUILDER_STRINGS = 2048,
+};
+
+/**
+ * Storage for receiving songs.  The song is built in arrays embedded
+ * in this struct (which usually lives on the stack), and only very
+ * large songs need heap allocations.  These are kept for the next
+ * song.
+ */
+struct mpd_song_builder {
+	struct mpd_song song;
+
+	struct mpd_song_tag tags[MPD_SONG_BUILDER_TAGS];
+
+	char strings[MPD_SONG_BUILDER_STRINGS];
+};
+
+static void
+mpd_song_builder_init(struct mpd_song_builder *builder)
+{
+	builder->song.tags = builder->tags;
+	builder->song.tags_capacity = MPD_SONG_BUILDER_TAGS;
+	builder->song.strings = builder->strings;
+	builder->song.strings_capacity = MPD_SONG_BUILDER_STRINGS;
+	builder->song.heap = false;
+	builder->song.in_arena = false;
+}
+
+static void
+mpd_song_builder_deinit(struct mpd_song_builder *builder)
+{
+	if (builder->song.heap) {
+		free(builder->song.tags);
+		free(builder->song.strings);
 	}
+}
 
-	if (strcmp(pair->name, "Time") == 0)
-		mpd_song_set_duration(song, atoi(pair->value));
-	else if (strcmp(pair->name, "duration") == 0)
-		mpd_song_set_duration_ms(song, 1000 * atof(pair->value));
-	else if (strcmp(pair->name, "Range") == 0)
-		mpd_song_parse_range(song, pair->value);
-	else if (strcmp(pair->name, "Last-Modified") == 0)
-		mpd_song_set_last_modified(song, iso8601_datetime_parse(pair->value));
-	else if (strcmp(pair->name, "Pos") == 0)
-		mpd_song_set_pos(song, atoi(pair->value));
-	else if (strcmp(pair->name, "Id") == 0)
-		mpd_song_set_id(song, atoi(pair->value));
-	else if (strcmp(pair->name, "Prio") == 0)
-		mpd_song_set_prio(song, atoi(pair->value));
-	else if (strcmp(pair->name, "Format") == 0)
-		mpd_song_parse_audio_format(song, pair->value);
+/**
+ * Discards the previous song, and begins building a new one.
+ *
+ * @return false if out of memory
+ */
+static bool
+mpd_song_builder_begin(struct mpd_song_builder *builder, const char *uri)
+{
+	assert(mpd_verify_uri(uri));
 
-	return true;
+	struct mpd_song *song = &builder->song;
+	song->n_tags = 0;
+	song->strings_size = 0;
+	mpd_song_init(song);
+
+	/* the URI is always at offset 0 */
+	return mpd_song_append_string(song, uri) == 0;
 }
 
-struct mpd_song *
-mpd_recv_song(struct mpd_connection *connection)
+/**
+ * Receives the next song and copies it into one allocation of the
+ * exact size.
+ *
+ * @param arena the arena to allocate the song in, or NULL to
+ * allocate it on the heap
+ */
+static struct mpd_song *
+mpd_recv_song_to(struct mpd_connection *connection, struct mpd_arena *arena)
 {
 	struct mpd_pair *pair;
+	struct mpd_song_builder builder;
 	struct mpd_song *song;
 
 	pair = mpd_recv_pair_named(connection, "file");
 	if (pair == NULL)
 		return NULL;
 
-	song = mpd_song_begin(pair);
-	mpd_return_pair(connection, pair);
-	if (song == NULL) {
+	if (!mpd_verify_uri(pair->value)) {
+		mpd_return_pair(connection, pair);
+		errno = EINVAL;
 		mpd_error_entity(&connection->error);
 		return NULL;
 	}
 
+	mpd_song_builder_init(&builder);
+	const bool success = mpd_song_builder_begin(&builder, pair->value);
+	mpd_return_pair(connection, pair);
+	if (!success) {
+		mpd_song_builder_deinit(&builder);
+		mpd_error_code(&connection->error, MPD_ERROR_OOM);
+		return NULL;
+	}
+
 	while ((pair = mpd_recv_pair(connection)) != NULL &&
-	       mpd_song_feed(song, pair))
+	       mpd_song_feed(&builder.song, pair))
 		mpd_return_pair(connection, pair);
 
 	if (mpd_error_is_defined(&connection->error)) {
-		mpd_song_free(song);
+		mpd_song_builder_deinit(&builder);
 		return NULL;
 	}
 
 	/* unread this pair for the next mpd_recv_song() call */
 	mpd_enqueue_pair(connection, pair);
 
+	song = mpd_song_pack_copy(arena, &builder.song);
+	mpd_song_builder_deinit(&builder);
+	if (song == NULL)
+		mpd_error_code(&connection->error, MPD_ERROR_OOM);
+
 	return song;
 }
+
+struct mpd_song *
+mpd_recv_song(struct mpd_connection *connection)
+{
+	return mpd_recv_song_to(connection, NULL);
+}
+
+struct mpd_song *
+mpd_recv_song_arena(struct mpd_connection *connection,
+		    struct mpd_arena *arena)
+{
+	assert(arena != NULL);
+
+	return mpd_recv_song_to(connection, arena);
+}
+
+enum {
+	/**
+	 * The number of pairs mpd_recv_songs_cb() receives at a time.
+	 */
+	MPD_RECV_SONGS_PAIRS = 64,
+};
+
+bool
+mpd_recv_songs_cb(struct mpd_connection *connection,
+		  mpd_song_cb callback, void *ctx)
+{
+	struct mpd_pair pairs[MPD_RECV_SONGS_PAIRS];
+	struct mpd_song_builder builder;
+	bool pending = false, stopped = false;
+	unsigned n;
+
+	assert(connection != NULL);
+	assert(callback != NULL);
+
+	mpd_song_builder_init(&builder);
+
+	while (!stopped &&
+	       (n = mpd_recv_pairs(connection, pairs,
+				   MPD_RECV_SONGS_PAIRS)) > 0) {
+		for (unsigned i = 0; i < n; ++i) {
+			const struct mpd_pair *pair = &pairs[i];
+			const enum mpd_pair_name name =
+				mpd_pair_name_parse(pair->name);
+
+			if (name != MPD_PAIR_NAME_FILE) {
+				/* everything before the first song is
+				   ignored, like mpd_recv_song() does */
+				if (pending)
+					mpd_song_feed_value(&builder.song,
+							    name, pair->value);
+				continue;
+			}
+
+			if (pending && !callback(&builder.song, ctx)) {
+				pending = false;
+				stopped = true;
+				break;
+			}
+
+			pending = false;
+
+			if (!mpd_verify_uri(pair->value)) {
+				errno = EINVAL;
+				mpd_error_entity(&connection->error);
+				stopped = true;
+				break;
+			}
+
+			if (!mpd_song_builder_begin(&builder, pair->value)) {
+				mpd_error_code(&connection->error,
+					       MPD_ERROR_OOM);
+				stopped = true;
+				break;
+			}
+
+			pending = true;
+		}
+	}
+
+	if (pending && !mpd_error_is_defined(&connection->error))
+		callback(&builder.song, ctx);
+
+	mpd_song_builder_deinit(&builder);
+
+	return !mpd_error_is_defined(&connection->error);
+}
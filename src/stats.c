@@ -32,6 +32,8 @@
 
 #include <mpd/stats.h>
 #include <mpd/pair.h>
+#include "decimal.h"
+#include "pair_name.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -68,20 +70,45 @@ mpd_stats_begin(void)
 void
 mpd_stats_feed(struct mpd_stats *stats, const struct mpd_pair *pair)
 {
-	if (strcmp(pair->name, "artists") == 0)
-		stats->number_of_artists = atoi(pair->value);
-	else if (strcmp(pair->name, "albums") == 0)
-		stats->number_of_albums = atoi(pair->value);
-	else if (strcmp(pair->name, "songs") == 0)
-		stats->number_of_songs = atoi(pair->value);
-	else if (strcmp(pair->name, "uptime") == 0)
-		stats->uptime = strtoul(pair->value,NULL,10);
-	else if (strcmp(pair->name, "db_update") == 0)
-		stats->db_update_time = strtoul(pair->value,NULL,10);
-	else if (strcmp(pair->name, "playtime") == 0)
-		stats->play_time = strtoul(pair->value,NULL,10);
-	else if (strcmp(pair->name, "db_playtime") == 0)
-		stats->db_play_time = strtoul(pair->value,NULL,10);
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_ARTISTS:
+		stats->number_of_artists =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_ALBUMS:
+		stats->number_of_albums =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_SONGS:
+		stats->number_of_songs =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_UPTIME:
+		stats->uptime =
+			mpd_decimal_parse_ulong(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_DB_UPDATE:
+		stats->db_update_time =
+			mpd_decimal_parse_ulong(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_PLAYTIME:
+		stats->play_time =
+			mpd_decimal_parse_ulong(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_DB_PLAYTIME:
+		stats->db_play_time =
+			mpd_decimal_parse_ulong(pair->value, NULL);
+		break;
+
+	default:
+		break;
+	}
 }
 
 void mpd_stats_free(struct mpd_stats * stats) {
@@ -34,6 +34,8 @@
 #include <mpd/pair.h>
 #include <mpd/audio_format.h>
 #include "iaf.h"
+#include "decimal.h"
+#include "pair_name.h"
 
 #include <assert.h>
 #include <stdlib.h>
@@ -160,31 +162,6 @@ mpd_status_begin(void)
 	return status;
 }
 
-/**
- * Parses the fractional part of the "elapsed" response line.  Up to
- * three digits are parsed.
- */
-static unsigned
-parse_ms(const char *p)
-{
-	unsigned ms;
-
-	if (*p >= '0' && *p <= '9')
-		ms = 100 * (*p++ - '0');
-	else
-		return 0;
-
-	if (*p >= '0' && *p <= '9')
-		ms += 10 * (*p - '0');
-	else
-		return ms;
-
-	if (*p >= '0' && *p <= '9')
-		ms += *p - '0';
-
-	return ms;
-}
-
 static enum mpd_state
 parse_mpd_state(const char *p)
 {
@@ -217,66 +194,119 @@ mpd_status_feed(struct mpd_status *status, const struct mpd_pair *pair)
 	assert(status != NULL);
 	assert(pair != NULL);
 
-	if (strcmp(pair->name, "volume") == 0)
-		status->volume = atoi(pair->value);
-	else if (strcmp(pair->name, "repeat") == 0)
-		status->repeat = !!atoi(pair->value);
-	else if (strcmp(pair->name, "random") == 0)
-		status->random = !!atoi(pair->value);
-	else if (strcmp(pair->name, "single") == 0)
+	const char *endptr;
+
+	switch (mpd_pair_name_parse(pair->name)) {
+	case MPD_PAIR_NAME_VOLUME:
+		status->volume = mpd_decimal_parse_int(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_REPEAT:
+		status->repeat = mpd_decimal_parse_int(pair->value, NULL) != 0;
+		break;
+
+	case MPD_PAIR_NAME_RANDOM:
+		status->random = mpd_decimal_parse_int(pair->value, NULL) != 0;
+		break;
+
+	case MPD_PAIR_NAME_SINGLE:
 		status->single = parse_mpd_single_state(pair->value);
-	else if (strcmp(pair->name, "consume") == 0)
-		status->consume = !!atoi(pair->value);
-	else if (strcmp(pair->name, "playlist") == 0)
-		status->queue_version = strtoul(pair->value, NULL, 10);
-	else if (strcmp(pair->name, "playlistlength") == 0)
-		status->queue_length = atoi(pair->value);
-	else if (strcmp(pair->name, "bitrate") == 0)
-		status->kbit_rate = atoi(pair->value);
-	else if (strcmp(pair->name, "state") == 0)
+		break;
+
+	case MPD_PAIR_NAME_CONSUME:
+		status->consume = mpd_decimal_parse_int(pair->value, NULL) != 0;
+		break;
+
+	case MPD_PAIR_NAME_PLAYLIST:
+		status->queue_version =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_PLAYLISTLENGTH:
+		status->queue_length =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_BITRATE:
+		status->kbit_rate =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_STATE:
 		status->state = parse_mpd_state(pair->value);
-	else if (strcmp(pair->name, "song") == 0)
-		status->song_pos = atoi(pair->value);
-	else if (strcmp(pair->name, "songid") == 0)
-		status->song_id = atoi(pair->value);
-	else if (strcmp(pair->name, "nextsong") == 0)
-		status->next_song_pos = atoi(pair->value);
-	else if (strcmp(pair->name, "nextsongid") == 0)
-		status->next_song_id = atoi(pair->value);
-	else if (strcmp(pair->name, "time") == 0) {
-		char *endptr;
-
-		status->elapsed_time = strtoul(pair->value, &endptr, 10);
+		break;
+
+	case MPD_PAIR_NAME_SONG:
+		status->song_pos = mpd_decimal_parse_int(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_SONGID:
+		status->song_id = mpd_decimal_parse_int(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_NEXTSONG:
+		status->next_song_pos =
+			mpd_decimal_parse_int(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_NEXTSONGID:
+		status->next_song_id =
+			mpd_decimal_parse_int(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_TIME:
+		status->elapsed_time =
+			mpd_decimal_parse_unsigned(pair->value, &endptr);
 		if (*endptr == ':')
-			status->total_time = strtoul(endptr + 1, NULL, 10);
+			status->total_time =
+				mpd_decimal_parse_unsigned(endptr + 1, NULL);
 
 		if (status->elapsed_ms == 0)
 			status->elapsed_ms = status->elapsed_time * 1000;
-	} else if (strcmp(pair->name, "elapsed") == 0) {
-		char *endptr;
+		break;
 
-		status->elapsed_ms = strtoul(pair->value, &endptr, 10) * 1000;
-		if (*endptr == '.')
-			status->elapsed_ms += parse_ms(endptr + 1);
+	case MPD_PAIR_NAME_ELAPSED:
+		status->elapsed_ms = mpd_decimal_parse_ms(pair->value, NULL);
 
 		if (status->elapsed_time == 0)
 			status->elapsed_time = status->elapsed_ms / 1000;
-	} else if (strcmp(pair->name, "partition") == 0) {
+		break;
+
+	case MPD_PAIR_NAME_PARTITION:
 		free(status->partition);
 		status->partition = strdup(pair->value);
-	} else if (strcmp(pair->name, "error") == 0) {
+		break;
+
+	case MPD_PAIR_NAME_ERROR:
 		free(status->error);
 		status->error = strdup(pair->value);
-	} else if (strcmp(pair->name, "xfade") == 0)
-		status->crossfade = atoi(pair->value);
-	else if (strcmp(pair->name, "mixrampdb") == 0)
-		status->mixrampdb = atof(pair->value);
-	else if (strcmp(pair->name, "mixrampdelay") == 0)
-		status->mixrampdelay = atof(pair->value);
-	else if (strcmp(pair->name, "updating_db") == 0)
-		status->update_id = atoi(pair->value);
-	else if (strcmp(pair->name, "audio") == 0)
+		break;
+
+	case MPD_PAIR_NAME_XFADE:
+		status->crossfade =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_MIXRAMPDB:
+		status->mixrampdb = mpd_decimal_parse_double(pair->value);
+		break;
+
+	case MPD_PAIR_NAME_MIXRAMPDELAY:
+		status->mixrampdelay = mpd_decimal_parse_double(pair->value);
+		break;
+
+	case MPD_PAIR_NAME_UPDATING_DB:
+		status->update_id =
+			mpd_decimal_parse_unsigned(pair->value, NULL);
+		break;
+
+	case MPD_PAIR_NAME_AUDIO:
 		mpd_parse_audio_format(&status->audio_format, pair->value);
+		break;
+
+	default:
+		break;
+	}
 }
 
 void mpd_status_free(struct mpd_status * status)
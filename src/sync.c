@@ -28,125 +28,155 @@
 
 #include "sync.h"
 #include "socket.h"
+#include "iasync.h"
+#include "clock.h"
 
 #include <mpd/async.h>
 
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
-#ifndef _WIN32
-#include <sys/select.h>
-#endif
 #include <fcntl.h>
 
+#ifdef _WIN32
+#  include <winsock2.h>
+#else
+#  include <sys/time.h>
+#endif
+
 static enum mpd_async_event
-mpd_sync_poll(struct mpd_async *async, struct timeval *tv)
+mpd_sync_poll(struct mpd_async *async, long long deadline_ms)
 {
-	unsigned fd;
-	fd_set rfds, wfds, efds;
-	int ret;
-	enum mpd_async_event events;
+	enum mpd_async_event events = mpd_async_events(async);
+	if (events == 0)
+		return 0;
+
+	if (deadline_ms < 0)
+		return mpd_socket_poll(mpd_async_get_fd(async), events, NULL);
+
+	/* don't poll with a zero timeout after the deadline has
+	   expired: a peer which keeps sending could otherwise
+	   extend the operation forever */
+	const long long remaining_ms = deadline_ms - mpd_clock_now_ms();
+	if (remaining_ms <= 0)
+		return 0;
+
+	struct timeval tv = {
+		.tv_sec = remaining_ms / 1000,
+		.tv_usec = (remaining_ms % 1000) * 1000,
+	};
+
+	return mpd_socket_poll(mpd_async_get_fd(async), events, &tv);
+}
 
-	fd = mpd_async_get_fd(async);
+bool
+mpd_sync_io(struct mpd_async *async, long long deadline_ms)
+{
+	enum mpd_async_event events = mpd_sync_poll(async, deadline_ms);
 
-	while (1) {
-		events = mpd_async_events(async);
-		if (events == 0)
-			return 0;
+	if (events)
+		return mpd_async_io(async, events);
+	else
+		return false;
+}
 
-		FD_ZERO(&rfds);
-		FD_ZERO(&wfds);
-		FD_ZERO(&efds);
-
-		if (events & MPD_ASYNC_EVENT_READ)
-			FD_SET(fd, &rfds);
-		if (events & MPD_ASYNC_EVENT_WRITE)
-			FD_SET(fd, &wfds);
-		if (events & (MPD_ASYNC_EVENT_HUP|MPD_ASYNC_EVENT_ERROR))
-			FD_SET(fd, &efds);
-
-		ret = select(fd + 1, &rfds, &wfds, &efds, tv);
-		if (ret > 0) {
-			if (!FD_ISSET(fd, &rfds))
-				events &= ~MPD_ASYNC_EVENT_READ;
-			if (!FD_ISSET(fd, &wfds))
-				events &= ~MPD_ASYNC_EVENT_WRITE;
-			if (!FD_ISSET(fd, &efds))
-				events &= ~(MPD_ASYNC_EVENT_HUP|
-					    MPD_ASYNC_EVENT_ERROR);
-
-			return events;
-		}
+/**
+ * Appends raw data to the output buffer, flushing it whenever it
+ * becomes full.
+ */
+static bool
+mpd_sync_write_raw(struct mpd_async *async, long long deadline_ms,
+		   const char *data, size_t length)
+{
+	while (true) {
+		size_t nbytes = mpd_async_append_raw(async, data, length);
+		data += nbytes;
+		length -= nbytes;
 
-		if (ret == 0 || !mpd_socket_ignore_errno(mpd_socket_errno()))
-			return 0;
+		if (length == 0)
+			return true;
+
+		if (!mpd_sync_io(async, deadline_ms))
+			return false;
 	}
 }
 
+/**
+ * Appends a quoted argument (including the leading space) to the
+ * output buffer, flushing it whenever it becomes full.
+ */
 static bool
-mpd_sync_io(struct mpd_async *async, struct timeval *tv)
+mpd_sync_write_arg(struct mpd_async *async, long long deadline_ms,
+		   const char *arg)
 {
-	enum mpd_async_event events = mpd_sync_poll(async, tv);
-
-	if (events)
-		return mpd_async_io(async, events);
-	else
+	if (!mpd_sync_write_raw(async, deadline_ms, " \"", 2))
 		return false;
+
+	while (true) {
+		arg += mpd_async_append_escaped(async, arg);
+		if (*arg == 0)
+			break;
+
+		if (!mpd_sync_io(async, deadline_ms))
+			return false;
+	}
+
+	return mpd_sync_write_raw(async, deadline_ms, "\"", 1);
 }
 
 bool
-mpd_sync_send_command_v(struct mpd_async *async, const struct timeval *tv0,
+mpd_sync_send_command_v(struct mpd_async *async, long long deadline_ms,
 			const char *command, va_list args)
 {
-	struct timeval tv, *tvp;
-	va_list copy;
-	bool success;
+	const char *arg;
 
-	if (tv0 != NULL) {
-		tv = *tv0;
-		tvp = &tv;
-	} else
-		tvp = NULL;
+	/* stream the command into the output buffer instead of
+	   formatting it in one piece with mpd_async_send_command_v(),
+	   so it may be larger than the buffer */
 
-	while (true) {
-		va_copy(copy, args);
-		success = mpd_async_send_command_v(async, command, copy);
-		va_end(copy);
+	if (!mpd_sync_write_raw(async, deadline_ms, command, strlen(command)))
+		return false;
 
-		if (success)
-			return true;
+	while ((arg = va_arg(args, const char *)) != NULL)
+		if (!mpd_sync_write_arg(async, deadline_ms, arg))
+			return false;
+
+	return mpd_sync_write_raw(async, deadline_ms, "\n", 1);
+}
+
+bool
+mpd_sync_send_command_argv(struct mpd_async *async, long long deadline_ms,
+			   const char *command, const char *const *argv)
+{
+	if (!mpd_sync_write_raw(async, deadline_ms, command, strlen(command)))
+		return false;
 
-		if (!mpd_sync_io(async, tvp))
+	for (; *argv != NULL; ++argv)
+		if (!mpd_sync_write_arg(async, deadline_ms, *argv))
 			return false;
-	}
+
+	return mpd_sync_write_raw(async, deadline_ms, "\n", 1);
 }
 
 bool
-mpd_sync_send_command(struct mpd_async *async, const struct timeval *tv,
+mpd_sync_send_command(struct mpd_async *async, long long deadline_ms,
 		      const char *command, ...)
 {
 	va_list args;
 	bool success;
 
 	va_start(args, command);
-	success = mpd_sync_send_command_v(async, tv, command, args);
+	success = mpd_sync_send_command_v(async, deadline_ms, command, args);
 	va_end(args);
 
 	return success;
 }
 
 bool
-mpd_sync_flush(struct mpd_async *async, const struct timeval *tv0)
+mpd_sync_flush(struct mpd_async *async, long long deadline_ms)
 {
-	struct timeval tv, *tvp;
-
-	if (tv0 != NULL) {
-		tv = *tv0;
-		tvp = &tv;
-	} else
-		tvp = NULL;
-
 	if (!mpd_async_io(async, MPD_ASYNC_EVENT_WRITE))
 		return false;
 
@@ -156,51 +186,79 @@ mpd_sync_flush(struct mpd_async *async, const struct timeval *tv0)
 			/* no more pending writes */
 			return true;
 
-		if (!mpd_sync_io(async, tvp))
+		if (!mpd_sync_io(async, deadline_ms))
 			return false;
 	}
 }
 
 char *
-mpd_sync_recv_line(struct mpd_async *async, const struct timeval *tv0)
+mpd_sync_recv_line(struct mpd_async *async, long long deadline_ms)
 {
-	struct timeval tv, *tvp;
 	char *line;
 
-	if (tv0 != NULL) {
-		tv = *tv0;
-		tvp = &tv;
-	} else
-		tvp = NULL;
-
 	while (true) {
 		line = mpd_async_recv_line(async);
 		if (line != NULL)
 			return line;
 
-		if (!mpd_sync_io(async, tvp))
+		if (!mpd_sync_io(async, deadline_ms))
 			return NULL;
 	}
 }
 
+/**
+ * Waits until the socket becomes readable, and handles all other
+ * events.  Reading is left to the caller, which bypasses the input
+ * buffer.
+ */
+static bool
+mpd_sync_wait_readable(struct mpd_async *async, long long deadline_ms)
+{
+	enum mpd_async_event events = mpd_sync_poll(async, deadline_ms);
+	if (events == 0)
+		return false;
+
+	events &= ~MPD_ASYNC_EVENT_READ;
+	return events == 0 || mpd_async_io(async, events);
+}
+
 size_t
-mpd_sync_recv_raw(struct mpd_async *async, const struct timeval *tv0,
+mpd_sync_recv_raw(struct mpd_async *async, long long deadline_ms,
 		  void *dest, size_t length)
 {
-	struct timeval tv, *tvp;
+	if (length < MPD_SYNC_DIRECT_THRESHOLD) {
+		/* small reads go through the input buffer, which may
+		   receive more data with the same system call */
+		while (true) {
+			size_t nbytes = mpd_async_recv_raw(async, dest, length);
+			if (nbytes > 0)
+				return nbytes;
+
+			if (!mpd_sync_io(async, deadline_ms))
+				return 0;
+		}
+	}
 
-	if (tv0 != NULL) {
-		tv = *tv0;
-		tvp = &tv;
-	} else
-		tvp = NULL;
+	while (true) {
+		size_t nbytes = mpd_async_recv_direct(async, dest, length);
+		if (nbytes > 0)
+			return nbytes;
 
+		if (!mpd_sync_wait_readable(async, deadline_ms))
+			return 0;
+	}
+}
+
+size_t
+mpd_sync_recv_to_fd(struct mpd_async *async, long long deadline_ms,
+		    int fd, size_t length)
+{
 	while (true) {
-		size_t nbytes = mpd_async_recv_raw(async, dest, length);
+		size_t nbytes = mpd_async_recv_to_fd(async, fd, length);
 		if (nbytes > 0)
 			return nbytes;
 
-		if (!mpd_sync_io(async, tvp))
+		if (!mpd_sync_wait_readable(async, deadline_ms))
 			return 0;
 	}
 }
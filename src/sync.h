@@ -30,7 +30,10 @@
  * \brief Synchronous MPD connections
  *
  * This library provides synchronous access to a mpd_async object.
- * For all operations, you may provide a timeout.
+ * For all operations, you may provide a deadline: an absolute point
+ * in time on the monotonic clock (see mpd_clock_now_ms()) in
+ * milliseconds, or -1 to wait forever.  An operation which has not
+ * completed by then fails, no matter how many I/O steps it needed.
  */
 
 #ifndef MPD_SYNC_H
@@ -42,14 +45,25 @@
 #include <stdarg.h>
 #include <stddef.h>
 
-struct timeval;
 struct mpd_async;
 
 /**
- * Synchronous wrapper for mpd_async_send_command_v().
+ * Waits for the events requested by the #mpd_async object, and
+ * handles them, i.e. sends pending output and receives more input.
+ *
+ * @return false on error or timeout
+ */
+bool
+mpd_sync_io(struct mpd_async *async, long long deadline_ms);
+
+/**
+ * Synchronous wrapper for mpd_async_send_command_v().  Unlike the
+ * asynchronous version, the command is streamed into the output
+ * buffer, flushing it as often as necessary, so it may be larger
+ * than the buffer.
  */
 bool
-mpd_sync_send_command_v(struct mpd_async *async, const struct timeval *tv,
+mpd_sync_send_command_v(struct mpd_async *async, long long deadline_ms,
 			const char *command, va_list args);
 
 /**
@@ -57,30 +71,58 @@ mpd_sync_send_command_v(struct mpd_async *async, const struct timeval *tv,
  */
 mpd_sentinel
 bool
-mpd_sync_send_command(struct mpd_async *async, const struct timeval *tv,
+mpd_sync_send_command(struct mpd_async *async, long long deadline_ms,
 		      const char *command, ...);
 
+/**
+ * Like mpd_sync_send_command_v(), but the arguments are passed as a
+ * NULL-terminated array.
+ */
+bool
+mpd_sync_send_command_argv(struct mpd_async *async, long long deadline_ms,
+			   const char *command, const char *const *argv);
+
 /**
  * Sends all pending data from the output buffer to MPD.
  */
 bool
-mpd_sync_flush(struct mpd_async *async, const struct timeval *tv);
+mpd_sync_flush(struct mpd_async *async, long long deadline_ms);
 
 /**
  * Synchronous wrapper for mpd_async_recv_line().
  */
 char *
-mpd_sync_recv_line(struct mpd_async *async, const struct timeval *tv);
+mpd_sync_recv_line(struct mpd_async *async, long long deadline_ms);
+
+/**
+ * Reads of at least this many bytes bypass the input buffer, see
+ * mpd_sync_recv_raw().
+ */
+enum {
+	MPD_SYNC_DIRECT_THRESHOLD = 4096,
+};
 
 /**
  * Synchronous wrapper for mpd_async_recv_raw() which waits until at
- * least one byte was received (or an error has occurred).
+ * least one byte was received (or an error has occurred).  Once the
+ * input buffer is empty, large reads are received directly into the
+ * destination buffer.
  *
  * @return the number of bytes copied to the destination buffer or 0
  * on error
  */
 size_t
-mpd_sync_recv_raw(struct mpd_async *async, const struct timeval *tv,
+mpd_sync_recv_raw(struct mpd_async *async, long long deadline_ms,
 		  void *dest, size_t length);
 
+/**
+ * Synchronous wrapper for mpd_async_recv_to_fd() which waits until at
+ * least one byte was moved (or an error has occurred).
+ *
+ * @return the number of bytes written to #fd or 0 on error
+ */
+size_t
+mpd_sync_recv_to_fd(struct mpd_async *async, long long deadline_ms,
+		    int fd, size_t length);
+
 #endif
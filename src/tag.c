@@ -31,10 +31,10 @@
 */
 
 #include <mpd/tag.h>
+#include "pair_name.h"
 
 #include <assert.h>
-#include <string.h>
-#include <stdbool.h>
+#include <stddef.h>
 
 static const char *const mpd_tag_type_names[MPD_TAG_COUNT] =
 {
@@ -83,38 +83,10 @@ mpd_tag_name_parse(const char *name)
 {
 	assert(name != NULL);
 
-	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i)
-		if (strcmp(name, mpd_tag_type_names[i]) == 0)
-			return (enum mpd_tag_type)i;
-
-	return MPD_TAG_UNKNOWN;
-}
-
-/**
- * This implementation is limited to ASCII letters.  Cheap, and good
- * enough for us: all valid tag names are hard-coded above.
- */
-static inline bool
-ignore_case_char_equals(const char a, const char b)
-{
-	return (a & ~0x20) == (b & ~0x20);
-}
-
-static bool
-ignore_case_string_equals(const char *a, const char *b)
-{
-	assert(a != NULL);
-	assert(b != NULL);
-
-	while (*a != 0) {
-		if (!ignore_case_char_equals(*a, *b))
-			return false;
-
-		++a;
-		++b;
-	}
-
-	return *b == 0;
+	const enum mpd_pair_name n = mpd_pair_name_parse(name);
+	return mpd_pair_name_is_tag(n)
+		? (enum mpd_tag_type)n
+		: MPD_TAG_UNKNOWN;
 }
 
 enum mpd_tag_type
@@ -122,9 +94,5 @@ mpd_tag_name_iparse(const char *name)
 {
 	assert(name != NULL);
 
-	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i)
-		if (ignore_case_string_equals(name, mpd_tag_type_names[i]))
-			return (enum mpd_tag_type)i;
-
-	return MPD_TAG_UNKNOWN;
+	return mpd_pair_name_iparse_tag(name);
 }
@@ -0,0 +1,198 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "uring.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int
+sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int
+sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+		   unsigned flags, const void *arg, size_t arg_size)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete,
+			    flags, arg, arg_size);
+}
+
+static void *
+map_ring(int fd, size_t size, off_t offset)
+{
+	void *p = mmap(NULL, size, PROT_READ|PROT_WRITE,
+		       MAP_SHARED|MAP_POPULATE, fd, offset);
+	return p != MAP_FAILED ? p : NULL;
+}
+
+bool
+mpd_uring_init(struct mpd_uring *uring, unsigned entries)
+{
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	uring->fd = sys_io_uring_setup(entries, &params);
+	if (uring->fd < 0)
+		return false;
+
+	/* we need a single mmap() for both rings, a CQ ring which
+	   never drops completions, and timeouts passed to
+	   io_uring_enter() (Linux 5.11) */
+	const unsigned required = IORING_FEAT_SINGLE_MMAP|
+		IORING_FEAT_NODROP|IORING_FEAT_EXT_ARG;
+	if ((params.features & required) != required) {
+		close(uring->fd);
+		return false;
+	}
+
+	/* with IORING_FEAT_SINGLE_MMAP, both rings share one
+	   mapping */
+	uring->ring_size = params.sq_off.array
+		+ params.sq_entries * sizeof(unsigned);
+	const size_t cq_size = params.cq_off.cqes
+		+ params.cq_entries * sizeof(struct io_uring_cqe);
+	if (cq_size > uring->ring_size)
+		uring->ring_size = cq_size;
+
+	uring->ring = map_ring(uring->fd, uring->ring_size,
+			       IORING_OFF_SQ_RING);
+	if (uring->ring == NULL) {
+		close(uring->fd);
+		return false;
+	}
+
+	uring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	uring->sqes = map_ring(uring->fd, uring->sqes_size,
+			       IORING_OFF_SQES);
+	if (uring->sqes == NULL) {
+		munmap(uring->ring, uring->ring_size);
+		close(uring->fd);
+		return false;
+	}
+
+	char *sq = uring->ring;
+	uring->sq_head = (unsigned *)(sq + params.sq_off.head);
+	uring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	uring->sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	uring->sq_array = (unsigned *)(sq + params.sq_off.array);
+	uring->sq_pending = 0;
+
+	char *cq = uring->ring;
+	uring->cq_head = (unsigned *)(cq + params.cq_off.head);
+	uring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	uring->cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	uring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	return true;
+}
+
+void
+mpd_uring_deinit(struct mpd_uring *uring)
+{
+	munmap(uring->sqes, uring->sqes_size);
+	munmap(uring->ring, uring->ring_size);
+	close(uring->fd);
+}
+
+struct io_uring_sqe *
+mpd_uring_get_sqe(struct mpd_uring *uring)
+{
+	unsigned tail = *uring->sq_tail;
+	unsigned head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+
+	if (tail - head > uring->sq_mask) {
+		/* the queue is full: submit it to make room */
+		if (!mpd_uring_submit(uring, false, 0))
+			return NULL;
+
+		head = __atomic_load_n(uring->sq_head, __ATOMIC_ACQUIRE);
+		if (tail - head > uring->sq_mask) {
+			errno = EBUSY;
+			return NULL;
+		}
+	}
+
+	const unsigned index = tail & uring->sq_mask;
+	struct io_uring_sqe *sqe = &uring->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+
+	uring->sq_array[index] = index;
+	__atomic_store_n(uring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	++uring->sq_pending;
+
+	return sqe;
+}
+
+bool
+mpd_uring_submit(struct mpd_uring *uring, bool wait, int timeout_ms)
+{
+	unsigned flags = 0, min_complete = 0;
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	const void *argp = NULL;
+	size_t arg_size = 0;
+
+	if (wait) {
+		flags |= IORING_ENTER_GETEVENTS;
+		min_complete = 1;
+
+		if (timeout_ms >= 0) {
+			ts.tv_sec = timeout_ms / 1000;
+			ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+
+			memset(&arg, 0, sizeof(arg));
+			arg.ts = (unsigned long long)(uintptr_t)&ts;
+
+			flags |= IORING_ENTER_EXT_ARG;
+			argp = &arg;
+			arg_size = sizeof(arg);
+		}
+	} else if (uring->sq_pending == 0)
+		return true;
+
+	int ret = sys_io_uring_enter(uring->fd, uring->sq_pending,
+				     min_complete, flags, argp, arg_size);
+	if (ret >= 0) {
+		uring->sq_pending -= (unsigned)ret;
+		return true;
+	}
+
+	/* ETIME and EINTR are returned only if nothing was submitted;
+	   EAGAIN and EBUSY mean that the completion queue is full,
+	   and the caller must handle completions first */
+	return errno == ETIME || errno == EINTR ||
+		errno == EAGAIN || errno == EBUSY;
+}
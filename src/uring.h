@@ -0,0 +1,119 @@
+/* libmpdclient
+   (c) 2003-2019 The Music Player Daemon Project
+   This project's homepage is: http://www.musicpd.org
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions
+   are met:
+
+   - Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+
+   - Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+   ``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+   A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE FOUNDATION OR
+   CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+   EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+   PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+   PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+   LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+   NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+   SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*! \file
+ * \brief A minimal io_uring wrapper
+ *
+ * This is a thin layer on top of the io_uring system calls, just
+ * enough for the #mpd_reactor; it does not need liburing.
+ */
+
+#ifndef MPD_URING_H
+#define MPD_URING_H
+
+#include <linux/io_uring.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct mpd_uring {
+	int fd;
+
+	/* the submission queue */
+	unsigned *sq_head, *sq_tail, *sq_array;
+	unsigned sq_mask;
+	struct io_uring_sqe *sqes;
+
+	/** the number of SQEs which have not been submitted yet */
+	unsigned sq_pending;
+
+	/* the completion queue */
+	unsigned *cq_head, *cq_tail;
+	unsigned cq_mask;
+	struct io_uring_cqe *cqes;
+
+	/* the mappings, for munmap() */
+	void *ring;
+	size_t ring_size;
+	size_t sqes_size;
+};
+
+/**
+ * Sets up a new io_uring instance.
+ *
+ * @return false if io_uring is not available (or not usable by this
+ * wrapper)
+ */
+bool
+mpd_uring_init(struct mpd_uring *uring, unsigned entries);
+
+void
+mpd_uring_deinit(struct mpd_uring *uring);
+
+/**
+ * Returns a cleared submission queue entry.  If the queue is full,
+ * the pending entries are submitted first.
+ *
+ * @return the entry, or NULL on error (errno is set)
+ */
+struct io_uring_sqe *
+mpd_uring_get_sqe(struct mpd_uring *uring);
+
+/**
+ * Submits all pending entries, and optionally waits for completions.
+ *
+ * @param wait true to wait for at least one completion
+ * @param timeout_ms the maximum time to wait in milliseconds, or -1
+ * to wait forever
+ * @return false on error (errno is set); a timeout is not an error
+ */
+bool
+mpd_uring_submit(struct mpd_uring *uring, bool wait, int timeout_ms);
+
+/**
+ * Returns the next completion queue entry, or NULL if there is none.
+ * Call mpd_uring_cqe_seen() after handling it.
+ */
+static inline struct io_uring_cqe *
+mpd_uring_peek_cqe(struct mpd_uring *uring)
+{
+	unsigned head = *uring->cq_head;
+	if (head == __atomic_load_n(uring->cq_tail, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	return &uring->cqes[head & uring->cq_mask];
+}
+
+static inline void
+mpd_uring_cqe_seen(struct mpd_uring *uring)
+{
+	__atomic_store_n(uring->cq_head, *uring->cq_head + 1,
+			 __ATOMIC_RELEASE);
+}
+
+#endif
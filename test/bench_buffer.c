@@ -0,0 +1,154 @@
+/*
+ * Benchmark for the input buffer compaction strategy.
+ *
+ * It feeds a synthetic "listallinfo" response through a #mpd_buffer
+ * in chunks of varying size (like recv() would), consuming complete
+ * lines like mpd_async_recv_line() does, and counts how many bytes
+ * get moved by mpd_buffer_write() (which always compacts), by
+ * mpd_buffer_write_tail() (which compacts only when worthwhile) and
+ * by a mirrored buffer (which never compacts).
+ */
+
+#include "buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+	RESPONSE_SIZE = 64 * 1024 * 1024,
+};
+
+enum mode {
+	MODE_WRITE,
+	MODE_WRITE_TAIL,
+	MODE_MIRROR,
+};
+
+static char *
+make_response(size_t size)
+{
+	static const char *const lines[] = {
+		"file: Various Artists/Some Compilation/01 - A Song.flac\n",
+		"Last-Modified: 2019-05-04T12:34:56Z\n",
+		"Format: 44100:16:2\n",
+		"Artist: Some Artist\n",
+		"Album: Some Compilation\n",
+		"Title: A Song With A Moderately Long Title\n",
+		"Track: 1\n",
+		"Date: 1999\n",
+		"Genre: Rock\n",
+		"Time: 245\n",
+		"duration: 245.133\n",
+	};
+
+	char *response = malloc(size);
+	if (response == NULL)
+		return NULL;
+
+	size_t position = 0;
+	for (unsigned i = 0;; i = (i + 1) % (sizeof(lines) / sizeof(lines[0]))) {
+		size_t length = strlen(lines[i]);
+		if (position + length > size)
+			break;
+
+		memcpy(response + position, lines[i], length);
+		position += length;
+	}
+
+	memset(response + position, '\n', size - position);
+	return response;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+run(const char *name, const char *response, enum mode mode)
+{
+	static struct mpd_buffer buffer;
+	mpd_buffer_init(&buffer);
+
+	if (mode == MODE_MIRROR && !mpd_buffer_enable_mirror(&buffer)) {
+		printf("%-24s not supported\n", name);
+		return;
+	}
+
+	/* pseudo-random chunk sizes between 1 and 3 TCP segments */
+	unsigned seed = 42;
+
+	unsigned long long moved = 0, lines = 0;
+	size_t position = 0;
+
+	const double start = now();
+
+	while (position < RESPONSE_SIZE) {
+		seed = seed * 1103515245 + 12345;
+		size_t chunk = 1 + (seed >> 8) % (3 * 1448);
+		if (chunk > RESPONSE_SIZE - position)
+			chunk = RESPONSE_SIZE - position;
+
+		const size_t old_read = buffer.read;
+		const size_t old_size = mpd_buffer_size(&buffer);
+
+		void *dest;
+		size_t room;
+		if (mode != MODE_WRITE)
+			dest = mpd_buffer_write_tail(&buffer, &room);
+		else {
+			room = mpd_buffer_room(&buffer);
+			dest = mpd_buffer_write(&buffer);
+		}
+
+		if (!buffer.mirrored && old_read > 0 && buffer.read == 0)
+			moved += old_size;
+
+		if (chunk > room)
+			chunk = room;
+
+		memcpy(dest, response + position, chunk);
+		mpd_buffer_expand(&buffer, chunk);
+		position += chunk;
+
+		/* consume all complete lines */
+		while (mpd_buffer_size(&buffer) > 0) {
+			const char *src = mpd_buffer_read(&buffer);
+			const char *newline =
+				memchr(src, '\n', mpd_buffer_size(&buffer));
+			if (newline == NULL)
+				break;
+
+			mpd_buffer_consume(&buffer, newline + 1 - src);
+			++lines;
+		}
+	}
+
+	const double duration = now() - start;
+
+	printf("%-24s %10.1f bytes moved per MiB received, %llu lines, %.3f s\n",
+	       name, moved / (RESPONSE_SIZE / (1024.0 * 1024.0)),
+	       lines, duration);
+
+	mpd_buffer_deinit(&buffer);
+}
+
+int
+main(void)
+{
+	char *response = make_response(RESPONSE_SIZE);
+	if (response == NULL)
+		return EXIT_FAILURE;
+
+	run("mpd_buffer_write()", response, MODE_WRITE);
+	run("mpd_buffer_write_tail()", response, MODE_WRITE_TAIL);
+	run("mirrored", response, MODE_MIRROR);
+
+	free(response);
+	return EXIT_SUCCESS;
+}
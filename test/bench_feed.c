@@ -0,0 +1,128 @@
+/*
+ * Benchmark for the song and status parsers.
+ *
+ * It feeds the pairs of a typical "listallinfo" song and of a
+ * typical "status" response to mpd_song_feed() and mpd_status_feed()
+ * over and over, and prints the cost per parsed object.  This
+ * includes the allocation of the object, but not the protocol
+ * parser.
+ */
+
+#include <mpd/song.h>
+#include <mpd/status.h>
+#include <mpd/pair.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+enum {
+	ITERATIONS = 1000 * 1000,
+};
+
+static const struct mpd_pair song_pairs[] = {
+	{ "file", "Various Artists/Some Compilation/01 - A Song.flac" },
+	{ "Last-Modified", "2019-05-04T12:34:56Z" },
+	{ "Format", "44100:16:2" },
+	{ "Artist", "Some Artist" },
+	{ "Album", "Some Compilation" },
+	{ "Title", "A Song With A Moderately Long Title" },
+	{ "Track", "1" },
+	{ "Date", "1999" },
+	{ "Genre", "Rock" },
+	{ "Time", "245" },
+	{ "duration", "245.133" },
+	{ "Pos", "1234" },
+	{ "Id", "5678" },
+	{ "Prio", "0" },
+};
+
+static const struct mpd_pair status_pairs[] = {
+	{ "volume", "-1" },
+	{ "repeat", "0" },
+	{ "random", "1" },
+	{ "single", "0" },
+	{ "consume", "0" },
+	{ "playlist", "4711" },
+	{ "playlistlength", "12345" },
+	{ "mixrampdb", "-17.000000" },
+	{ "state", "play" },
+	{ "song", "1234" },
+	{ "songid", "5678" },
+	{ "time", "83:245" },
+	{ "elapsed", "82.731" },
+	{ "bitrate", "1050" },
+	{ "duration", "245.133" },
+	{ "audio", "44100:16:2" },
+	{ "nextsong", "1235" },
+	{ "nextsongid", "5679" },
+};
+
+#define N_SONG_PAIRS (sizeof(song_pairs) / sizeof(song_pairs[0]))
+#define N_STATUS_PAIRS (sizeof(status_pairs) / sizeof(status_pairs[0]))
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+report(const char *name, double duration, unsigned long long checksum)
+{
+	printf("%-16s %8.1f ns per object, %.3f s (checksum %llu)\n",
+	       name, duration * 1e9 / ITERATIONS, duration, checksum);
+}
+
+static void
+bench_song(void)
+{
+	/* accumulate some results so the work cannot be optimized
+	   away */
+	unsigned long long checksum = 0;
+
+	const double start = now();
+
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		struct mpd_song *song = mpd_song_begin(&song_pairs[0]);
+		for (unsigned j = 1; j < N_SONG_PAIRS; ++j)
+			mpd_song_feed(song, &song_pairs[j]);
+
+		checksum += mpd_song_get_duration_ms(song) +
+			mpd_song_get_id(song);
+		mpd_song_free(song);
+	}
+
+	report("mpd_song_feed()", now() - start, checksum);
+}
+
+static void
+bench_status(void)
+{
+	unsigned long long checksum = 0;
+
+	const double start = now();
+
+	for (unsigned i = 0; i < ITERATIONS; ++i) {
+		struct mpd_status *status = mpd_status_begin();
+		for (unsigned j = 0; j < N_STATUS_PAIRS; ++j)
+			mpd_status_feed(status, &status_pairs[j]);
+
+		checksum += mpd_status_get_elapsed_ms(status) +
+			mpd_status_get_queue_length(status);
+		mpd_status_free(status);
+	}
+
+	report("mpd_status_feed()", now() - start, checksum);
+}
+
+int
+main(void)
+{
+	bench_song();
+	bench_status();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * Benchmark for the low-latency socket profile.
+ *
+ * It runs a stand-in MPD server on the loopback interface (in a
+ * thread, answering "OK" to every command), and measures the round
+ * trip time of "ping" commands through a #mpd_pool connection, with
+ * and without mpd_settings_set_low_latency().
+ */
+
+#include <mpd/client.h>
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+enum {
+	ROUND_TRIPS = 20000,
+};
+
+struct server {
+	int listen_fd, wake_fds[2];
+	unsigned port;
+	pthread_t thread;
+};
+
+static void *
+server_run(void *arg)
+{
+	struct server *server = arg;
+	int fd = -1;
+
+	while (true) {
+		struct pollfd fds[2] = {
+			{ .fd = server->wake_fds[0], .events = POLLIN },
+			{ .fd = fd < 0 ? server->listen_fd : fd,
+			  .events = POLLIN },
+		};
+
+		if (poll(fds, 2, -1) < 0 || fds[0].revents != 0)
+			break;
+
+		if (fd < 0) {
+			fd = accept(server->listen_fd, NULL, NULL);
+			if (fd >= 0)
+				send(fd, "OK MPD 0.21.0\n", 14, MSG_NOSIGNAL);
+			continue;
+		}
+
+		char buffer[256];
+		ssize_t nbytes = recv(fd, buffer, sizeof(buffer), 0);
+		if (nbytes <= 0) {
+			close(fd);
+			fd = -1;
+			continue;
+		}
+
+		for (ssize_t i = 0; i < nbytes; ++i)
+			if (buffer[i] == '\n')
+				send(fd, "OK\n", 3, MSG_NOSIGNAL);
+	}
+
+	if (fd >= 0)
+		close(fd);
+	return NULL;
+}
+
+static bool
+server_start(struct server *server)
+{
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+	socklen_t length = sizeof(address);
+
+	server->listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (server->listen_fd < 0 ||
+	    bind(server->listen_fd, (struct sockaddr *)&address,
+		 sizeof(address)) < 0 ||
+	    listen(server->listen_fd, 4) < 0 ||
+	    getsockname(server->listen_fd, (struct sockaddr *)&address,
+			&length) < 0 ||
+	    pipe(server->wake_fds) < 0)
+		return false;
+
+	server->port = ntohs(address.sin_port);
+	return pthread_create(&server->thread, NULL, server_run, server) == 0;
+}
+
+static void
+server_stop(struct server *server)
+{
+	close(server->wake_fds[1]);
+	pthread_join(server->thread, NULL);
+	close(server->wake_fds[0]);
+	close(server->listen_fd);
+}
+
+static long long
+now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int
+compare_long_long(const void *a, const void *b)
+{
+	const long long *x = a, *y = b;
+	return *x < *y ? -1 : *x > *y;
+}
+
+static void
+run(const char *name, const struct server *server, bool low_latency)
+{
+	struct mpd_settings *settings =
+		mpd_settings_new("127.0.0.1", server->port, 5000, NULL, NULL);
+	if (settings == NULL)
+		return;
+
+	mpd_settings_set_low_latency(settings, low_latency);
+
+	const long long connect_start = now_ns();
+	struct mpd_pool *pool = mpd_pool_new(settings, 1);
+	const long long connect_ns = now_ns() - connect_start;
+	mpd_settings_free(settings);
+	if (pool == NULL)
+		return;
+
+	struct mpd_connection *c = mpd_pool_get(pool);
+	if (c == NULL) {
+		printf("%-16s failed to connect\n", name);
+		mpd_pool_free(pool);
+		return;
+	}
+
+	static long long samples[ROUND_TRIPS];
+	long long total = 0;
+
+	for (unsigned i = 0; i < ROUND_TRIPS; ++i) {
+		const long long start = now_ns();
+		if (!mpd_send_command(c, "ping", NULL) ||
+		    !mpd_response_finish(c)) {
+			printf("%-16s %s\n", name,
+			       mpd_connection_get_error_message(c));
+			break;
+		}
+
+		samples[i] = now_ns() - start;
+		total += samples[i];
+	}
+
+	qsort(samples, ROUND_TRIPS, sizeof(samples[0]), compare_long_long);
+
+	printf("%-16s connect %7.1f us, round trip: mean %6.1f us, "
+	       "p50 %6.1f us, p99 %6.1f us\n",
+	       name, connect_ns / 1e3, total / 1e3 / ROUND_TRIPS,
+	       samples[ROUND_TRIPS / 2] / 1e3,
+	       samples[ROUND_TRIPS * 99 / 100] / 1e3);
+
+	mpd_pool_put(pool, c);
+	mpd_pool_free(pool);
+}
+
+int
+main(void)
+{
+	struct server server;
+	if (!server_start(&server))
+		return EXIT_FAILURE;
+
+	run("default", &server, false);
+	run("low latency", &server, true);
+
+	server_stop(&server);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+/*
+ * Benchmark for the pair name lookup.
+ *
+ * It resolves the pair names of a typical "listallinfo" and "status"
+ * response over and over, once with a linear strcmp() scan (which is
+ * how the parsers used to do it) and once with
+ * mpd_pair_name_parse(), and prints the number of names resolved per
+ * second.
+ */
+
+#include "pair_name.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+enum {
+	ITERATIONS = 500 * 1000,
+};
+
+static const char *const names[] = {
+	/* listallinfo */
+	"file",
+	"Last-Modified",
+	"Format",
+	"Artist",
+	"AlbumArtist",
+	"Album",
+	"Title",
+	"Track",
+	"Date",
+	"Genre",
+	"MUSICBRAINZ_TRACKID",
+	"Time",
+	"duration",
+
+	/* status */
+	"volume",
+	"repeat",
+	"random",
+	"single",
+	"consume",
+	"playlist",
+	"playlistlength",
+	"mixrampdb",
+	"state",
+	"song",
+	"songid",
+	"time",
+	"elapsed",
+	"bitrate",
+	"audio",
+	"nextsong",
+	"nextsongid",
+
+	/* unknown to the parsers */
+	"X-Custom",
+};
+
+/**
+ * All names in the order the old strcmp() chains checked them: tag
+ * names first, then the song, status and other attributes.
+ */
+static const char *const linear_names[] = {
+	"Artist", "ArtistSort", "Album", "AlbumSort", "AlbumArtist",
+	"AlbumArtistSort", "Title", "Track", "Name", "Genre", "Date",
+	"Composer", "Performer", "Comment", "Disc", "Label",
+	"MUSICBRAINZ_ARTISTID", "MUSICBRAINZ_ALBUMID",
+	"MUSICBRAINZ_ALBUMARTISTID", "MUSICBRAINZ_TRACKID",
+	"MUSICBRAINZ_RELEASETRACKID", "MUSICBRAINZ_WORKID",
+	"OriginalDate", "Grouping", "Work", "Conductor",
+
+	"file", "Time", "duration", "Range", "Last-Modified", "Pos", "Id",
+	"Prio", "Format",
+
+	"volume", "repeat", "random", "single", "consume", "playlist",
+	"playlistlength", "bitrate", "state", "song", "songid", "nextsong",
+	"nextsongid", "time", "elapsed", "partition", "error", "xfade",
+	"mixrampdb", "mixrampdelay", "updating_db", "audio",
+};
+
+#define N_NAMES (sizeof(names) / sizeof(names[0]))
+#define N_LINEAR_NAMES (sizeof(linear_names) / sizeof(linear_names[0]))
+
+static double
+now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+linear_parse(const char *name)
+{
+	for (unsigned i = 0; i < N_LINEAR_NAMES; ++i)
+		if (strcmp(name, linear_names[i]) == 0)
+			return i;
+
+	return -1;
+}
+
+static int
+switch_parse(const char *name)
+{
+	return mpd_pair_name_parse(name);
+}
+
+static void
+run(const char *label, int (*parse)(const char *name))
+{
+	/* accumulate the results so the calls cannot be optimized
+	   away */
+	unsigned long long checksum = 0;
+
+	const double start = now();
+
+	for (unsigned i = 0; i < ITERATIONS; ++i)
+		for (unsigned j = 0; j < N_NAMES; ++j)
+			checksum += parse(names[j]);
+
+	const double duration = now() - start;
+	const double total = (double)ITERATIONS * N_NAMES;
+
+	printf("%-24s %10.1f M names/s, %.3f s (checksum %llu)\n",
+	       label, total / duration / 1e6, duration, checksum);
+}
+
+int
+main(void)
+{
+	run("strcmp() scan", linear_parse);
+	run("mpd_pair_name_parse()", switch_parse);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include "capture.h"
+#include <mpd/batch.h>
+#include <mpd/connection.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include <mpd/song.h>
+#include <mpd/status.h>
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+START_TEST(test_batch_results)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_batch *batch = mpd_batch_new();
+	ck_assert_ptr_ne(batch, NULL);
+
+	int id1, id2;
+	bool success;
+	struct mpd_status *status;
+	struct mpd_song *song;
+	ck_assert(mpd_batch_add_id(batch, "a.ogg", &id1));
+	ck_assert(mpd_batch_add_id(batch, "missing.ogg", &id2));
+	ck_assert(mpd_batch_command(batch, &success, "play", "0", NULL));
+	ck_assert(mpd_batch_status(batch, &status));
+	ck_assert(mpd_batch_current_song(batch, &song));
+	ck_assert_int_eq(mpd_batch_get_length(batch), 5);
+	ck_assert_int_eq(id1, -1);
+
+	/* the second command fails, which aborts the command list;
+	   the remaining commands are sent again */
+	ck_assert(test_capture_send(&capture,
+				    "Id: 7\nlist_OK\n"
+				    "ACK [50@1] {addid} No such file\n"
+				    "list_OK\n"
+				    "state: play\nsong: 0\nsongid: 7\nlist_OK\n"
+				    "file: a.ogg\nId: 7\nlist_OK\n"
+				    "OK\n"));
+
+	ck_assert(!mpd_batch_commit(batch, c));
+	ck_assert_int_eq(mpd_batch_get_length(batch), 0);
+	ck_assert_str_eq(test_capture_receive(&capture),
+			 "command_list_ok_begin\n"
+			 "addid \"a.ogg\"\n"
+			 "addid \"missing.ogg\"\n"
+			 "play \"0\"\n"
+			 "status\n"
+			 "currentsong\n"
+			 "command_list_end\n"
+			 "command_list_ok_begin\n"
+			 "play \"0\"\n"
+			 "status\n"
+			 "currentsong\n"
+			 "command_list_end\n");
+
+	/* the first error is reported, with the index in the batch */
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SERVER);
+	ck_assert_int_eq(mpd_connection_get_server_error(c),
+			 MPD_SERVER_ERROR_NO_EXIST);
+	ck_assert_int_eq(mpd_connection_get_server_error_location(c), 1);
+	ck_assert(mpd_connection_clear_error(c));
+
+	ck_assert_int_eq(id1, 7);
+	ck_assert_int_eq(id2, -1);
+	ck_assert(success);
+
+	ck_assert_ptr_ne(status, NULL);
+	ck_assert_int_eq(mpd_status_get_state(status), MPD_STATE_PLAY);
+	ck_assert_int_eq(mpd_status_get_song_id(status), 7);
+	mpd_status_free(status);
+
+	ck_assert_ptr_ne(song, NULL);
+	ck_assert_str_eq(mpd_song_get_uri(song), "a.ogg");
+	mpd_song_free(song);
+
+	/* the connection is usable again */
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	mpd_batch_free(batch);
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_batch_blocks)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_batch *batch = mpd_batch_new();
+	ck_assert_ptr_ne(batch, NULL);
+
+	/* more commands than fit into the output buffer */
+	enum { N = 300 };
+	int ids[N];
+	char uri[32];
+	for (unsigned i = 0; i < N; ++i) {
+		snprintf(uri, sizeof(uri), "song_%03u.ogg", i);
+		ck_assert(mpd_batch_add_id(batch, uri, &ids[i]));
+	}
+
+	static char response[N * 24];
+	char *p = response;
+	for (unsigned i = 0; i < N; ++i) {
+		p += sprintf(p, "Id: %u\nlist_OK\n", i + 100);
+
+		/* the end of a block: each "addid" line takes 21
+		   bytes, so 193 of them fit into 4 kB */
+		if (i == 192 || i == N - 1)
+			p += sprintf(p, "OK\n");
+	}
+
+	ck_assert(test_capture_send(&capture, response));
+	ck_assert(mpd_batch_commit(batch, c));
+
+	for (unsigned i = 0; i < N; ++i)
+		ck_assert_int_eq(ids[i], (int)i + 100);
+
+	mpd_batch_free(batch);
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("batch");
+	TCase *tc_batch = tcase_create("batch");
+	tcase_add_test(tc_batch, test_batch_results);
+	tcase_add_test(tc_batch, test_batch_blocks);
+	suite_add_tcase(s, tc_batch);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,319 @@
+#include <mpd/connector.h>
+#include <mpd/async.h>
+#include <mpd/connection.h>
+#include <mpd/settings.h>
+
+#include <check.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/**
+ * A fake MPD server.  It is driven by the test's event loop, so no
+ * thread is needed.
+ */
+struct server {
+	int listen_fd, fd;
+
+	/** the port of the TCP listener, or 0 for a local socket */
+	unsigned port;
+
+	char path[64];
+
+	/** the response to the "password" command */
+	const char *password_response;
+};
+
+static void
+server_init_local(struct server *server)
+{
+	snprintf(server->path, sizeof(server->path),
+		 "/tmp/t_connector.%d", (int)getpid());
+	unlink(server->path);
+
+	struct sockaddr_un address = { .sun_family = AF_LOCAL };
+	strcpy(address.sun_path, server->path);
+
+	server->listen_fd = socket(AF_LOCAL, SOCK_STREAM|SOCK_NONBLOCK, 0);
+	ck_assert_int_ge(server->listen_fd, 0);
+	ck_assert_int_eq(bind(server->listen_fd, (struct sockaddr *)&address,
+			      sizeof(address)), 0);
+	ck_assert_int_eq(listen(server->listen_fd, 4), 0);
+
+	server->fd = -1;
+	server->port = 0;
+	server->password_response = "OK\n";
+}
+
+static void
+server_init_tcp(struct server *server)
+{
+	struct sockaddr_in address = {
+		.sin_family = AF_INET,
+		.sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+	};
+
+	server->listen_fd = socket(AF_INET, SOCK_STREAM|SOCK_NONBLOCK, 0);
+	ck_assert_int_ge(server->listen_fd, 0);
+	ck_assert_int_eq(bind(server->listen_fd, (struct sockaddr *)&address,
+			      sizeof(address)), 0);
+	ck_assert_int_eq(listen(server->listen_fd, 4), 0);
+
+	socklen_t length = sizeof(address);
+	ck_assert_int_eq(getsockname(server->listen_fd,
+				     (struct sockaddr *)&address, &length), 0);
+
+	server->fd = -1;
+	server->port = ntohs(address.sin_port);
+	server->path[0] = 0;
+	server->password_response = "OK\n";
+}
+
+static void
+server_deinit(struct server *server)
+{
+	if (server->fd >= 0)
+		close(server->fd);
+	close(server->listen_fd);
+	if (server->path[0] != 0)
+		unlink(server->path);
+}
+
+/**
+ * Accepts the client and answers its commands, without blocking.
+ */
+static void
+server_run(struct server *server)
+{
+	if (server->fd < 0) {
+		server->fd = accept(server->listen_fd, NULL, NULL);
+		if (server->fd < 0)
+			return;
+
+		ck_assert_int_eq(send(server->fd, "OK MPD 0.21.0\n", 14, 0), 14);
+	}
+
+	char buffer[256];
+	ssize_t nbytes = recv(server->fd, buffer, sizeof(buffer) - 1,
+			      MSG_DONTWAIT);
+	if (nbytes <= 0)
+		return;
+
+	buffer[nbytes] = 0;
+	ck_assert_str_eq(buffer, "password \"secret\"\n");
+	ck_assert_int_ge(send(server->fd, server->password_response,
+			      strlen(server->password_response), 0), 0);
+}
+
+/**
+ * Runs the connector until it is done, like an application's event
+ * loop would.
+ */
+static enum mpd_connector_state
+run_connector(struct mpd_connector *connector, struct server *server)
+{
+	enum mpd_async_event events = 0;
+	enum mpd_connector_state state;
+
+	while ((state = mpd_connector_step(connector, events)) ==
+	       MPD_CONNECTOR_RUNNING) {
+		server_run(server);
+
+		struct pollfd pfd = {
+			.fd = mpd_connector_get_fd(connector),
+			.events = 0,
+		};
+
+		const enum mpd_async_event e =
+			mpd_connector_get_events(connector);
+		if (e & MPD_ASYNC_EVENT_READ)
+			pfd.events |= POLLIN;
+		if (e & MPD_ASYNC_EVENT_WRITE)
+			pfd.events |= POLLOUT;
+
+		/* wake up regularly to let the server run */
+		int timeout = mpd_connector_get_timeout(connector);
+		if (timeout < 0 || timeout > 10)
+			timeout = 10;
+
+		ck_assert_int_ge(poll(&pfd, 1, timeout), 0);
+
+		events = 0;
+		if (pfd.revents & POLLIN)
+			events |= MPD_ASYNC_EVENT_READ;
+		if (pfd.revents & POLLOUT)
+			events |= MPD_ASYNC_EVENT_WRITE;
+		if (pfd.revents & POLLHUP)
+			events |= MPD_ASYNC_EVENT_HUP;
+		if (pfd.revents & POLLERR)
+			events |= MPD_ASYNC_EVENT_ERROR;
+	}
+
+	return state;
+}
+
+static struct mpd_connector *
+create_connector_ex(const char *host, unsigned port, const char *password,
+		    bool low_latency)
+{
+	struct mpd_settings *settings =
+		mpd_settings_new(host, port, 5000, NULL, password);
+	ck_assert_ptr_ne(settings, NULL);
+	mpd_settings_set_low_latency(settings, low_latency);
+
+	struct mpd_connector *connector = mpd_connector_new(settings);
+	ck_assert_ptr_ne(connector, NULL);
+
+	mpd_settings_free(settings);
+	return connector;
+}
+
+static struct mpd_connector *
+create_connector(const char *host, unsigned port, const char *password)
+{
+	return create_connector_ex(host, port, password, false);
+}
+
+START_TEST(test_connector_local)
+{
+	struct server server;
+	server_init_local(&server);
+
+	struct mpd_connector *connector =
+		create_connector(server.path, 0, NULL);
+	ck_assert_int_eq(run_connector(connector, &server),
+			 MPD_CONNECTOR_READY);
+
+	struct mpd_connection *c = mpd_connector_get_connection(connector);
+	mpd_connector_free(connector);
+
+	ck_assert_ptr_ne(c, NULL);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+	ck_assert_int_eq(mpd_connection_get_server_version(c)[1], 21);
+	mpd_connection_free(c);
+
+	server_deinit(&server);
+}
+END_TEST
+
+START_TEST(test_connector_tcp)
+{
+	struct server server;
+	server_init_tcp(&server);
+
+	/* this goes through the resolver thread */
+	struct mpd_connector *connector =
+		create_connector("127.0.0.1", server.port, "secret");
+	ck_assert_int_eq(run_connector(connector, &server),
+			 MPD_CONNECTOR_READY);
+
+	struct mpd_connection *c = mpd_connector_get_connection(connector);
+	ck_assert_ptr_ne(c, NULL);
+	mpd_connection_free(c);
+	mpd_connector_free(connector);
+
+	server_deinit(&server);
+}
+END_TEST
+
+static int
+get_nodelay(struct mpd_connection *c)
+{
+	int value = -1;
+	socklen_t length = sizeof(value);
+	ck_assert_int_eq(getsockopt(mpd_async_get_fd(mpd_connection_get_async(c)),
+				    IPPROTO_TCP, TCP_NODELAY,
+				    &value, &length), 0);
+	return value;
+}
+
+START_TEST(test_connector_low_latency)
+{
+	for (int low_latency = 0; low_latency <= 1; ++low_latency) {
+		struct server server;
+		server_init_tcp(&server);
+
+		struct mpd_connector *connector =
+			create_connector_ex("127.0.0.1", server.port, NULL,
+					    low_latency);
+		ck_assert_int_eq(run_connector(connector, &server),
+				 MPD_CONNECTOR_READY);
+
+		struct mpd_connection *c =
+			mpd_connector_get_connection(connector);
+		ck_assert_ptr_ne(c, NULL);
+		ck_assert_int_eq(get_nodelay(c) != 0, low_latency);
+		mpd_connection_free(c);
+		mpd_connector_free(connector);
+
+		server_deinit(&server);
+	}
+}
+END_TEST
+
+START_TEST(test_connector_wrong_password)
+{
+	struct server server;
+	server_init_local(&server);
+	server.password_response = "ACK [3@0] {password} incorrect password\n";
+
+	struct mpd_connector *connector =
+		create_connector(server.path, 0, "secret");
+	ck_assert_int_eq(run_connector(connector, &server),
+			 MPD_CONNECTOR_FAILED);
+	ck_assert_int_eq(mpd_connector_get_error(connector),
+			 MPD_ERROR_SERVER);
+	ck_assert_int_eq(mpd_connector_get_server_error(connector),
+			 MPD_SERVER_ERROR_PASSWORD);
+	ck_assert_str_eq(mpd_connector_get_error_message(connector),
+			 "incorrect password");
+	mpd_connector_free(connector);
+
+	server_deinit(&server);
+}
+END_TEST
+
+START_TEST(test_connector_refused)
+{
+	struct mpd_connector *connector =
+		create_connector("/nonexistent/socket", 0, NULL);
+
+	ck_assert_int_eq(mpd_connector_step(connector, 0),
+			 MPD_CONNECTOR_FAILED);
+	ck_assert_int_eq(mpd_connector_get_error(connector),
+			 MPD_ERROR_SYSTEM);
+	mpd_connector_free(connector);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("connector");
+	TCase *tc_connector = tcase_create("connector");
+	tcase_add_test(tc_connector, test_connector_local);
+	tcase_add_test(tc_connector, test_connector_tcp);
+	tcase_add_test(tc_connector, test_connector_low_latency);
+	tcase_add_test(tc_connector, test_connector_wrong_password);
+	tcase_add_test(tc_connector, test_connector_refused);
+	suite_add_tcase(s, tc_connector);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
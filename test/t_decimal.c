@@ -0,0 +1,93 @@
+#include "decimal.h"
+
+#include <check.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+START_TEST(test_decimal_integer)
+{
+	const char *end;
+
+	ck_assert_uint_eq(mpd_decimal_parse_unsigned("1234:5", &end), 1234);
+	ck_assert_int_eq(*end, ':');
+
+	ck_assert_uint_eq(mpd_decimal_parse_unsigned("x", &end), 0);
+	ck_assert_int_eq(*end, 'x');
+
+	/* overflow saturates */
+	ck_assert_uint_eq(mpd_decimal_parse_unsigned("4294967295", NULL),
+			  4294967295u);
+	ck_assert_uint_eq(mpd_decimal_parse_unsigned("4294967296", NULL),
+			  4294967295u);
+	ck_assert_uint_eq(mpd_decimal_parse_unsigned("99999999999999999999999",
+						     &end),
+			  4294967295u);
+	ck_assert_int_eq(*end, 0);
+
+	ck_assert_int_eq(mpd_decimal_parse_int("-1", NULL), -1);
+	ck_assert_int_eq(mpd_decimal_parse_int("2147483647", NULL), 2147483647);
+	ck_assert_int_eq(mpd_decimal_parse_int("2147483648", NULL), 2147483647);
+	ck_assert_int_eq(mpd_decimal_parse_int("-2147483648", NULL),
+			 -2147483647 - 1);
+	ck_assert_int_eq(mpd_decimal_parse_int("-9999999999", NULL),
+			 -2147483647 - 1);
+
+	ck_assert_int_eq(mpd_decimal_parse_int("-", &end), 0);
+	ck_assert_int_eq(*end, '-');
+}
+END_TEST
+
+START_TEST(test_decimal_ms)
+{
+	const char *end;
+
+	ck_assert_uint_eq(mpd_decimal_parse_ms("245.133", NULL), 245133);
+	ck_assert_uint_eq(mpd_decimal_parse_ms("82.125", NULL), 82125);
+	ck_assert_uint_eq(mpd_decimal_parse_ms("1.5-3", &end), 1500);
+	ck_assert_int_eq(*end, '-');
+	ck_assert_uint_eq(mpd_decimal_parse_ms("0.0009", NULL), 0);
+	ck_assert_uint_eq(mpd_decimal_parse_ms("7", NULL), 7000);
+	ck_assert_uint_eq(mpd_decimal_parse_ms("99999999", NULL), 4294967295u);
+}
+END_TEST
+
+START_TEST(test_decimal_double)
+{
+	static const char *const values[] = {
+		"0", "-17.000000", "0.1", "2.5", "1234.5678", "1e3",
+		"-1.5E-2", "123456789012345", "1234567890123456789",
+		"0.30000000000000004", "1e300",
+	};
+
+	for (unsigned i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+		ck_assert(mpd_decimal_parse_double(values[i]) ==
+			  strtod(values[i], NULL));
+
+	ck_assert(isnan(mpd_decimal_parse_double("nan")));
+	ck_assert(mpd_decimal_parse_double("") == 0);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("decimal");
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_decimal_integer);
+	tcase_add_test(tc_core, test_decimal_ms);
+	tcase_add_test(tc_core, test_decimal_double);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,183 @@
+#include "capture.h"
+#include <mpd/idle_hub.h>
+#include <mpd/connection.h>
+
+#include <check.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Waits until the hub has sent something, and returns it.
+ */
+static const char *
+server_receive(struct test_capture *capture)
+{
+	struct pollfd pfd = {
+		.fd = capture->fd,
+		.events = POLLIN,
+	};
+
+	ck_assert_int_eq(poll(&pfd, 1, 5000), 1);
+	return test_capture_receive(capture);
+}
+
+struct runner {
+	struct mpd_idle_hub *hub;
+	pthread_t thread;
+	bool result;
+};
+
+static void *
+runner_run(void *arg)
+{
+	struct runner *runner = arg;
+	runner->result = mpd_idle_hub_run(runner->hub);
+	return NULL;
+}
+
+static void
+runner_start(struct runner *runner, struct mpd_idle_hub *hub)
+{
+	runner->hub = hub;
+	runner->result = false;
+	ck_assert_int_eq(pthread_create(&runner->thread, NULL,
+					runner_run, runner), 0);
+}
+
+/**
+ * Stops the hub while it is waiting in "idle".
+ */
+static bool
+runner_stop(struct runner *runner, struct test_capture *capture)
+{
+	mpd_idle_hub_stop(runner->hub);
+	ck_assert_str_eq(server_receive(capture), "noidle\n");
+	ck_assert(test_capture_send(capture, "OK\n"));
+	pthread_join(runner->thread, NULL);
+	return runner->result;
+}
+
+static void
+notify_cb(void *ctx)
+{
+	unsigned *n = ctx;
+	__atomic_add_fetch(n, 1, __ATOMIC_RELAXED);
+}
+
+START_TEST(test_idle_hub)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	struct mpd_idle_hub *hub = mpd_idle_hub_new(c, 2);
+	ck_assert_ptr_ne(hub, NULL);
+
+	unsigned n_player = 0;
+	struct mpd_idle_hub_subscriber *player =
+		mpd_idle_hub_subscribe(hub, MPD_IDLE_PLAYER|MPD_IDLE_MIXER,
+				       notify_cb, &n_player);
+	ck_assert_ptr_ne(player, NULL);
+
+	struct mpd_idle_hub_subscriber *database =
+		mpd_idle_hub_subscribe(hub, MPD_IDLE_DATABASE, NULL, NULL);
+	ck_assert_ptr_ne(database, NULL);
+
+	/* all slots are in use */
+	ck_assert_ptr_eq(mpd_idle_hub_subscribe(hub, MPD_IDLE_PLAYER,
+						NULL, NULL), NULL);
+
+	struct runner runner;
+	runner_start(&runner, hub);
+
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+	ck_assert(test_capture_send(&capture,
+				    "changed: player\nchanged: mixer\nOK\n"));
+
+	/* the hub re-enters idle after delivering */
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+	ck_assert_int_eq(__atomic_load_n(&n_player, __ATOMIC_RELAXED), 1);
+	ck_assert_int_eq(mpd_idle_hub_subscriber_take(player),
+			 MPD_IDLE_PLAYER|MPD_IDLE_MIXER);
+	ck_assert_int_eq(mpd_idle_hub_subscriber_take(player), 0);
+	ck_assert_int_eq(mpd_idle_hub_subscriber_take(database), 0);
+
+	/* a freed slot can be reused */
+	mpd_idle_hub_unsubscribe(database);
+	database = mpd_idle_hub_subscribe(hub, MPD_IDLE_DATABASE, NULL, NULL);
+	ck_assert_ptr_ne(database, NULL);
+
+	ck_assert(runner_stop(&runner, &capture));
+
+	mpd_idle_hub_free(hub);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_idle_hub_coalesce)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	struct mpd_idle_hub *hub = mpd_idle_hub_new(c, 1);
+	ck_assert_ptr_ne(hub, NULL);
+	mpd_idle_hub_set_coalesce(hub, 100);
+
+	unsigned n = 0;
+	struct mpd_idle_hub_subscriber *s =
+		mpd_idle_hub_subscribe(hub, MPD_IDLE_PLAYER|MPD_IDLE_MIXER,
+				       notify_cb, &n);
+	ck_assert_ptr_ne(s, NULL);
+
+	struct runner runner;
+	runner_start(&runner, hub);
+
+	/* two events in quick succession */
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+	ck_assert(test_capture_send(&capture, "changed: player\nOK\n"));
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+	ck_assert(test_capture_send(&capture, "changed: mixer\nOK\n"));
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+
+	/* after the coalescing time span, the hub interrupts idle to
+	   deliver both at once */
+	ck_assert_str_eq(server_receive(&capture), "noidle\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert_str_eq(server_receive(&capture), "idle\n");
+
+	ck_assert_int_eq(__atomic_load_n(&n, __ATOMIC_RELAXED), 1);
+	ck_assert_int_eq(mpd_idle_hub_subscriber_take(s),
+			 MPD_IDLE_PLAYER|MPD_IDLE_MIXER);
+
+	ck_assert(runner_stop(&runner, &capture));
+
+	mpd_idle_hub_free(hub);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("idle_hub");
+	TCase *tc_idle_hub = tcase_create("idle_hub");
+	tcase_add_test(tc_idle_hub, test_idle_hub);
+	tcase_add_test(tc_idle_hub, test_idle_hub_coalesce);
+	suite_add_tcase(s, tc_idle_hub);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -21,12 +21,25 @@ START_TEST(test_iso8601)
 }
 END_TEST
 
+START_TEST(test_iso8601_parse)
+{
+	ck_assert_int_eq(iso8601_datetime_parse("1970-01-01T00:00:00Z"), 0);
+	ck_assert_int_eq(iso8601_datetime_parse("2019-05-04T12:34:56Z"),
+			 1556973296);
+	ck_assert_int_eq(iso8601_datetime_parse("2000-02-29T23:59:59Z"),
+			 951868799);
+	ck_assert_int_eq(iso8601_datetime_parse("2019-13-04T12:34:56Z"), 0);
+	ck_assert_int_eq(iso8601_datetime_parse("2019-05-04T12:34Z"), 0);
+}
+END_TEST
+
 static Suite *
 create_suite(void)
 {
 	Suite *s = suite_create("iso8601");
 	TCase *tc_core = tcase_create("Core");
 	tcase_add_test(tc_core, test_iso8601);
+	tcase_add_test(tc_core, test_iso8601_parse);
 	suite_add_tcase(s, tc_core);
 	return s;
 }
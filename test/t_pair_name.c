@@ -0,0 +1,68 @@
+#include "pair_name.h"
+#include <mpd/tag.h>
+
+#include <check.h>
+
+#include <stdlib.h>
+
+START_TEST(test_pair_name_tags)
+{
+	for (unsigned i = 0; i < MPD_TAG_COUNT; ++i) {
+		const char *name = mpd_tag_name((enum mpd_tag_type)i);
+		ck_assert_ptr_ne(name, NULL);
+		ck_assert_int_eq(mpd_pair_name_parse(name), (int)i);
+		ck_assert_int_eq(mpd_tag_name_parse(name), (int)i);
+		ck_assert_int_eq(mpd_tag_name_iparse(name), (int)i);
+	}
+
+	ck_assert_int_eq(mpd_tag_name_iparse("albumartist"),
+			 MPD_TAG_ALBUM_ARTIST);
+	ck_assert_int_eq(mpd_tag_name_iparse("musicbrainz_trackid"),
+			 MPD_TAG_MUSICBRAINZ_TRACKID);
+	ck_assert_int_eq(mpd_tag_name_parse("albumartist"), MPD_TAG_UNKNOWN);
+	ck_assert_int_eq(mpd_tag_name_parse("file"), MPD_TAG_UNKNOWN);
+	ck_assert_int_eq(mpd_tag_name_iparse("Albu"), MPD_TAG_UNKNOWN);
+}
+END_TEST
+
+START_TEST(test_pair_name_other)
+{
+	ck_assert_int_eq(mpd_pair_name_parse("file"), MPD_PAIR_NAME_FILE);
+	ck_assert_int_eq(mpd_pair_name_parse("Time"), MPD_PAIR_NAME_SONG_TIME);
+	ck_assert_int_eq(mpd_pair_name_parse("time"), MPD_PAIR_NAME_TIME);
+	ck_assert_int_eq(mpd_pair_name_parse("Last-Modified"),
+			 MPD_PAIR_NAME_LAST_MODIFIED);
+	ck_assert_int_eq(mpd_pair_name_parse("playlist"),
+			 MPD_PAIR_NAME_PLAYLIST);
+	ck_assert_int_eq(mpd_pair_name_parse("playlistlength"),
+			 MPD_PAIR_NAME_PLAYLISTLENGTH);
+	ck_assert_int_eq(mpd_pair_name_parse("changed"), MPD_PAIR_NAME_CHANGED);
+
+	ck_assert_int_eq(mpd_pair_name_parse(""), MPD_PAIR_NAME_UNKNOWN);
+	ck_assert_int_eq(mpd_pair_name_parse("fil"), MPD_PAIR_NAME_UNKNOWN);
+	ck_assert_int_eq(mpd_pair_name_parse("FILE"), MPD_PAIR_NAME_UNKNOWN);
+	ck_assert_int_eq(mpd_pair_name_parse("songs2"), MPD_PAIR_NAME_UNKNOWN);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("pair_name");
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_pair_name_tags);
+	tcase_add_test(tc_core, test_pair_name_other);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
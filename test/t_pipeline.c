@@ -0,0 +1,215 @@
+#include "capture.h"
+#include <mpd/pipeline.h>
+#include <mpd/connection.h>
+#include <mpd/pair.h>
+#include <mpd/recv.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+
+#include <check.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct result {
+	const char *value;
+	bool success;
+	enum mpd_server_error server_error;
+	bool called;
+};
+
+static void
+receive_result(struct mpd_connection *c, void *ctx)
+{
+	struct result *r = ctx;
+	r->called = true;
+
+	struct mpd_pair *pair = mpd_recv_pair_named(c, "value");
+	if (pair != NULL) {
+		r->value = strdup(pair->value);
+		mpd_return_pair(c, pair);
+	}
+
+	r->success = mpd_response_finish(c);
+	if (!r->success)
+		r->server_error = mpd_connection_get_server_error(c);
+}
+
+/**
+ * A callback which reads all pairs until mpd_recv_pair() returns
+ * NULL, without calling mpd_response_finish().
+ */
+static void
+receive_all(struct mpd_connection *c, void *ctx)
+{
+	struct result *r = ctx;
+	r->called = true;
+
+	struct mpd_pair *pair;
+	while ((pair = mpd_recv_pair(c)) != NULL) {
+		free((char *)r->value);
+		r->value = strdup(pair->value);
+		mpd_return_pair(c, pair);
+	}
+
+	r->success = mpd_connection_get_error(c) == MPD_ERROR_SUCCESS;
+}
+
+START_TEST(test_pipeline_errors)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_pipeline *pipeline = mpd_pipeline_new(c, 8);
+	ck_assert_ptr_ne(pipeline, NULL);
+
+	struct result results[3];
+	memset(results, 0, sizeof(results));
+
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[0],
+				    "a", NULL));
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[1],
+				    "b", "x", NULL));
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[2],
+				    "c", NULL));
+	ck_assert_int_eq(mpd_pipeline_get_pending(pipeline), 3);
+	ck_assert(!results[0].called);
+
+	/* the middle command fails, but the others are not affected */
+	ck_assert(test_capture_send(&capture,
+				    "value: 1\nOK\n"
+				    "ACK [50@0] {b} No such song\n"
+				    "value: 3\nOK\n"));
+
+	ck_assert(mpd_pipeline_finish(pipeline));
+	ck_assert_str_eq(test_capture_receive(&capture),
+			 "a\nb \"x\"\nc\n");
+	ck_assert_int_eq(mpd_pipeline_get_pending(pipeline), 0);
+
+	ck_assert(results[0].success);
+	ck_assert_str_eq(results[0].value, "1");
+	ck_assert(!results[1].success);
+	ck_assert_int_eq(results[1].server_error, MPD_SERVER_ERROR_NO_EXIST);
+	ck_assert(results[2].success);
+	ck_assert_str_eq(results[2].value, "3");
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+
+	for (unsigned i = 0; i < 3; ++i)
+		free((char *)results[i].value);
+
+	mpd_pipeline_free(pipeline);
+
+	/* the connection is usable again */
+	ck_assert(mpd_send_command(c, "d", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "d\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_pipeline_window)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_pipeline *pipeline = mpd_pipeline_new(c, 2);
+	ck_assert_ptr_ne(pipeline, NULL);
+
+	/* the responses are already waiting in the socket */
+	ck_assert(test_capture_send(&capture, "OK\nOK\nOK\nOK\n"));
+
+	struct result results[4];
+	memset(results, 0, sizeof(results));
+
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[0],
+				    "a", NULL));
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[1],
+				    "b", NULL));
+
+	/* the window is full: this receives the first response */
+	ck_assert(mpd_pipeline_send(pipeline, receive_result, &results[2],
+				    "c", NULL));
+	ck_assert(results[0].called && results[0].success);
+	ck_assert(!results[1].called);
+	ck_assert_int_eq(mpd_pipeline_get_pending(pipeline), 2);
+
+	/* a command without callback */
+	ck_assert(mpd_pipeline_send(pipeline, NULL, NULL, "d", NULL));
+	ck_assert(results[1].called && results[1].success);
+
+	/* freeing discards the remaining responses */
+	mpd_pipeline_free(pipeline);
+	ck_assert(!results[2].called);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+
+	ck_assert_str_eq(test_capture_receive(&capture), "a\nb\nc\nd\n");
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_pipeline_read_to_null)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_pipeline *pipeline = mpd_pipeline_new(c, 8);
+	ck_assert_ptr_ne(pipeline, NULL);
+
+	struct result results[2];
+	memset(results, 0, sizeof(results));
+
+	ck_assert(mpd_pipeline_send(pipeline, receive_all, &results[0],
+				    "a", NULL));
+	ck_assert(mpd_pipeline_send(pipeline, receive_all, &results[1],
+				    "b", NULL));
+
+	ck_assert(test_capture_send(&capture, "x: 1\nOK\ny: 2\nOK\n"));
+
+	/* reading the first response to its end moves on to the
+	   second one */
+	ck_assert(mpd_pipeline_finish(pipeline));
+	ck_assert_str_eq(test_capture_receive(&capture), "a\nb\n");
+
+	ck_assert(results[0].success);
+	ck_assert_str_eq(results[0].value, "1");
+	ck_assert(results[1].success);
+	ck_assert_str_eq(results[1].value, "2");
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+
+	for (unsigned i = 0; i < 2; ++i)
+		free((char *)results[i].value);
+
+	mpd_pipeline_free(pipeline);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("pipeline");
+	TCase *tc_pipeline = tcase_create("pipeline");
+	tcase_add_test(tc_pipeline, test_pipeline_errors);
+	tcase_add_test(tc_pipeline, test_pipeline_window);
+	tcase_add_test(tc_pipeline, test_pipeline_read_to_null);
+	suite_add_tcase(s, tc_pipeline);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
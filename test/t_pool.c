@@ -0,0 +1,316 @@
+#include <mpd/pool.h>
+#include <mpd/connection.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include <mpd/settings.h>
+
+#include <check.h>
+
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+enum {
+	MAX_CLIENTS = 16,
+};
+
+/**
+ * A fake MPD server listening on a local socket, running in its own
+ * thread.  It responds "OK" to every command, and closes the
+ * connection on the command "close".
+ */
+struct server {
+	char directory[32];
+	char path[64];
+
+	int listen_fd, wake_fds[2];
+	pthread_t thread;
+
+	/** the number of accepted connections */
+	unsigned accepted;
+};
+
+static void
+server_handle_client(int *fd_p)
+{
+	char buffer[256];
+	ssize_t nbytes = recv(*fd_p, buffer, sizeof(buffer) - 1, 0);
+	if (nbytes <= 0) {
+		close(*fd_p);
+		*fd_p = -1;
+		return;
+	}
+
+	buffer[nbytes] = 0;
+	for (char *line = buffer, *end;
+	     (end = strchr(line, '\n')) != NULL; line = end + 1) {
+		*end = 0;
+		if (strcmp(line, "close") == 0) {
+			close(*fd_p);
+			*fd_p = -1;
+			return;
+		}
+
+		send(*fd_p, "OK\n", 3, MSG_NOSIGNAL);
+	}
+}
+
+static void *
+server_run(void *arg)
+{
+	struct server *server = arg;
+	int clients[MAX_CLIENTS];
+	unsigned n_clients = 0;
+
+	while (true) {
+		struct pollfd fds[2 + MAX_CLIENTS];
+		fds[0].fd = server->wake_fds[0];
+		fds[0].events = POLLIN;
+		fds[1].fd = server->listen_fd;
+		fds[1].events = POLLIN;
+		for (unsigned i = 0; i < n_clients; ++i) {
+			fds[2 + i].fd = clients[i];
+			fds[2 + i].events = POLLIN;
+		}
+
+		if (poll(fds, 2 + n_clients, -1) < 0)
+			break;
+
+		if (fds[0].revents != 0)
+			break;
+
+		for (unsigned i = 0; i < n_clients; ++i) {
+			if (fds[2 + i].revents == 0)
+				continue;
+
+			server_handle_client(&clients[i]);
+		}
+
+		/* remove closed clients */
+		unsigned n = 0;
+		for (unsigned i = 0; i < n_clients; ++i)
+			if (clients[i] >= 0)
+				clients[n++] = clients[i];
+		n_clients = n;
+
+		if (fds[1].revents != 0 && n_clients < MAX_CLIENTS) {
+			int fd = accept(server->listen_fd, NULL, NULL);
+			if (fd >= 0) {
+				send(fd, "OK MPD 0.21.0\n", 14, MSG_NOSIGNAL);
+				clients[n_clients++] = fd;
+				__atomic_add_fetch(&server->accepted, 1,
+						   __ATOMIC_RELAXED);
+			}
+		}
+	}
+
+	for (unsigned i = 0; i < n_clients; ++i)
+		close(clients[i]);
+	return NULL;
+}
+
+static void
+server_start(struct server *server)
+{
+	strcpy(server->directory, "/tmp/t_pool.XXXXXX");
+	ck_assert_ptr_ne(mkdtemp(server->directory), NULL);
+	snprintf(server->path, sizeof(server->path), "%s/socket",
+		 server->directory);
+
+	struct sockaddr_un address = { .sun_family = AF_LOCAL };
+	strcpy(address.sun_path, server->path);
+
+	server->listen_fd = socket(AF_LOCAL, SOCK_STREAM, 0);
+	ck_assert_int_ge(server->listen_fd, 0);
+	ck_assert_int_eq(bind(server->listen_fd, (struct sockaddr *)&address,
+			      sizeof(address)), 0);
+	ck_assert_int_eq(listen(server->listen_fd, MAX_CLIENTS), 0);
+	ck_assert_int_eq(pipe(server->wake_fds), 0);
+
+	server->accepted = 0;
+	ck_assert_int_eq(pthread_create(&server->thread, NULL,
+					server_run, server), 0);
+}
+
+static void
+server_stop(struct server *server)
+{
+	close(server->wake_fds[1]);
+	pthread_join(server->thread, NULL);
+	close(server->wake_fds[0]);
+	close(server->listen_fd);
+	unlink(server->path);
+	rmdir(server->directory);
+}
+
+static unsigned
+server_get_accepted(struct server *server)
+{
+	return __atomic_load_n(&server->accepted, __ATOMIC_RELAXED);
+}
+
+static struct mpd_pool *
+create_pool(const struct server *server, unsigned size)
+{
+	struct mpd_settings *settings =
+		mpd_settings_new(server->path, 0, 5000, NULL, NULL);
+	ck_assert_ptr_ne(settings, NULL);
+
+	struct mpd_pool *pool = mpd_pool_new(settings, size);
+	ck_assert_ptr_ne(pool, NULL);
+
+	mpd_settings_free(settings);
+	return pool;
+}
+
+static bool
+ping(struct mpd_connection *c)
+{
+	return mpd_send_command(c, "ping", NULL) &&
+		mpd_response_finish(c);
+}
+
+START_TEST(test_pool_reuse)
+{
+	struct server server;
+	server_start(&server);
+
+	struct mpd_pool *pool = create_pool(&server, 2);
+
+	struct mpd_connection *a = mpd_pool_get(pool);
+	ck_assert_ptr_ne(a, NULL);
+	ck_assert(ping(a));
+
+	struct mpd_connection *b = mpd_pool_get(pool);
+	ck_assert_ptr_ne(b, NULL);
+	ck_assert_ptr_ne(a, b);
+
+	/* all connections are in use */
+	ck_assert_ptr_eq(mpd_pool_get(pool), NULL);
+
+	mpd_pool_put(pool, a);
+	ck_assert_ptr_eq(mpd_pool_get(pool), a);
+	ck_assert(ping(a));
+
+	mpd_pool_put(pool, a);
+	mpd_pool_put(pool, b);
+
+	/* the connections were opened by mpd_pool_new() */
+	ck_assert_int_eq(server_get_accepted(&server), 2);
+
+	mpd_pool_free(pool);
+	server_stop(&server);
+}
+END_TEST
+
+START_TEST(test_pool_replace)
+{
+	struct server server;
+	server_start(&server);
+
+	struct mpd_pool *pool = create_pool(&server, 1);
+
+	struct mpd_connection *c = mpd_pool_get(pool);
+	ck_assert_ptr_ne(c, NULL);
+
+	/* the server closes the connection */
+	ck_assert(!(mpd_send_command(c, "close", NULL) &&
+		    mpd_response_finish(c)));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_CLOSED);
+	mpd_pool_put(pool, c);
+
+	c = mpd_pool_get(pool);
+	ck_assert_ptr_ne(c, NULL);
+	ck_assert(ping(c));
+	mpd_pool_put(pool, c);
+
+	ck_assert_int_eq(server_get_accepted(&server), 2);
+
+	mpd_pool_free(pool);
+	server_stop(&server);
+}
+END_TEST
+
+struct worker {
+	struct mpd_pool *pool;
+	unsigned n_pings;
+};
+
+static void *
+worker_run(void *arg)
+{
+	struct worker *worker = arg;
+
+	for (unsigned i = 0; i < 500; ++i) {
+		struct mpd_connection *c = mpd_pool_get(worker->pool);
+		if (c == NULL)
+			continue;
+
+		if (ping(c))
+			++worker->n_pings;
+		mpd_pool_put(worker->pool, c);
+	}
+
+	return NULL;
+}
+
+START_TEST(test_pool_threads)
+{
+	struct server server;
+	server_start(&server);
+
+	struct mpd_pool *pool = create_pool(&server, 2);
+
+	enum { N = 4 };
+	struct worker workers[N];
+	pthread_t threads[N];
+	for (unsigned i = 0; i < N; ++i) {
+		workers[i].pool = pool;
+		workers[i].n_pings = 0;
+		ck_assert_int_eq(pthread_create(&threads[i], NULL,
+						worker_run, &workers[i]), 0);
+	}
+
+	unsigned n_pings = 0;
+	for (unsigned i = 0; i < N; ++i) {
+		pthread_join(threads[i], NULL);
+		n_pings += workers[i].n_pings;
+	}
+
+	ck_assert_int_gt(n_pings, 0);
+
+	/* no connection was ever shared or replaced */
+	ck_assert_int_eq(server_get_accepted(&server), 2);
+
+	mpd_pool_free(pool);
+	server_stop(&server);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("pool");
+	TCase *tc_pool = tcase_create("pool");
+	tcase_add_test(tc_pool, test_pool_reuse);
+	tcase_add_test(tc_pool, test_pool_replace);
+	tcase_add_test(tc_pool, test_pool_threads);
+	suite_add_tcase(s, tc_pool);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
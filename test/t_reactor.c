@@ -0,0 +1,337 @@
+#include <mpd/reactor.h>
+#include <mpd/async.h>
+#include <mpd/pair.h>
+#include <mpd/song.h>
+#include <mpd/status.h>
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/**
+ * A fake MPD server: the other end of a socketpair.
+ */
+struct server {
+	int fd;
+	char buffer[4096];
+};
+
+static struct mpd_reactor_connection *
+add_connection(struct mpd_reactor *reactor, struct server *server)
+{
+	int sv[2];
+	ck_assert_int_eq(socketpair(AF_LOCAL, SOCK_STREAM, 0, sv), 0);
+	server->fd = sv[0];
+
+	struct mpd_async *async = mpd_async_new(sv[1]);
+	ck_assert_ptr_ne(async, NULL);
+
+	struct mpd_reactor_connection *c =
+		mpd_reactor_add(reactor, async, true);
+	ck_assert_ptr_ne(c, NULL);
+	return c;
+}
+
+static void
+server_send(struct server *server, const char *response)
+{
+	ck_assert_int_eq(send(server->fd, response, strlen(response), 0),
+			 strlen(response));
+}
+
+static const char *
+server_receive(struct server *server)
+{
+	ssize_t nbytes = recv(server->fd, server->buffer,
+			      sizeof(server->buffer) - 1, MSG_DONTWAIT);
+	if (nbytes < 0)
+		nbytes = 0;
+
+	server->buffer[nbytes] = 0;
+	return server->buffer;
+}
+
+/**
+ * Collects the results of one command.
+ */
+struct result {
+	unsigned n_pairs;
+	char last_value[64];
+
+	bool done;
+	enum mpd_error error;
+	enum mpd_server_error server_error;
+};
+
+static void
+pair_cb(const struct mpd_pair *pair, void *ctx)
+{
+	struct result *r = ctx;
+	++r->n_pairs;
+	snprintf(r->last_value, sizeof(r->last_value), "%s", pair->value);
+}
+
+static void
+done_cb(enum mpd_error error, enum mpd_server_error server_error,
+	const char *message, void *ctx)
+{
+	struct result *r = ctx;
+	ck_assert(!r->done);
+	ck_assert((error == MPD_ERROR_SUCCESS) == (message == NULL));
+	r->done = true;
+	r->error = error;
+	r->server_error = server_error;
+}
+
+START_TEST(test_reactor)
+{
+	enum { N = 3 };
+
+	struct mpd_reactor *reactor = mpd_reactor_new();
+	ck_assert_ptr_ne(reactor, NULL);
+
+	struct server servers[N];
+	struct mpd_reactor_connection *connections[N];
+	struct result status[N], stats[N];
+	memset(status, 0, sizeof(status));
+	memset(stats, 0, sizeof(stats));
+
+	for (unsigned i = 0; i < N; ++i) {
+		connections[i] = add_connection(reactor, &servers[i]);
+		server_send(&servers[i], "OK MPD 0.21.0\n");
+
+		/* two pipelined commands */
+		ck_assert(mpd_reactor_send(connections[i], pair_cb, done_cb,
+					   &status[i], "status", NULL));
+		ck_assert(mpd_reactor_send(connections[i], pair_cb, done_cb,
+					   &stats[i], "stats", NULL));
+	}
+
+	ck_assert_int_ge(mpd_reactor_dispatch(reactor, 0), 0);
+
+	for (unsigned i = 0; i < N; ++i) {
+		ck_assert_str_eq(server_receive(&servers[i]),
+				 "status\nstats\n");
+		server_send(&servers[i], "volume: 50\nstate: play\nOK\n");
+		server_send(&servers[i], i == 1
+			    ? "ACK [5@0] {stats} unknown command\n"
+			    : "songs: 42\nOK\n");
+	}
+
+	while (!stats[0].done || !stats[1].done || !stats[2].done)
+		ck_assert_int_ge(mpd_reactor_dispatch(reactor, 1000), 0);
+
+	for (unsigned i = 0; i < N; ++i) {
+		ck_assert(status[i].done);
+		ck_assert_int_eq(status[i].error, MPD_ERROR_SUCCESS);
+		ck_assert_int_eq(status[i].n_pairs, 2);
+		ck_assert_str_eq(status[i].last_value, "play");
+
+		if (i == 1) {
+			ck_assert_int_eq(stats[i].error, MPD_ERROR_SERVER);
+			ck_assert_int_eq(stats[i].server_error,
+					 MPD_SERVER_ERROR_UNKNOWN_CMD);
+		} else {
+			ck_assert_int_eq(stats[i].error, MPD_ERROR_SUCCESS);
+			ck_assert_str_eq(stats[i].last_value, "42");
+		}
+
+		ck_assert_int_eq(mpd_reactor_connection_get_error(connections[i]),
+				 MPD_ERROR_SUCCESS);
+	}
+
+	mpd_reactor_free(reactor);
+
+	for (unsigned i = 0; i < N; ++i)
+		close(servers[i].fd);
+}
+END_TEST
+
+START_TEST(test_reactor_hangup)
+{
+	struct mpd_reactor *reactor = mpd_reactor_new();
+	ck_assert_ptr_ne(reactor, NULL);
+
+	struct server server;
+	struct mpd_reactor_connection *c = add_connection(reactor, &server);
+	server_send(&server, "OK MPD 0.21.0\n");
+
+	struct result idle;
+	memset(&idle, 0, sizeof(idle));
+	ck_assert(mpd_reactor_send(c, pair_cb, done_cb, &idle, "idle", NULL));
+	ck_assert_int_ge(mpd_reactor_dispatch(reactor, 0), 0);
+	ck_assert_str_eq(server_receive(&server), "idle\n");
+
+	/* the response arrives together with the hangup */
+	server_send(&server, "changed: player\n");
+	close(server.fd);
+
+	while (!idle.done)
+		ck_assert_int_ge(mpd_reactor_dispatch(reactor, 1000), 0);
+
+	ck_assert_int_eq(idle.n_pairs, 1);
+	ck_assert_int_eq(idle.error, MPD_ERROR_CLOSED);
+	ck_assert_int_eq(mpd_reactor_connection_get_error(c),
+			 MPD_ERROR_CLOSED);
+
+	/* a failed connection does not accept commands */
+	ck_assert(!mpd_reactor_send(c, NULL, NULL, NULL, "status", NULL));
+
+	mpd_reactor_remove(c);
+	mpd_reactor_free(reactor);
+}
+END_TEST
+
+static void
+remove_done_cb(mpd_unused enum mpd_error error,
+	       mpd_unused enum mpd_server_error server_error,
+	       mpd_unused const char *message, void *ctx)
+{
+	mpd_reactor_remove(ctx);
+}
+
+START_TEST(test_reactor_remove_in_callback)
+{
+	struct mpd_reactor *reactor = mpd_reactor_new();
+	ck_assert_ptr_ne(reactor, NULL);
+
+	struct server server;
+	struct mpd_reactor_connection *c = add_connection(reactor, &server);
+	server_send(&server, "OK MPD 0.21.0\n");
+
+	struct result second;
+	memset(&second, 0, sizeof(second));
+	ck_assert(mpd_reactor_send(c, NULL, remove_done_cb, c, "ping", NULL));
+	ck_assert(mpd_reactor_send(c, NULL, done_cb, &second, "ping", NULL));
+	ck_assert_int_ge(mpd_reactor_dispatch(reactor, 0), 0);
+
+	server_send(&server, "OK\nOK\n");
+	while (!second.done)
+		ck_assert_int_ge(mpd_reactor_dispatch(reactor, 1000), 0);
+
+	/* removing the connection has cancelled the second command */
+	ck_assert_int_eq(second.error, MPD_ERROR_CLOSED);
+
+	mpd_reactor_free(reactor);
+	close(server.fd);
+}
+END_TEST
+
+/**
+ * Collects the results of typed commands.
+ */
+struct typed_result {
+	unsigned n_songs;
+	char last_uri[64];
+
+	int volume;
+
+	struct result result;
+};
+
+static void
+song_cb(struct mpd_song *song, void *ctx)
+{
+	struct typed_result *r = ctx;
+	ck_assert(!r->result.done);
+	++r->n_songs;
+	snprintf(r->last_uri, sizeof(r->last_uri), "%s", mpd_song_get_uri(song));
+	mpd_song_free(song);
+}
+
+static void
+status_cb(struct mpd_status *status, void *ctx)
+{
+	struct typed_result *r = ctx;
+	ck_assert(!r->result.done);
+	r->volume = mpd_status_get_volume(status);
+	mpd_status_free(status);
+}
+
+static void
+typed_done_cb(enum mpd_error error, enum mpd_server_error server_error,
+	      const char *message, void *ctx)
+{
+	struct typed_result *r = ctx;
+	done_cb(error, server_error, message, &r->result);
+}
+
+START_TEST(test_reactor_typed)
+{
+	struct mpd_reactor *reactor = mpd_reactor_new();
+	ck_assert_ptr_ne(reactor, NULL);
+
+	struct server server;
+	struct mpd_reactor_connection *c = add_connection(reactor, &server);
+	server_send(&server, "OK MPD 0.21.0\n");
+
+	struct typed_result songs, status, failed;
+	memset(&songs, 0, sizeof(songs));
+	memset(&status, 0, sizeof(status));
+	memset(&failed, 0, sizeof(failed));
+	status.volume = -2;
+
+	ck_assert(mpd_reactor_send_songs(c, song_cb, typed_done_cb, &songs,
+					 "playlistinfo", NULL));
+	ck_assert(mpd_reactor_send_status(c, status_cb, typed_done_cb,
+					  &status));
+	ck_assert(mpd_reactor_send_songs(c, song_cb, typed_done_cb, &failed,
+					 "find", "foo", NULL));
+	ck_assert_int_ge(mpd_reactor_dispatch(reactor, 0), 0);
+	ck_assert_str_eq(server_receive(&server),
+			 "playlistinfo\nstatus\nfind \"foo\"\n");
+
+	server_send(&server,
+		    "file: a.flac\nTitle: A\nfile: b.flac\nTitle: B\nOK\n"
+		    "volume: 42\nstate: play\nOK\n"
+		    "file: c.flac\nACK [2@0] {find} incorrect arguments\n");
+
+	while (!failed.result.done)
+		ck_assert_int_ge(mpd_reactor_dispatch(reactor, 1000), 0);
+
+	ck_assert_int_eq(songs.result.error, MPD_ERROR_SUCCESS);
+	ck_assert_int_eq(songs.n_songs, 2);
+	ck_assert_str_eq(songs.last_uri, "b.flac");
+
+	ck_assert_int_eq(status.result.error, MPD_ERROR_SUCCESS);
+	ck_assert_int_eq(status.volume, 42);
+
+	/* the incomplete song is discarded */
+	ck_assert_int_eq(failed.result.error, MPD_ERROR_SERVER);
+	ck_assert_int_eq(failed.result.server_error, MPD_SERVER_ERROR_ARG);
+	ck_assert_int_eq(failed.n_songs, 0);
+
+	mpd_reactor_free(reactor);
+	close(server.fd);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("reactor");
+
+	TCase *tc_reactor = tcase_create("reactor");
+	tcase_add_test(tc_reactor, test_reactor);
+	tcase_add_test(tc_reactor, test_reactor_hangup);
+	tcase_add_test(tc_reactor, test_reactor_remove_in_callback);
+	tcase_add_test(tc_reactor, test_reactor_typed);
+	suite_add_tcase(s, tc_reactor);
+
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,645 @@
+#include "capture.h"
+#include <mpd/connection.h>
+#include <mpd/async.h>
+#include <mpd/response.h>
+#include <mpd/recv.h>
+#include <mpd/send.h>
+#include <mpd/pair.h>
+#include <mpd/error.h>
+#include <mpd/list.h>
+#include <mpd/song.h>
+#include <mpd/arena.h>
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * Sends a "name: value" line whose value consists of #length 'x'
+ * characters, followed by "OK".
+ */
+static void
+send_long_pair(struct test_capture *capture, size_t length)
+{
+	char *response = malloc(length + 32);
+	ck_assert_ptr_ne(response, NULL);
+
+	strcpy(response, "Comment: ");
+	char *p = response + strlen(response);
+	memset(p, 'x', length);
+	strcpy(p + length, "\nOK\n");
+
+	ck_assert(test_capture_send(capture, response));
+	free(response);
+}
+
+START_TEST(test_long_line)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+	send_long_pair(&capture, 100000);
+
+	struct mpd_pair *pair = mpd_recv_pair(c);
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_str_eq(pair->name, "Comment");
+	ck_assert_int_eq(strlen(pair->value), 100000);
+	ck_assert_int_eq(pair->value[99999], 'x');
+	mpd_return_pair(c, pair);
+
+	ck_assert(mpd_response_finish(c));
+
+	/* the connection is still usable with a small buffer */
+	ck_assert(mpd_send_command(c, "bar", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "bar\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_many_lines)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+	/* more than fits into the initial buffer, so lines wrap
+	   around its end */
+	enum { N = 2000 };
+	static char response[N * 16 + 4];
+	char *p = response;
+	for (unsigned i = 0; i < N; ++i)
+		p += sprintf(p, "Track: %u\n", i);
+	strcpy(p, "OK\n");
+
+	ck_assert(test_capture_send(&capture, response));
+
+	for (unsigned i = 0; i < N; ++i) {
+		struct mpd_pair *pair = mpd_recv_pair(c);
+		ck_assert_ptr_ne(pair, NULL);
+		ck_assert_str_eq(pair->name, "Track");
+		ck_assert_int_eq(strtoul(pair->value, NULL, 10), i);
+		mpd_return_pair(c, pair);
+	}
+
+	ck_assert_ptr_eq(mpd_recv_pair(c), NULL);
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_ring_buffer)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	if (!mpd_async_set_ring_buffer(mpd_connection_get_async(c))) {
+		/* not supported on this platform */
+		mpd_connection_free(c);
+		test_capture_deinit(&capture);
+		return;
+	}
+
+	/* short lines wrapping around the end of the ring, and long
+	   lines which make it grow */
+	for (unsigned n = 0; n < 3; ++n) {
+		ck_assert(mpd_send_command(c, "foo", NULL));
+		ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+		enum { N = 2000 };
+		static char response[N * 16 + 4];
+		char *p = response;
+		for (unsigned i = 0; i < N; ++i)
+			p += sprintf(p, "Track: %u\n", i);
+		strcpy(p, "OK\n");
+		ck_assert(test_capture_send(&capture, response));
+
+		for (unsigned i = 0; i < N; ++i) {
+			struct mpd_pair *pair = mpd_recv_pair(c);
+			ck_assert_ptr_ne(pair, NULL);
+			ck_assert_int_eq(strtoul(pair->value, NULL, 10), i);
+			mpd_return_pair(c, pair);
+		}
+
+		ck_assert(mpd_response_finish(c));
+
+		ck_assert(mpd_send_command(c, "bar", NULL));
+		ck_assert_str_eq(test_capture_receive(&capture), "bar\n");
+		send_long_pair(&capture, 20000 * (n + 1));
+
+		struct mpd_pair *pair = mpd_recv_pair(c);
+		ck_assert_ptr_ne(pair, NULL);
+		ck_assert_int_eq(strlen(pair->value), 20000 * (n + 1));
+		mpd_return_pair(c, pair);
+		ck_assert(mpd_response_finish(c));
+	}
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_line_too_long)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	mpd_async_set_input_buffer_limit(mpd_connection_get_async(c), 8192);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+	send_long_pair(&capture, 10000);
+
+	ck_assert_ptr_eq(mpd_recv_pair(c), NULL);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_MALFORMED);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_pairs)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+	enum { N = 2000 };
+	static char response[N * 16 + 4];
+	char *p = response;
+	for (unsigned i = 0; i < N; ++i)
+		p += sprintf(p, "Track: %u\n", i);
+	strcpy(p, "OK\n");
+
+	ck_assert(test_capture_send(&capture, response));
+
+	struct mpd_pair pairs[64];
+	unsigned n, total = 0;
+	while ((n = mpd_recv_pairs(c, pairs, 64)) > 0) {
+		for (unsigned i = 0; i < n; ++i) {
+			ck_assert_str_eq(pairs[i].name, "Track");
+			ck_assert_int_eq(strtoul(pairs[i].value, NULL, 10),
+					 total + i);
+		}
+
+		total += n;
+	}
+
+	ck_assert_int_eq(total, N);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_pairs_ack)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+	ck_assert(test_capture_send(&capture,
+				    "a: 1\nb: 2\nACK [5@0] {foo} bar\n"));
+
+	struct mpd_pair pairs[8];
+	ck_assert_int_eq(mpd_recv_pairs(c, pairs, 8), 2);
+	ck_assert_str_eq(pairs[0].name, "a");
+	ck_assert_str_eq(pairs[1].value, "2");
+
+	ck_assert_int_eq(mpd_recv_pairs(c, pairs, 8), 0);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SERVER);
+	ck_assert_int_eq(mpd_connection_get_server_error(c), 5);
+	ck_assert(mpd_connection_clear_error(c));
+
+	/* the next response starts fresh */
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+	ck_assert(test_capture_send(&capture, "c: 3\nOK\n"));
+
+	ck_assert_int_eq(mpd_recv_pairs(c, pairs, 8), 1);
+	ck_assert_str_eq(pairs[0].name, "c");
+	ck_assert_int_eq(mpd_recv_pairs(c, pairs, 8), 0);
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+enum {
+	BINARY_LENGTH = 100000,
+};
+
+/**
+ * Sends a "binary" response with #BINARY_LENGTH bytes of payload,
+ * and receives the "binary" pair.
+ */
+static void
+send_binary(struct test_capture *capture, struct mpd_connection *c)
+{
+	static char response[BINARY_LENGTH + 64];
+	char *p = response + sprintf(response, "binary: %u\n",
+				     (unsigned)BINARY_LENGTH);
+	for (unsigned i = 0; i < BINARY_LENGTH; ++i)
+		*p++ = 'a' + i % 26;
+	strcpy(p, "\nOK\n");
+
+	ck_assert(mpd_send_command(c, "albumart", "foo", "0", NULL));
+	ck_assert_str_eq(test_capture_receive(capture),
+			 "albumart \"foo\" \"0\"\n");
+	ck_assert(test_capture_send(capture, response));
+
+	struct mpd_pair *pair = mpd_recv_pair_named(c, "binary");
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_int_eq(strtoul(pair->value, NULL, 10), BINARY_LENGTH);
+	mpd_return_pair(c, pair);
+}
+
+static void
+check_binary(const char *data)
+{
+	for (unsigned i = 0; i < BINARY_LENGTH; ++i)
+		ck_assert_int_eq(data[i], 'a' + i % 26);
+}
+
+START_TEST(test_binary)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	send_binary(&capture, c);
+
+	static char data[BINARY_LENGTH];
+	ck_assert(mpd_recv_binary(c, data, sizeof(data)));
+	check_binary(data);
+
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_binary_to_fd)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	send_binary(&capture, c);
+
+	FILE *file = tmpfile();
+	ck_assert_ptr_ne(file, NULL);
+
+	ck_assert(mpd_recv_binary_to_fd(c, fileno(file), BINARY_LENGTH));
+	ck_assert(mpd_response_finish(c));
+
+	static char data[BINARY_LENGTH + 1];
+	rewind(file);
+	ck_assert_int_eq(fread(data, 1, sizeof(data), file), BINARY_LENGTH);
+	check_binary(data);
+	fclose(file);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_binary_to_append_fd)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	send_binary(&capture, c);
+
+	/* splice() refuses to write to a file in append mode */
+	char path[] = "/tmp/t_recv.XXXXXX";
+	const int fd = mkstemp(path);
+	ck_assert_int_ge(fd, 0);
+	const int out = open(path, O_WRONLY|O_APPEND);
+	ck_assert_int_ge(out, 0);
+	unlink(path);
+
+	ck_assert(mpd_recv_binary_to_fd(c, out, BINARY_LENGTH));
+	ck_assert(mpd_response_finish(c));
+	close(out);
+
+	static char data[BINARY_LENGTH + 1];
+	ck_assert_int_eq(pread(fd, data, sizeof(data), 0), BINARY_LENGTH);
+	check_binary(data);
+	close(fd);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_binary_to_full_fd)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	send_binary(&capture, c);
+
+	/* a non-blocking pipe which nobody reads fails with EAGAIN
+	   instead of blocking forever */
+	int fds[2];
+	ck_assert_int_eq(pipe(fds), 0);
+	ck_assert_int_eq(fcntl(fds[1], F_SETFL, O_NONBLOCK), 0);
+#ifdef F_SETPIPE_SZ
+	fcntl(fds[1], F_SETPIPE_SZ, 4096);
+#endif
+
+	ck_assert(!mpd_recv_binary_to_fd(c, fds[1], BINARY_LENGTH));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SYSTEM);
+	ck_assert_int_eq(mpd_connection_get_system_error(c), EAGAIN);
+
+	close(fds[0]);
+	close(fds[1]);
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+struct songs_ctx {
+	unsigned n;
+
+	/** stop after this many songs */
+	unsigned max;
+
+	struct mpd_song *first;
+};
+
+static bool
+songs_callback(const struct mpd_song *song, void *_ctx)
+{
+	struct songs_ctx *ctx = _ctx;
+	char buffer[16];
+
+	switch (ctx->n++) {
+	case 0:
+		ck_assert_str_eq(mpd_song_get_uri(song), "a.mp3");
+		for (unsigned i = 0; i < 100; ++i) {
+			sprintf(buffer, "A%u", i);
+			ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST,
+							  i), buffer);
+		}
+
+		ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 100),
+				 NULL);
+		ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_TITLE, 0),
+				 "T");
+		ck_assert_uint_eq(mpd_song_get_duration(song), 42);
+
+		ctx->first = mpd_song_dup(song);
+		ck_assert_ptr_ne(ctx->first, NULL);
+		break;
+
+	case 1:
+		ck_assert_str_eq(mpd_song_get_uri(song), "b.ogg");
+		ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 0),
+				 NULL);
+		ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_TITLE, 0),
+				 "U");
+		ck_assert_uint_eq(mpd_song_get_duration_ms(song), 1500);
+		break;
+
+	case 2:
+		ck_assert_str_eq(mpd_song_get_uri(song), "c.flac");
+		ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_TITLE, 0),
+				 NULL);
+		break;
+	}
+
+	return ctx->n < ctx->max;
+}
+
+static void
+send_songs(struct test_capture *capture)
+{
+	static char response[4096];
+	char *p = response;
+
+	/* the first song spans multiple mpd_recv_pairs() calls */
+	p += sprintf(p, "directory: d\nfile: a.mp3\n");
+	for (unsigned i = 0; i < 100; ++i)
+		p += sprintf(p, "Artist: A%u\n", i);
+	strcpy(p, "Title: T\nTime: 42\n"
+	       "file: b.ogg\nTitle: U\nduration: 1.5\n"
+	       "file: c.flac\nOK\n");
+
+	ck_assert(test_capture_send(capture, response));
+}
+
+START_TEST(test_songs_cb)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+	send_songs(&capture);
+
+	struct songs_ctx ctx = { .n = 0, .max = 100, .first = NULL };
+	ck_assert(mpd_recv_songs_cb(c, songs_callback, &ctx));
+	ck_assert_uint_eq(ctx.n, 3);
+	ck_assert(mpd_response_finish(c));
+
+	/* the copy survives the view */
+	ck_assert_ptr_ne(ctx.first, NULL);
+	ck_assert_str_eq(mpd_song_get_uri(ctx.first), "a.mp3");
+	ck_assert_str_eq(mpd_song_get_tag(ctx.first, MPD_TAG_ARTIST, 99),
+			 "A99");
+	mpd_song_free(ctx.first);
+
+	/* stop after the first song */
+	ck_assert(mpd_send_command(c, "bar", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "bar\n");
+	send_songs(&capture);
+
+	ctx = (struct songs_ctx){ .n = 0, .max = 1, .first = NULL };
+	ck_assert(mpd_recv_songs_cb(c, songs_callback, &ctx));
+	ck_assert_uint_eq(ctx.n, 1);
+	mpd_song_free(ctx.first);
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_song_arena)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	struct mpd_arena *arena = mpd_arena_new();
+	ck_assert_ptr_ne(arena, NULL);
+
+	for (unsigned i = 0; i < 2; ++i) {
+		ck_assert(mpd_send_command(c, "foo", NULL));
+		ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+		send_songs(&capture);
+
+		struct mpd_song *songs[4];
+		unsigned n = 0;
+		while (n < 4 &&
+		       (songs[n] = mpd_recv_song_arena(c, arena)) != NULL)
+			++n;
+
+		ck_assert_uint_eq(n, 3);
+		ck_assert(mpd_response_finish(c));
+
+		/* all songs are still valid */
+		ck_assert_str_eq(mpd_song_get_uri(songs[0]), "a.mp3");
+		ck_assert_str_eq(mpd_song_get_tag(songs[0], MPD_TAG_ARTIST, 99),
+				 "A99");
+		ck_assert_uint_eq(mpd_song_get_duration(songs[0]), 42);
+		ck_assert_str_eq(mpd_song_get_uri(songs[1]), "b.ogg");
+		ck_assert_str_eq(mpd_song_get_tag(songs[1], MPD_TAG_TITLE, 0),
+				 "U");
+		ck_assert_str_eq(mpd_song_get_uri(songs[2]), "c.flac");
+
+		/* this is a no-op for songs in an arena */
+		mpd_song_free(songs[1]);
+
+		/* a copy outlives the arena */
+		struct mpd_song *copy = mpd_song_dup(songs[0]);
+		mpd_arena_reset(arena);
+		ck_assert_str_eq(mpd_song_get_tag(copy, MPD_TAG_TITLE, 0),
+				 "T");
+		mpd_song_free(copy);
+	}
+
+	mpd_arena_free(arena);
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_finish_skip)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+
+	ck_assert(mpd_send_command(c, "foo", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "foo\n");
+
+	/* lines which resemble the end of the response, a line
+	   larger than the input buffer and a binary chunk which
+	   contains "OK" lines */
+	static char response[64 * 1024];
+	char *p = response;
+	p += sprintf(p, "file: a\nOther: x\nAlbum: y\nlist: z\nbin: 1\n"
+		     "OKAY: 1\nOK \nACKNOWLEDGED: 2\n\nComment: ");
+	memset(p, 'x', 10000);
+	p += 10000;
+	p += sprintf(p, "\nbinary: 9\n\nOK\nACK \n\n");
+	for (unsigned i = 0; i < 1000; ++i)
+		p += sprintf(p, "Track: %u\n", i);
+	strcpy(p, "OK\n");
+	ck_assert(test_capture_send(&capture, response));
+
+	struct mpd_pair *pair = mpd_recv_pair(c);
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_str_eq(pair->name, "file");
+	mpd_return_pair(c, pair);
+
+	ck_assert(mpd_response_finish(c));
+
+	/* the next response starts in the right place */
+	ck_assert(mpd_send_command(c, "bar", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "bar\n");
+	ck_assert(test_capture_send(&capture, "a: 1\nb: 2\n"
+				    "ACK [50@0] {bar} No such song\n"));
+	ck_assert(!mpd_response_finish(c));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SERVER);
+	ck_assert_int_eq(mpd_connection_get_server_error(c),
+			 MPD_SERVER_ERROR_NO_EXIST);
+	ck_assert(mpd_connection_clear_error(c));
+
+	/* a command list with list_OK lines */
+	ck_assert(mpd_command_list_begin(c, true));
+	ck_assert(mpd_send_command(c, "a", NULL));
+	ck_assert(mpd_send_command(c, "b", NULL));
+	ck_assert(mpd_command_list_end(c));
+	ck_assert_str_eq(test_capture_receive(&capture),
+			 "command_list_ok_begin\na\nb\ncommand_list_end\n");
+	ck_assert(test_capture_send(&capture,
+				    "x: 1\nlist_OK\ny: 2\nlist_OK\nOK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	ck_assert(mpd_send_command(c, "baz", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "baz\n");
+	ck_assert(test_capture_send(&capture, "c: 3\nOK\n"));
+	pair = mpd_recv_pair(c);
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_str_eq(pair->value, "3");
+	mpd_return_pair(c, pair);
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("recv");
+
+	TCase *tc_buffer = tcase_create("buffer");
+	tcase_add_test(tc_buffer, test_long_line);
+	tcase_add_test(tc_buffer, test_many_lines);
+	tcase_add_test(tc_buffer, test_ring_buffer);
+	tcase_add_test(tc_buffer, test_line_too_long);
+	suite_add_tcase(s, tc_buffer);
+
+	TCase *tc_pairs = tcase_create("pairs");
+	tcase_add_test(tc_pairs, test_pairs);
+	tcase_add_test(tc_pairs, test_pairs_ack);
+	tcase_add_test(tc_pairs, test_songs_cb);
+	tcase_add_test(tc_pairs, test_song_arena);
+	tcase_add_test(tc_pairs, test_finish_skip);
+	suite_add_tcase(s, tc_pairs);
+
+	TCase *tc_binary = tcase_create("binary");
+	tcase_add_test(tc_binary, test_binary);
+	tcase_add_test(tc_binary, test_binary_to_fd);
+	tcase_add_test(tc_binary, test_binary_to_append_fd);
+	tcase_add_test(tc_binary, test_binary_to_full_fd);
+	suite_add_tcase(s, tc_binary);
+
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
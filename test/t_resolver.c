@@ -0,0 +1,91 @@
+#include "resolver.h"
+
+#include <check.h>
+
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+
+START_TEST(test_resolver_numeric)
+{
+	struct resolver *resolver;
+	ck_assert(resolver_new_nonblocking("127.0.0.1", 6600, &resolver));
+	ck_assert_ptr_ne(resolver, NULL);
+
+	const struct resolver_address *address = resolver_next(resolver);
+	ck_assert_ptr_ne(address, NULL);
+	ck_assert_int_eq(address->family, AF_INET);
+	resolver_free(resolver);
+
+	/* a host name needs a DNS lookup */
+	resolver_cache_clear();
+	ck_assert(!resolver_new_nonblocking("localhost", 6600, &resolver));
+}
+END_TEST
+
+START_TEST(test_resolver_cache)
+{
+	resolver_cache_clear();
+
+	struct resolver *a = resolver_new("localhost", 6600);
+	ck_assert_ptr_ne(a, NULL);
+
+	/* the second lookup is answered from the cache */
+	struct resolver *b;
+	ck_assert(resolver_new_nonblocking("localhost", 6600, &b));
+	ck_assert_ptr_ne(b, NULL);
+	ck_assert_ptr_eq(resolver_next(a)->addr, resolver_next(b)->addr);
+
+	/* the entry survives the cache being cleared while in use */
+	resolver_cache_clear();
+	resolver_free(a);
+	resolver_free(b);
+
+	/* a different port is a different entry */
+	ck_assert(!resolver_new_nonblocking("localhost", 6601, &b));
+}
+END_TEST
+
+START_TEST(test_resolver_async_immediate)
+{
+	/* no thread is needed for a numeric address */
+	struct resolver_async *ra = resolver_async_new("::1", 6600);
+	ck_assert_ptr_ne(ra, NULL);
+	ck_assert(resolver_async_is_done(ra));
+
+	struct pollfd pfd = {
+		.fd = resolver_async_get_fd(ra),
+		.events = POLLIN,
+	};
+	ck_assert_int_eq(poll(&pfd, 1, 0), 1);
+
+	struct resolver *resolver = resolver_async_take(ra);
+	ck_assert_ptr_ne(resolver, NULL);
+	ck_assert_int_eq(resolver_next(resolver)->family, AF_INET6);
+	resolver_free(resolver);
+	resolver_async_free(ra);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("resolver");
+	TCase *tc_resolver = tcase_create("resolver");
+	tcase_add_test(tc_resolver, test_resolver_numeric);
+	tcase_add_test(tc_resolver, test_resolver_cache);
+	tcase_add_test(tc_resolver, test_resolver_async_immediate);
+	suite_add_tcase(s, tc_resolver);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
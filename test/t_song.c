@@ -0,0 +1,116 @@
+#include <mpd/audio_format.h>
+#include <mpd/pair.h>
+#include <mpd/song.h>
+
+#include <check.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static struct mpd_song *
+parse_song(const struct mpd_pair *pairs, unsigned n)
+{
+	struct mpd_song *song = mpd_song_begin(&pairs[0]);
+	ck_assert_ptr_ne(song, NULL);
+
+	for (unsigned i = 1; i < n; ++i)
+		ck_assert(mpd_song_feed(song, &pairs[i]));
+
+	return song;
+}
+
+static void
+check_song(const struct mpd_song *song)
+{
+	ck_assert_str_eq(mpd_song_get_uri(song), "foo/bar.ogg");
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 0), "A1");
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 1), "A2");
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 2), "A3");
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_ARTIST, 3), NULL);
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_TITLE, 0), "T");
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_TITLE, 1), NULL);
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_CONDUCTOR, 0), "C");
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_ALBUM, 0), NULL);
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_COUNT, 0), NULL);
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_UNKNOWN, 0), NULL);
+	ck_assert_uint_eq(mpd_song_get_duration(song), 42);
+	ck_assert_uint_eq(mpd_song_get_id(song), 7);
+
+	const struct mpd_audio_format *af = mpd_song_get_audio_format(song);
+	ck_assert_ptr_ne(af, NULL);
+	ck_assert_uint_eq(af->sample_rate, 44100);
+}
+
+START_TEST(test_song_tags)
+{
+	/* tags out of order, and multiple values interleaved with
+	   other tags */
+	static const struct mpd_pair pairs[] = {
+		{ "file", "foo/bar.ogg" },
+		{ "Conductor", "C" },
+		{ "Artist", "A1" },
+		{ "Title", "T" },
+		{ "Artist", "A2" },
+		{ "Time", "42" },
+		{ "Album", "" },
+		{ "Artist", "A3" },
+		{ "Id", "7" },
+		{ "Format", "44100:16:2" },
+	};
+
+	struct mpd_song *song = parse_song(pairs,
+					   sizeof(pairs) / sizeof(pairs[0]));
+	check_song(song);
+
+	struct mpd_song *copy = mpd_song_dup(song);
+	mpd_song_free(song);
+	ck_assert_ptr_ne(copy, NULL);
+	check_song(copy);
+	mpd_song_free(copy);
+}
+END_TEST
+
+START_TEST(test_song_many_tags)
+{
+	struct mpd_pair pairs[1001];
+	static char values[1000][16];
+
+	pairs[0] = (struct mpd_pair){ "file", "foo.ogg" };
+	for (unsigned i = 0; i < 1000; ++i) {
+		snprintf(values[i], sizeof(values[i]), "%u", i);
+		pairs[i + 1] = (struct mpd_pair){
+			i % 2 ? "Genre" : "Comment",
+			values[i],
+		};
+	}
+
+	struct mpd_song *song = parse_song(pairs, 1001);
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_COMMENT, 0), "0");
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_COMMENT, 499), "998");
+	ck_assert_str_eq(mpd_song_get_tag(song, MPD_TAG_GENRE, 499), "999");
+	ck_assert_ptr_eq(mpd_song_get_tag(song, MPD_TAG_GENRE, 500), NULL);
+	mpd_song_free(song);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("song");
+	TCase *tc_core = tcase_create("Core");
+	tcase_add_test(tc_core, test_song_tags);
+	tcase_add_test(tc_core, test_song_many_tags);
+	suite_add_tcase(s, tc_core);
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,353 @@
+#include "capture.h"
+#include <mpd/connection.h>
+#include <mpd/recv.h>
+#include <mpd/response.h>
+#include <mpd/send.h>
+#include <mpd/pair.h>
+
+#include <check.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+enum {
+	/** a file descriptor number beyond FD_SETSIZE */
+	HIGH_FD = 1100,
+};
+
+static int low_fds[HIGH_FD];
+static unsigned n_low_fds;
+
+/**
+ * Occupies all file descriptors up to #HIGH_FD, so the next socket
+ * lands beyond FD_SETSIZE.
+ */
+static void
+occupy_low_fds(void)
+{
+	struct rlimit rl;
+	ck_assert_int_eq(getrlimit(RLIMIT_NOFILE, &rl), 0);
+
+	if (rl.rlim_cur < HIGH_FD + 16) {
+		ck_assert(rl.rlim_max >= HIGH_FD + 16);
+		rl.rlim_cur = HIGH_FD + 16;
+		ck_assert_int_eq(setrlimit(RLIMIT_NOFILE, &rl), 0);
+	}
+
+	n_low_fds = 0;
+	while (true) {
+		int fd = dup(STDIN_FILENO);
+		ck_assert_int_ge(fd, 0);
+		low_fds[n_low_fds++] = fd;
+
+		if (fd >= HIGH_FD)
+			break;
+	}
+}
+
+static void
+release_low_fds(void)
+{
+	for (unsigned i = 0; i < n_low_fds; ++i)
+		close(low_fds[i]);
+}
+
+START_TEST(test_high_fd)
+{
+	occupy_low_fds();
+
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+	ck_assert_int_gt(mpd_connection_get_fd(c), HIGH_FD);
+
+	mpd_connection_set_timeout(c, 5000);
+
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+	release_low_fds();
+}
+END_TEST
+
+START_TEST(test_high_fd_timeout)
+{
+	occupy_low_fds();
+
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+	ck_assert_int_gt(mpd_connection_get_fd(c), HIGH_FD);
+
+	mpd_connection_set_timeout(c, 100);
+
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+
+	/* no response */
+	ck_assert(!mpd_response_finish(c));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_TIMEOUT);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+	release_low_fds();
+}
+END_TEST
+
+/**
+ * Receives everything the client has sent so far.
+ */
+static char *
+receive_all(struct test_capture *capture, size_t max_length)
+{
+	char *buffer = malloc(max_length + 1);
+	ck_assert_ptr_ne(buffer, NULL);
+
+	size_t length = 0;
+	while (true) {
+		ssize_t nbytes = recv(capture->fd, buffer + length,
+				      max_length - length, MSG_DONTWAIT);
+		if (nbytes <= 0)
+			break;
+
+		length += nbytes;
+	}
+
+	buffer[length] = 0;
+	return buffer;
+}
+
+START_TEST(test_large_command)
+{
+	enum {
+		LENGTH = 20000,
+
+		/* every 100th character is a double quote */
+		ESCAPED_LENGTH = LENGTH + LENGTH / 100,
+	};
+
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	/* an argument which is much larger than the output buffer,
+	   with characters which need to be escaped */
+	char *value = malloc(LENGTH + 1);
+	ck_assert_ptr_ne(value, NULL);
+	for (size_t i = 0; i < LENGTH; ++i)
+		value[i] = i % 100 == 0 ? '"' : 'x';
+	value[LENGTH] = 0;
+
+	ck_assert(mpd_send_command(c, "foo", value, "bar", NULL));
+
+	char *received = receive_all(&capture, LENGTH * 2);
+	ck_assert_int_eq(strlen(received),
+			 strlen("foo \"\" \"bar\"\n") + ESCAPED_LENGTH);
+	ck_assert(strncmp(received, "foo \"\\\"xx", 9) == 0);
+	ck_assert_str_eq(received + strlen(received) - 9, "x\" \"bar\"\n");
+	free(received);
+
+	const char *const argv[] = { value, NULL };
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+	ck_assert(mpd_send_command_argv(c, "foo", argv));
+
+	received = receive_all(&capture, LENGTH * 2);
+	ck_assert_int_eq(strlen(received),
+			 strlen("foo \"\"\n") + ESCAPED_LENGTH);
+	free(received);
+
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	free(value);
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_cork)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	ck_assert(mpd_connection_cork(c));
+	ck_assert(mpd_send_command(c, "a", NULL));
+	ck_assert(mpd_send_command(c, "b", NULL));
+	ck_assert(mpd_send_command(c, "c", NULL));
+
+	/* nothing has been sent yet */
+	char buffer[16];
+	ck_assert_int_lt(recv(capture.fd, buffer, sizeof(buffer),
+			      MSG_DONTWAIT), 0);
+
+	ck_assert(mpd_connection_uncork(c));
+	ck_assert_str_eq(test_capture_receive(&capture), "a\nb\nc\n");
+
+	/* no new command until all responses have been read */
+	ck_assert(!mpd_send_command(c, "d", NULL));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_STATE);
+	ck_assert(mpd_connection_clear_error(c));
+
+	ck_assert(test_capture_send(&capture,
+				    "x: 1\nOK\n"
+				    "ACK [5@0] {b} failed\n"
+				    "y: 2\nOK\n"));
+
+	struct mpd_pair *pair = mpd_recv_pair(c);
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_str_eq(pair->name, "x");
+	mpd_return_pair(c, pair);
+	ck_assert_ptr_eq(mpd_recv_pair(c), NULL);
+	ck_assert(mpd_response_finish(c));
+
+	ck_assert(!mpd_response_finish(c));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SERVER);
+	ck_assert(mpd_connection_clear_error(c));
+
+	pair = mpd_recv_pair(c);
+	ck_assert_ptr_ne(pair, NULL);
+	ck_assert_str_eq(pair->name, "y");
+	mpd_return_pair(c, pair);
+	ck_assert(mpd_response_finish(c));
+
+	/* back to normal */
+	ck_assert(mpd_send_command(c, "d", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "d\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static long long
+now_ms(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Sends a command which never gets a response, and returns how long
+ * it took until the connection gave up.
+ */
+static long long
+measure_timeout(struct test_capture *capture, struct mpd_connection *c)
+{
+	const long long start = now_ms();
+
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(capture), "ping\n");
+
+	ck_assert(!mpd_response_finish(c));
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_TIMEOUT);
+
+	return now_ms() - start;
+}
+
+START_TEST(test_timeout_ms)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	/* the milliseconds must not be mistaken for microseconds */
+	mpd_connection_set_timeout(c, 300);
+	ck_assert_int_ge(measure_timeout(&capture, c), 290);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+START_TEST(test_deadline)
+{
+	struct test_capture capture;
+	struct mpd_connection *c = test_capture_init(&capture);
+	ck_assert_ptr_ne(c, NULL);
+
+	mpd_connection_set_timeout(c, 10000);
+
+	/* the deadline is cleared when the response is finished */
+	mpd_connection_set_deadline(c, 50);
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	usleep(100000);
+
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	/* it is also cleared when the response is read to the NULL
+	   pair */
+	mpd_connection_set_deadline(c, 100);
+	ck_assert(mpd_send_command(c, "ping", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "ping\n");
+	ck_assert(test_capture_send(&capture, "OK\n"));
+	ck_assert_ptr_eq(mpd_recv_pair(c), NULL);
+	ck_assert_int_eq(mpd_connection_get_error(c), MPD_ERROR_SUCCESS);
+
+	usleep(200000);
+
+	ck_assert(mpd_send_command(c, "status", NULL));
+	ck_assert_str_eq(test_capture_receive(&capture), "status\n");
+	ck_assert(test_capture_send(&capture, "state: stop\nOK\n"));
+	ck_assert(mpd_response_finish(c));
+
+	/* the deadline takes precedence over the longer timeout */
+	mpd_connection_set_deadline(c, 100);
+	const long long duration = measure_timeout(&capture, c);
+	ck_assert_int_ge(duration, 90);
+	ck_assert_int_lt(duration, 5000);
+
+	mpd_connection_free(c);
+	test_capture_deinit(&capture);
+}
+END_TEST
+
+static Suite *
+create_suite(void)
+{
+	Suite *s = suite_create("sync");
+
+	TCase *tc_poll = tcase_create("poll");
+	tcase_add_test(tc_poll, test_high_fd);
+	tcase_add_test(tc_poll, test_high_fd_timeout);
+	tcase_add_test(tc_poll, test_timeout_ms);
+	tcase_add_test(tc_poll, test_deadline);
+	suite_add_tcase(s, tc_poll);
+
+	TCase *tc_send = tcase_create("send");
+	tcase_add_test(tc_send, test_large_command);
+	tcase_add_test(tc_send, test_cork);
+	suite_add_tcase(s, tc_send);
+
+	return s;
+}
+
+int
+main(void)
+{
+	Suite *s = create_suite();
+	SRunner *sr = srunner_create(s);
+	srunner_run_all(sr, CK_NORMAL);
+	int number_failed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+	return number_failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}